@@ -63,6 +63,42 @@ Contents:
 /// @see ic_set_prompt_marker(), ic_style_def()
 char* ic_readline(const char* prompt_text);   
 
+/// Start reading input without blocking, for use within an event loop.
+/// This displays the prompt and puts the terminal in raw mode; after that
+/// ic_readline_poll() (or ic_readline_feed()) should be called whenever input
+/// is available on ic_readline_get_fd() or ic_readline_get_wake_fd(), until it returns `true`.
+/// Input that followed a previous finished line is kept and processed by the
+/// next ic_readline_poll(), so call it once directly after starting.
+/// @param prompt_text   The prompt text, can be NULL for the default (""). 
+/// @returns `false` if there is no editing capability (see ic_readline()) or
+///   if another line is already being edited. 
+///
+/// Note: while the completion menu, history search, or help is shown,
+/// the input is still read in a blocking way until it is dismissed.
+bool ic_readline_start(const char* prompt_text);
+
+/// Return the file descriptor to wait on for input (in `poll`, `epoll`, `libuv` etc),
+/// or -1 if not available (e.g. on Windows, where ic_readline_poll() can be called periodically instead).
+int ic_readline_get_fd(void);
+
+/// Return the file descriptor that becomes readable on asynchronous events:
+/// ic_print_async(), ic_async_stop(), and terminal resizes. Both this descriptor and
+/// ic_readline_get_fd() must be polled, and ic_readline_poll() called when either is readable
+/// (do not read from this descriptor yourself). Returns -1 if not available (e.g. on Windows).
+int ic_readline_get_wake_fd(void);
+
+/// Process all input that is currently available without blocking.
+/// @param line  Receives the input if editing is done, or NULL if the user typed ctrl+d or ctrl+c.
+///   The result should be `free`d by the caller (using ic_free()).
+/// @returns `true` if editing is done (and the terminal is restored), or `false` if more input is needed.
+///   Also returns `true` (with `*line` set to NULL) if no line is being edited.
+bool ic_readline_poll(char** line);
+
+/// Like ic_readline_poll() but first adds the given input `bytes` that
+/// were read by the application from ic_readline_get_fd() itself.
+/// All bytes are taken: any input after a finished line is kept for the next line.
+bool ic_readline_feed(const char* bytes, size_t len, char** line);
+
 /// \}
 
 
@@ -103,6 +139,31 @@ void ic_printf(const char* fmt, ...);
 /// @see ic_print
 void ic_vprintf(const char* fmt, va_list args);
 
+/// A compiled format (see ic_format_compile()).
+struct ic_format_s;
+typedef struct ic_format_s ic_format_t;
+
+/// Compile a format with bbcode markup and `printf` directives for repeated printing.
+/// The markup is parsed, and styles are resolved, only once; printing with ic_format_print()
+/// then only substitutes the arguments. Unlike ic_printf(), the substituted arguments are 
+/// never interpreted as bbcode, and directives are only substituted outside of tags.
+/// Styles (re)defined after compilation do not affect the compiled format.
+/// Supports the standard `printf` directives except for `%n`.
+/// @param fmt The format, for example `"[b]%s[/b]: [ic-info]%5.1f%%[/]\n"`.
+/// @returns The compiled format (release with ic_format_free()), or NULL on allocation failure.
+ic_format_t* ic_format_compile( const char* fmt );
+
+/// Print a compiled format with the given arguments.
+/// @see ic_format_compile()
+void ic_format_print( const ic_format_t* fmt, ... );
+
+/// Print a compiled format with the given arguments.
+/// @see ic_format_compile()
+void ic_format_vprint( const ic_format_t* fmt, va_list args );
+
+/// Release a compiled format.
+void ic_format_free( ic_format_t* fmt );
+
 /// Define or redefine a style.
 /// @param style_name The name of the style. 
 /// @param fmt        The `fmt` string is the content of a tag and can contain
@@ -116,6 +177,15 @@ void ic_style_open( const char* fmt );
 /// End a global style.
 void ic_style_close(void);
 
+/// A handle to a style, see ic_style_lookup(). A handle is never 0.
+typedef long ic_style_handle_t;
+
+/// Look up a style by name and return a handle for it that can be used with
+/// ic_highlight_style() to avoid resolving the name on every use.
+/// A handle stays valid when the style is redefined with ic_style_def() (and then refers to the new definition).
+/// Returns 0 if `style_name` is empty or on allocation failure.
+ic_style_handle_t ic_style_lookup( const char* style_name );
+
 /// \}
 
 
@@ -196,6 +266,44 @@ bool ic_add_completion_ex( ic_completion_env_t* cenv, const char* completion, co
 /// If `false` is returned, the callback should try to return and not add more completions (for improved latency).
 bool ic_add_completions(ic_completion_env_t* cenv, const char* prefix, const char** completions);
 
+/// In a completion callback (usually from ic_complete_word()), use this function to add a completion
+/// if it _fuzzy_ matches the `prefix`: all characters of the `prefix` must occur in order in the `completion` 
+/// (ignoring ascii case). Matches at word boundaries (like after `_` or `-`), at camelCase humps, and 
+/// consecutive matches score higher, as do completions that occur often in the history. 
+/// The completion menu shows scored completions in order of their score.
+/// The `display` and `help` can be `NULL` for the default.
+/// For example, with prefix `gfn` the completion `get_file_name` ranks higher than `grafana`.
+///
+/// Returns `true` if the callback should continue trying to find more possible completions.
+/// (Unlike the other functions, this keeps returning `true` if there are enough completions already
+///  such that only the best scoring completions are retained.)
+bool ic_add_completion_scored(ic_completion_env_t* cenv, const char* prefix, const char* completion, const char* display, const char* help);
+
+/// A vocabulary: an immutable index over a fixed set of words.
+struct ic_vocab_s;
+
+/// A vocabulary: an immutable index over a fixed set of words.
+typedef struct ic_vocab_s ic_vocab_t;
+
+/// Create a vocabulary from a `NULL` terminated array of `words` (which are copied).
+/// Use this instead of ic_add_completions() for large fixed sets of words, like keywords.
+/// The vocabulary is immutable and can be shared between completers (and threads).
+/// Returns `NULL` on allocation failure.
+/// @see ic_complete_from_vocab(), ic_vocab_free()
+ic_vocab_t* ic_vocab_new(const char** words);
+
+/// Free a vocabulary created with ic_vocab_new().
+void ic_vocab_free(ic_vocab_t* vocab);
+
+/// In a completion callback (usually from ic_complete_word()), use this function to add 
+/// all words in the vocabulary that start with `prefix` (ignoring ascii case) as completions.
+/// This is like ic_add_completions() but uses a binary search over the sorted vocabulary instead of 
+/// visiting every word.
+///
+/// Returns `true` if the callback should continue trying to find more possible completions.
+/// If `false` is returned, the callback should try to return and not add more completions (for improved latency).
+bool ic_complete_from_vocab(ic_completion_env_t* cenv, const char* prefix, const ic_vocab_t* vocab);
+
 /// Complete a filename.
 /// Complete a filename given a semi-colon separated list of root directories `roots` and 
 /// semi-colon separated list of possible extensions (excluding directories). 
@@ -204,6 +312,8 @@ bool ic_add_completions(ic_completion_env_t* cenv, const char* prefix, const cha
 /// Each root directory should _not_ end with a directory separator.
 /// If a directory is completed, the `dir_separator` is added at the end if it is not `0`.
 /// Usually the `dir_separator` is `/` but it can be set to `\\` on Windows systems.
+/// If there are multiple roots, their directories are listed concurrently (by a few worker threads),
+/// so a custom allocator (see ic_init_custom_alloc()) must be thread-safe in that case.
 /// For example:
 /// ```
 /// /ho         --> /home/
@@ -283,6 +393,22 @@ void ic_set_default_highlighter(ic_highlight_fun_t* highlighter, void* arg);
 /// Set the style of characters starting at position `pos`.
 void ic_highlight(ic_highlight_env_t* henv, long pos, long count, const char* style );
 
+/// Set the style of characters starting at position `pos` using a style handle.
+/// @see ic_style_lookup()
+void ic_highlight_style(ic_highlight_env_t* henv, long pos, long count, ic_style_handle_t style );
+
+/// A styled span of the input, see ic_highlight_spans().
+typedef struct ic_highlight_span_s {
+  long  pos;                ///< start position (as in ic_highlight())
+  long  count;              ///< length (as in ic_highlight())
+  ic_style_handle_t style;  ///< style handle from ic_style_lookup()
+} ic_highlight_span_t;
+
+/// Set the style of `n` spans at once.
+/// Sorted spans that do not overlap are applied in a single pass over the styled input;
+/// where spans overlap (or are out of order), later spans are applied over earlier ones.
+void ic_highlight_spans(ic_highlight_env_t* henv, const ic_highlight_span_t* spans, long n );
+
 /// Experimental: Convenience callback for a function that highlights `s` using bbcode's.
 /// The returned string should be allocated and is free'd by the caller.
 typedef char* (ic_highlight_format_fun_t)(const char* s, void* arg);
@@ -385,6 +511,20 @@ bool ic_enable_highlight(bool enable);
 /// but it may be increased if working with very slow terminals.
 void ic_set_tty_esc_delay(long initial_delay_ms, long followup_delay_ms);
 
+/// Disable or enable the kitty keyboard protocol (disabled by default).
+/// When enabled, the terminal is asked to report the ESC key and alt/ctrl keys
+/// as unambiguous escape sequences while editing, such that a lone ESC is recognized
+/// without waiting for the initial escape delay. The protocol is only used if the terminal
+/// reports support for it.
+/// Has no effect on Windows. Returns the previous setting.
+bool ic_enable_kitty_keyboard(bool enable);
+
+/// Use a file to cache the terminal capabilities across program launches (disabled by default).
+/// The cache is keyed by the terminal identity in the environment (like `TERM` and `TERM_PROGRAM`);
+/// if the current terminal is found, the terminal is not queried at startup. Otherwise the 
+/// terminal is queried now and the result is added to the cache. Pass \a NULL to disable.
+void ic_set_term_cache(const char* fname);
+
 /// Enable highlighting of matching braces (and error highlight unmatched braces).`
 bool ic_enable_brace_matching(bool enable);
 
@@ -594,6 +734,17 @@ int ic_term_get_color_bits( void );
 /// functional on Linux, macOS and Windows).
 bool ic_async_stop(void);
 
+/// Thread-safe way to print (with bbcode markup, ending with a newline) while a readline may be active.
+/// The message is queued and printed by the editor above the current prompt (which is then redrawn once
+/// for all messages that were queued in the meantime). If no readline is active, the message is
+/// printed right away by the calling thread; it waits for (and never interleaves with) ic_print(),
+/// ic_println(), ic_printf() and ic_format_print() on other threads, and messages that are queued
+/// while a readline finishes are printed as it returns.
+/// This should only be called after the library is initialized (for example by calling
+/// it from the main thread before starting other threads), and a custom allocator must be thread-safe.
+/// When using ic_readline_start(), the messages are printed on the next call to ic_readline_poll().
+void ic_print_async(const char* s);
+
 /// \}
 
 //--------------------------------------------------------------
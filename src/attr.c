@@ -168,32 +168,93 @@ ic_private attr_t attr_from_esc_sgr( const char* s, ssize_t len) {
   return attr_from_sgr(s+2, len-2);
 }
 
-
 //-------------------------------------------------------------
 // Attribute buffer
+// Attributes are stored as runs: run `i` applies from `runs[i].pos`
+// up to the start of the next run (or `count`). Adjacent runs always
+// differ, so highlighted text that changes style only every so many
+// bytes takes little space, and lookups use a binary search.
 //-------------------------------------------------------------
+
+typedef struct attr_run_s {
+  ssize_t  pos;
+  attr_t   attr;
+} attr_run_t;
+
 struct attrbuf_s {
-  attr_t*  attrs;
-  ssize_t  capacity;
-  ssize_t  count;
+  attr_run_t* runs;
+  ssize_t  capacity;    // capacity of `runs`
+  ssize_t  rcount;      // number of runs
+  ssize_t  count;       // length in bytes
   alloc_t* mem;
 };
 
-static bool attrbuf_ensure_capacity( attrbuf_t* ab, ssize_t needed ) {
+static bool attrbuf_ensure_runs( attrbuf_t* ab, ssize_t needed ) {
   if (needed <= ab->capacity) return true;
-  ssize_t newcap = (ab->capacity <= 0 ? 240 : (ab->capacity > 1000 ? ab->capacity + 1000 : 2*ab->capacity));
+  ssize_t newcap = (ab->capacity <= 0 ? 16 : (ab->capacity > 1000 ? ab->capacity + 1000 : 2*ab->capacity));
   if (needed > newcap) { newcap = needed; }
-  attr_t* newattrs = mem_realloc_tp( ab->mem, attr_t, ab->attrs, newcap );
-  if (newattrs == NULL) return false;
-  ab->attrs = newattrs;
+  attr_run_t* newruns = mem_realloc_tp( ab->mem, attr_run_t, ab->runs, newcap );
+  if (newruns == NULL) return false;
+  ab->runs = newruns;
   ab->capacity = newcap;
   assert(needed <= ab->capacity);
   return true;
 }
 
-static bool attrbuf_ensure_extra( attrbuf_t* ab, ssize_t extra ) {
-  const ssize_t needed = ab->count + extra;
-  return attrbuf_ensure_capacity( ab, needed );
+// index of the run that contains `pos` (with `0 <= pos < count`)
+static ssize_t attrbuf_run_index( const attrbuf_t* ab, ssize_t pos ) {
+  assert(pos >= 0 && pos < ab->count && ab->rcount > 0);
+  if (pos >= ab->runs[ab->rcount-1].pos) return (ab->rcount - 1);  // common when highlighting in order
+  ssize_t lo = 0;
+  ssize_t hi = ab->rcount - 1;
+  while( lo < hi ) {
+    const ssize_t mid = (lo + hi + 1) / 2;
+    if (ab->runs[mid].pos <= pos) { lo = mid; }
+                             else { hi = mid - 1; }
+  }
+  return lo;
+}
+
+// ensure a run starts at `pos` and return its index (which is `rcount` if `pos == count`), or -1 on failure
+static ssize_t attrbuf_split_at( attrbuf_t* ab, ssize_t pos ) {
+  if (pos >= ab->count) return ab->rcount;
+  const ssize_t i = attrbuf_run_index(ab, pos);
+  if (ab->runs[i].pos == pos) return i;
+  if (!attrbuf_ensure_runs(ab, ab->rcount + 1)) return -1;
+  ic_memmove( ab->runs + i + 2, ab->runs + i + 1, (ab->rcount - i - 1)*ssizeof(attr_run_t) );
+  ab->runs[i+1].pos  = pos;
+  ab->runs[i+1].attr = ab->runs[i].attr;
+  ab->rcount++;
+  return i+1;
+}
+
+// merge each run in `[from,to)` with its predecessor if they are equal
+static void attrbuf_merge( attrbuf_t* ab, ssize_t from, ssize_t to ) {
+  if (from < 1) { from = 1; }
+  if (to > ab->rcount) { to = ab->rcount; }
+  ssize_t j = from;
+  for( ssize_t i = from; i < to; i++) {
+    if (!attr_is_eq(ab->runs[j-1].attr, ab->runs[i].attr)) {
+      ab->runs[j++] = ab->runs[i];
+    }
+  }
+  if (j < to) {
+    ic_memmove( ab->runs + j, ab->runs + to, (ab->rcount - to)*ssizeof(attr_run_t) );
+    ab->rcount -= (to - j);
+  }
+}
+
+// extend with default attributes up to `end`
+static bool attrbuf_extend( attrbuf_t* ab, ssize_t end ) {
+  if (end <= ab->count) return true;
+  if (ab->rcount == 0 || !attr_is_none(ab->runs[ab->rcount-1].attr)) {
+    if (!attrbuf_ensure_runs(ab, ab->rcount + 1)) return false;
+    ab->runs[ab->rcount].pos  = ab->count;
+    ab->runs[ab->rcount].attr = attr_none();
+    ab->rcount++;
+  }
+  ab->count = end;
+  return true;
 }
 
 
@@ -201,55 +262,48 @@ ic_private attrbuf_t* attrbuf_new( alloc_t* mem ) {
   attrbuf_t* ab = mem_zalloc_tp(mem,attrbuf_t);
   if (ab == NULL) return NULL;
   ab->mem = mem;
-  attrbuf_ensure_extra(ab,1);
+  attrbuf_ensure_runs(ab,1);
   return ab;
 }
 
 ic_private void attrbuf_free( attrbuf_t* ab ) {
   if (ab==NULL) return;
-  mem_free(ab->mem, ab->attrs);
+  mem_free(ab->mem, ab->runs);
   mem_free(ab->mem, ab);
 }
 
 ic_private void attrbuf_clear(attrbuf_t* ab) {
   if (ab == NULL) return;
   ab->count = 0;
+  ab->rcount = 0;
 }
 
 ic_private ssize_t attrbuf_len( attrbuf_t* ab ) {
   return (ab==NULL ? 0 : ab->count);
 }
 
-ic_private const attr_t* attrbuf_attrs( attrbuf_t* ab, ssize_t expected_len ) {
-  assert(expected_len <= ab->count );
-  // expand if needed
-  if (ab->count < expected_len) {    
-    if (!attrbuf_ensure_capacity(ab,expected_len)) return NULL;
-    for(ssize_t i = ab->count; i < expected_len; i++) {
-      ab->attrs[i] = attr_none();  
-    }
-    ab->count = expected_len;
-  }
-  return ab->attrs;
-}
-
-
-
 static void attrbuf_update_set_at( attrbuf_t* ab, ssize_t pos, ssize_t count, attr_t attr, bool update ) {
+  if (pos < 0 || count <= 0) return;
   const ssize_t end = pos + count;
-  if (!attrbuf_ensure_capacity(ab, end)) return;
-  ssize_t i;
-  // initialize if end is beyond the count (todo: avoid duplicate init and set if update==false?)
-  if (ab->count < end) {
-    for(i = ab->count; i < end; i++) {
-      ab->attrs[i] = attr_none();  
+  if (!attrbuf_extend(ab, end)) return;
+  const ssize_t i = attrbuf_split_at(ab, pos);
+  if (i < 0) return;
+  const ssize_t j = attrbuf_split_at(ab, end);
+  if (j < 0) return;
+  assert(i < j);
+  if (update) {
+    for( ssize_t k = i; k < j; k++) {
+      ab->runs[k].attr = attr_update_with(ab->runs[k].attr, attr);
     }
-    ab->count = end;
+    attrbuf_merge(ab, i, j+1);
+  }
+  else {
+    // replace runs `[i,j)` with a single run
+    ab->runs[i].attr = attr;
+    ic_memmove( ab->runs + i + 1, ab->runs + j, (ab->rcount - j)*ssizeof(attr_run_t) );
+    ab->rcount -= (j - (i+1));
+    attrbuf_merge(ab, i, i+2);
   }
-  // fill pos to end with attr 
-  for(i = pos; i < end; i++) {
-    ab->attrs[i] = (update ? attr_update_with(ab->attrs[i],attr) : attr);    
-  }  
 }
 
 ic_private void attrbuf_set_at( attrbuf_t* ab, ssize_t pos, ssize_t count, attr_t attr ) {
@@ -262,33 +316,103 @@ ic_private void attrbuf_update_at( attrbuf_t* ab, ssize_t pos, ssize_t count, at
 
 ic_private void attrbuf_insert_at( attrbuf_t* ab, ssize_t pos, ssize_t count, attr_t attr ) {
   if (pos < 0 || pos > ab->count || count <= 0) return;
-  if (!attrbuf_ensure_extra(ab,count)) return;  
-  ic_memmove( ab->attrs + pos + count, ab->attrs + pos, (ab->count - pos)*ssizeof(attr_t) );
+  if (!attrbuf_ensure_runs(ab, ab->rcount + 2)) return;
+  const ssize_t i = attrbuf_split_at(ab, pos);
+  assert(i >= 0);
+  for( ssize_t k = i; k < ab->rcount; k++) {
+    ab->runs[k].pos += count;
+  }
+  ic_memmove( ab->runs + i + 1, ab->runs + i, (ab->rcount - i)*ssizeof(attr_run_t) );
+  ab->runs[i].pos  = pos;
+  ab->runs[i].attr = attr;
+  ab->rcount++;
   ab->count += count;
-  attrbuf_set_at( ab, pos, count, attr );
+  attrbuf_merge(ab, i, i+2);
 }
 
+// copy the runs of `ab` from `*at` up to `end` into `runs` (updated with `update` if not NULL);
+// `*i` is the run of `ab` that contains `*at`.
+static void attrbuf_copy_runs( const attrbuf_t* ab, ssize_t* i, ssize_t* at, ssize_t end, const attr_t* update, attr_run_t* runs, ssize_t* rcount ) {
+  while( *at < end ) {
+    while( *i + 1 < ab->rcount && ab->runs[*i + 1].pos <= *at ) { (*i)++; }
+    const attr_t attr = (update == NULL ? ab->runs[*i].attr : attr_update_with(ab->runs[*i].attr, *update));
+    if (*rcount == 0 || !attr_is_eq(runs[*rcount - 1].attr, attr)) {
+      runs[*rcount].pos  = *at;
+      runs[*rcount].attr = attr;
+      (*rcount)++;
+    }
+    const ssize_t run_end = (*i + 1 < ab->rcount ? ab->runs[*i + 1].pos : ab->count);
+    *at = (run_end < end ? run_end : end);
+  }
+}
+
+// update with sorted and non-overlapping spans in a single merge pass over the runs
+ic_private void attrbuf_update_spans( attrbuf_t* ab, const attr_span_t* spans, ssize_t n ) {
+  if (n <= 0) return;
+  if (n == 1) {
+    attrbuf_update_at(ab, spans[0].pos, spans[0].count, spans[0].attr);
+    return;
+  }
+  if (!attrbuf_extend(ab, spans[n-1].pos + spans[n-1].count)) return;
+  const ssize_t capacity = ab->rcount + 2*n;  // each span adds at most two run boundaries
+  attr_run_t* runs = mem_malloc_tp_n(ab->mem, attr_run_t, capacity);
+  if (runs == NULL) return;
+  ssize_t rcount = 0;
+  ssize_t i  = 0;
+  ssize_t at = 0;
+  for( ssize_t s = 0; s < n; s++ ) {
+    assert(spans[s].pos >= at && spans[s].count > 0);
+    attrbuf_copy_runs(ab, &i, &at, spans[s].pos, NULL, runs, &rcount);
+    attrbuf_copy_runs(ab, &i, &at, spans[s].pos + spans[s].count, &spans[s].attr, runs, &rcount);
+  }
+  attrbuf_copy_runs(ab, &i, &at, ab->count, NULL, runs, &rcount);
+  assert(rcount <= capacity);
+  mem_free(ab->mem, ab->runs);
+  ab->runs = runs;
+  ab->rcount = rcount;
+  ab->capacity = capacity;
+}
 
 // note: must allow ab == NULL!
 ic_private ssize_t attrbuf_append_n( stringbuf_t* sb, attrbuf_t* ab, const char* s, ssize_t len, attr_t attr ) {
   if (s == NULL || len == 0) return sbuf_len(sb);
   if (ab != NULL) {
-    if (!attrbuf_ensure_extra(ab,len)) return sbuf_len(sb);
-    attrbuf_set_at(ab, ab->count, len, attr);
+    const ssize_t count = ab->count;
+    attrbuf_set_at(ab, count, len, attr);
+    if (ab->count != count + len) return sbuf_len(sb);
   }
   return sbuf_append_n(sb,s,len);
 }
 
 ic_private attr_t attrbuf_attr_at( attrbuf_t* ab, ssize_t pos ) {
-  if (ab==NULL || pos < 0 || pos > ab->count) return attr_none();
-  return ab->attrs[pos];
+  if (ab==NULL || pos < 0 || pos >= ab->count) return attr_none();
+  return ab->runs[attrbuf_run_index(ab,pos)].attr;
+}
+
+ic_private attr_t attrbuf_run_at( attrbuf_t* ab, ssize_t pos, ssize_t* len ) {
+  if (ab==NULL || pos < 0 || pos >= ab->count) {
+    *len = 0;
+    return attr_none();
+  }
+  const ssize_t i = attrbuf_run_index(ab,pos);
+  *len = (i+1 < ab->rcount ? ab->runs[i+1].pos : ab->count) - pos;
+  return ab->runs[i].attr;
 }
 
 ic_private void attrbuf_delete_at( attrbuf_t* ab, ssize_t pos, ssize_t count ) {
   if (ab==NULL || pos < 0 || pos > ab->count) return;
   if (pos + count > ab->count) { count = ab->count - pos; }
-  if (count == 0) return;
+  if (count <= 0) return;
   assert(pos + count <= ab->count);
-  ic_memmove( ab->attrs + pos, ab->attrs + pos + count, ab->count - (pos + count) );
+  const ssize_t i = attrbuf_split_at(ab, pos);
+  if (i < 0) return;
+  const ssize_t j = attrbuf_split_at(ab, pos + count);
+  if (j < 0) return;
+  ic_memmove( ab->runs + i, ab->runs + j, (ab->rcount - j)*ssizeof(attr_run_t) );
+  ab->rcount -= (j - i);
+  for( ssize_t k = i; k < ab->rcount; k++) {
+    ab->runs[k].pos -= count;
+  }
   ab->count -= count;
+  attrbuf_merge(ab, i, i+1);
 }
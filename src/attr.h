@@ -57,14 +57,23 @@ ic_private attrbuf_t*     attrbuf_new( alloc_t* mem );
 ic_private void           attrbuf_free( attrbuf_t* ab );  // ab can be NULL
 ic_private void           attrbuf_clear( attrbuf_t* ab ); // ab can be NULL
 ic_private ssize_t        attrbuf_len( attrbuf_t* ab);    // ab can be NULL
-ic_private const attr_t*  attrbuf_attrs( attrbuf_t* ab, ssize_t expected_len );
 ic_private ssize_t        attrbuf_append_n( stringbuf_t* sb, attrbuf_t* ab, const char* s, ssize_t len, attr_t attr );
 
 ic_private void           attrbuf_set_at( attrbuf_t* ab, ssize_t pos, ssize_t count, attr_t attr );
 ic_private void           attrbuf_update_at( attrbuf_t* ab, ssize_t pos, ssize_t count, attr_t attr );
 ic_private void           attrbuf_insert_at( attrbuf_t* ab, ssize_t pos, ssize_t count, attr_t attr );
 
+// a span of attributes; used to update many spans in a single pass over the runs
+typedef struct attr_span_s {
+  ssize_t pos;
+  ssize_t count;
+  attr_t  attr;
+} attr_span_t;
+
+ic_private void           attrbuf_update_spans( attrbuf_t* ab, const attr_span_t* spans, ssize_t n );  // `spans` must be sorted and not overlap
+
 ic_private attr_t         attrbuf_attr_at( attrbuf_t* ab, ssize_t pos );   
+ic_private attr_t         attrbuf_run_at( attrbuf_t* ab, ssize_t pos, ssize_t* len );  // `*len` is the remaining run length (0 beyond the end)
 ic_private void           attrbuf_delete_at( attrbuf_t* ab, ssize_t pos, ssize_t count );
 
 #endif // IC_ATTR_H
@@ -29,6 +29,13 @@ typedef struct style_s {
   attr_t  attr;  // attribute to apply
 } style_t;
 
+typedef struct style_entry_s {
+  const char*  name;      // name of the style (owned)
+  attr_t       attr;      // attribute to apply
+  uint32_t     hash;      // hash of the name
+  bool         is_style;  // defined as a style (or else a cached resolution for a handle)
+} style_entry_t;
+
 typedef enum align_e {
   IC_ALIGN_LEFT,
   IC_ALIGN_CENTER,
@@ -58,9 +65,11 @@ struct bbcode_s {
   tag_t*       tags;              // stack of tags; one entry for each open tag
   ssize_t      tags_capacity;
   ssize_t      tags_nesting;   
-  style_t*     styles;            // list of used defined styles
+  style_entry_t* styles;          // interned styles; an index + 1 is a style handle
   ssize_t      styles_capacity;
   ssize_t      styles_count;
+  ssize_t*     style_table;       // open addressing hash table of style indices + 1 (or 0 if empty)
+  ssize_t      style_table_len;   // a power of 2 (or 0)
   term_t*      term;              // terminal
   alloc_t*     mem;               // allocator
   // caches
@@ -70,6 +79,8 @@ struct bbcode_s {
 };
 
 
+static void bbcode_builtin_styles_add( bbcode_t* bb );
+
 //-------------------------------------------------------------
 // Create, helpers
 //-------------------------------------------------------------
@@ -82,6 +93,7 @@ ic_private bbcode_t* bbcode_new( alloc_t* mem, term_t* term ) {
   bb->out = sbuf_new(mem);
   bb->out_attrs = attrbuf_new(mem);
   bb->vout = sbuf_new(mem);
+  bbcode_builtin_styles_add(bb);
   return bb;
 }
 
@@ -91,24 +103,103 @@ ic_private void bbcode_free( bbcode_t* bb ) {
   }
   mem_free(bb->mem, bb->tags);
   mem_free(bb->mem, bb->styles);
+  mem_free(bb->mem, bb->style_table);
   sbuf_free(bb->vout);
   sbuf_free(bb->out);
   attrbuf_free(bb->out_attrs);
   mem_free(bb->mem, bb);
 }
 
-ic_private void bbcode_style_add( bbcode_t* bb, const char* style_name, attr_t attr ) {
+//-------------------------------------------------------------
+// Interned styles
+// Style names are kept in a hash table so resolving a style
+// does not scan all definitions. Entries are never removed and
+// a redefinition updates the entry in place, so an index stays
+// valid as a handle.
+//-------------------------------------------------------------
+
+// FNV-1a
+static uint32_t style_hash( const char* name ) {
+  uint32_t h = 2166136261u;
+  for( ; *name != 0; name++) {
+    h ^= (uint8_t)(*name);
+    h *= 16777619u;
+  }
+  return h;
+}
+
+// returns the index of the style, or -1 if not found
+static ssize_t bbcode_style_find( const bbcode_t* bb, const char* name, uint32_t hash ) {
+  if (bb->style_table_len <= 0) return -1;
+  const ssize_t mask = bb->style_table_len - 1;
+  for( ssize_t i = (ssize_t)(hash & (uint32_t)mask); bb->style_table[i] != 0; i = (i+1) & mask) {
+    const style_entry_t* entry = &bb->styles[bb->style_table[i] - 1];
+    if (entry->hash == hash && strcmp(entry->name,name) == 0) return (bb->style_table[i] - 1);
+  }
+  return -1;
+}
+
+static void bbcode_style_table_insert( bbcode_t* bb, ssize_t idx ) {
+  const ssize_t mask = bb->style_table_len - 1;
+  ssize_t i = (ssize_t)(bb->styles[idx].hash & (uint32_t)mask);
+  while( bb->style_table[i] != 0 ) { i = (i+1) & mask; }
+  bb->style_table[i] = idx + 1;
+}
+
+// append a new entry; returns its index or -1 on allocation failure
+static ssize_t bbcode_style_new( bbcode_t* bb, const char* name, uint32_t hash, attr_t attr, bool is_style ) {
+  // keep the table at most half full
+  if (2*(bb->styles_count + 1) > bb->style_table_len) {
+    ssize_t newlen = (bb->style_table_len == 0 ? 64 : 2*bb->style_table_len);
+    ssize_t* table = mem_zalloc_tp_n( bb->mem, ssize_t, newlen );
+    if (table == NULL) return -1;
+    mem_free(bb->mem, bb->style_table);
+    bb->style_table = table;
+    bb->style_table_len = newlen;
+    for( ssize_t i = 0; i < bb->styles_count; i++) {
+      bbcode_style_table_insert(bb, i);
+    }
+  }
   if (bb->styles_count >= bb->styles_capacity) {
     ssize_t newlen = bb->styles_capacity + 32;
-    style_t* p = mem_realloc_tp( bb->mem, style_t, bb->styles, newlen );
-    if (p == NULL) return;
+    style_entry_t* p = mem_realloc_tp( bb->mem, style_entry_t, bb->styles, newlen );
+    if (p == NULL) return -1;
     bb->styles = p;
     bb->styles_capacity = newlen;
   }
   assert(bb->styles_count < bb->styles_capacity);
-  bb->styles[bb->styles_count].name = mem_strdup( bb->mem, style_name );
-  bb->styles[bb->styles_count].attr = attr;
+  const char* sname = mem_strdup( bb->mem, name );
+  if (sname == NULL) return -1;
+  const ssize_t idx = bb->styles_count;
+  style_entry_t* entry = &bb->styles[idx];
+  entry->name = sname;
+  entry->attr = attr;
+  entry->hash = hash;
+  entry->is_style = is_style;
   bb->styles_count++;
+  bbcode_style_table_insert(bb, idx);
+  return idx;
+}
+
+static const char* attr_update_property( tag_t* tag, const char* attr_name, const char* value );
+
+ic_private void bbcode_style_add( bbcode_t* bb, const char* style_name, attr_t attr ) {
+  if (style_name == NULL) return;
+  const uint32_t hash = style_hash(style_name);
+  const ssize_t idx = bbcode_style_find(bb, style_name, hash);
+  if (idx < 0) {
+    bbcode_style_new(bb, style_name, hash, attr, true);
+    return;
+  }
+  style_entry_t* entry = &bb->styles[idx];
+  if (!entry->is_style) {
+    // a cached resolution: properties take precedence over styles so keep those as is
+    tag_t tag;
+    memset(&tag,0,sizeof(tag));
+    if (attr_update_property(&tag, style_name, "") != NULL) return;
+  }
+  entry->attr = attr;
+  entry->is_style = true;
 }
 
 static ssize_t bbcode_tag_push( bbcode_t* bb, const tag_t* tag ) {
@@ -404,8 +495,14 @@ static const style_t builtin_styles[] = {
   { NULL, { { IC_COLOR_NONE, IC_NONE, IC_NONE, IC_COLOR_NONE, IC_NONE, IC_NONE } } }
 };
 
+static void bbcode_builtin_styles_add( bbcode_t* bb ) {
+  for( const style_t* style = builtin_styles; style->name != NULL; style++) {
+    bbcode_style_add(bb, style->name, style->attr);
+  }
+}
+
 static void attr_update_with_styles( tag_t* tag, const char* attr_name, const char* value, 
-                                             bool usebgcolor, const style_t* styles, ssize_t count ) 
+                                             bool usebgcolor, const bbcode_t* bb ) 
 {
   // direct hex color?
   if (attr_name[0] == '#' && (value == NULL || value[0]==0)) {
@@ -418,22 +515,13 @@ static void attr_update_with_styles( tag_t* tag, const char* attr_name, const ch
     if (tag->name != NULL) tag->name = name;
     return;
   }
-  // then check all styles
-  while( count-- > 0 ) {
-    const style_t* style = styles + count;
-    if (strcmp(style->name,attr_name) == 0) {
-      tag->attr = attr_update_with(tag->attr,style->attr);
-      if (tag->name != NULL) tag->name = style->name;
-      return;
-    }    
-  }
-  // check builtin styles; todo: binary search?
-  for( const style_t* style = builtin_styles; style->name != NULL; style++) {
-    if (strcmp(style->name,attr_name) == 0) {
-      tag->attr = attr_update_with(tag->attr,style->attr);
-      if (tag->name != NULL) tag->name = style->name;
-      return;
-    }
+  // then check the (user and builtin) styles; a cached color resolution is only valid as a foreground
+  const ssize_t idx = bbcode_style_find(bb, attr_name, style_hash(attr_name));
+  if (idx >= 0 && (bb->styles[idx].is_style || !usebgcolor)) {
+    const style_entry_t* style = &bb->styles[idx];
+    tag->attr = attr_update_with(tag->attr,style->attr);
+    if (tag->name != NULL) tag->name = style->name;
+    return;
   }
   // check colors as a style
   ssize_t lo = 0;
@@ -465,10 +553,25 @@ static void attr_update_with_styles( tag_t* tag, const char* attr_name, const ch
 ic_private attr_t bbcode_style( bbcode_t* bb, const char* style_name ) {
   tag_t tag;
   tag_init(&tag);
-  attr_update_with_styles( &tag, style_name, NULL, false, bb->styles, bb->styles_count );
+  attr_update_with_styles( &tag, style_name, NULL, false, bb );
   return tag.attr;
 }
 
+ic_private ssize_t bbcode_style_lookup( bbcode_t* bb, const char* style_name ) {
+  if (style_name == NULL || style_name[0] == 0) return 0;
+  const uint32_t hash = style_hash(style_name);
+  ssize_t idx = bbcode_style_find(bb, style_name, hash);
+  if (idx < 0) {
+    idx = bbcode_style_new(bb, style_name, hash, bbcode_style(bb, style_name), false);
+  }
+  return (idx + 1);
+}
+
+ic_private attr_t bbcode_style_at( bbcode_t* bb, ssize_t handle ) {
+  if (handle <= 0 || handle > bb->styles_count) return attr_none();
+  return bb->styles[handle-1].attr;
+}
+
 //-------------------------------------------------------------
 // Parse tags
 //-------------------------------------------------------------
@@ -543,7 +646,7 @@ ic_private const char* parse_value(const char* s, const char** start, const char
   return s;  
 }
 
-ic_private const char* parse_tag_value( tag_t* tag, char* idbuf, const char* s, const style_t* styles, ssize_t scount ) {
+ic_private const char* parse_tag_value( tag_t* tag, char* idbuf, const char* s, const bbcode_t* bb ) {
   // parse: \s*[\w-]+\s*(=\s*<value>)
   bool usebgcolor = false;
   const char* id = s;
@@ -579,24 +682,24 @@ ic_private const char* parse_tag_value( tag_t* tag, char* idbuf, const char* s,
   ic_strncpy( valbuf, 128, val, valend - val);
   ic_str_tolower(idbuf);
   ic_str_tolower(valbuf);
-  attr_update_with_styles( tag, idbuf, valbuf, usebgcolor, styles, scount );  
+  attr_update_with_styles( tag, idbuf, valbuf, usebgcolor, bb );  
   return s;
 }
 
-static const char* parse_tag_values( tag_t* tag, char* idbuf, const char* s, const style_t* styles, ssize_t scount ) {
+static const char* parse_tag_values( tag_t* tag, char* idbuf, const char* s, const bbcode_t* bb ) {
   s = parse_skip_white(s);  
   idbuf[0] = 0;
   ssize_t count = 0;
   while( *s != 0 && *s != ']') {
     char idbuf_next[128];
-    s = parse_tag_value(tag, (count==0 ? idbuf : idbuf_next), s, styles, scount);
+    s = parse_tag_value(tag, (count==0 ? idbuf : idbuf_next), s, bb);
     count++;
   }
   if (*s == ']') { s++; }
   return s;
 }
 
-static const char* parse_tag( tag_t* tag, char* idbuf, bool* open, bool* pre, const char* s, const style_t* styles, ssize_t scount ) {
+static const char* parse_tag( tag_t* tag, char* idbuf, bool* open, bool* pre, const char* s, const bbcode_t* bb ) {
   *open = true;
   *pre = false;
   if (*s != '[') return s;
@@ -609,7 +712,7 @@ static const char* parse_tag( tag_t* tag, char* idbuf, bool* open, bool* pre, co
     *open = false; 
     s = parse_skip_white(s+1); 
   };
-  s = parse_tag_values( tag, idbuf, s, styles, scount);
+  s = parse_tag_values( tag, idbuf, s, bb);
   return s;
 }
 
@@ -622,7 +725,7 @@ static void bbcode_parse_tag_content( bbcode_t* bb, const char* s, tag_t* tag )
   tag_init(tag);
   if (s != NULL) { 
     char idbuf[128];
-    parse_tag_values(tag, idbuf, s, bb->styles, bb->styles_count);
+    parse_tag_values(tag, idbuf, s, bb);
   }
 }
 
@@ -715,6 +818,18 @@ static void bbcode_restrict_width( ssize_t start, width_t width, stringbuf_t* ou
 // Print
 //---------------------------------------------------------
 
+// close a tag and restrict the output to its width (if any)
+static void bbcode_close_restrict( bbcode_t* bb, ssize_t base, const char* name, stringbuf_t* out, attrbuf_t* attr_out, attr_t* cur_attr ) {
+  tag_t prev;
+  if (bbcode_close( bb, base, name, &prev)) {
+    *cur_attr = prev.attr;
+    if (prev.width.w > 0) {
+      // closed a width tag; restrict the output to width
+      bbcode_restrict_width( prev.pos, prev.width, out, attr_out);
+    }
+  }
+}
+
 ic_private ssize_t bbcode_process_tag( bbcode_t* bb, const char* s, const ssize_t nesting_base, 
                                         stringbuf_t* out, attrbuf_t* attr_out, attr_t* cur_attr ) {
   assert(*s == '[');
@@ -723,7 +838,7 @@ ic_private ssize_t bbcode_process_tag( bbcode_t* bb, const char* s, const ssize_
   bool open = true;
   bool ispre = false;
   char idbuf[128];
-  const char* end = parse_tag( &tag, idbuf, &open, &ispre, s, bb->styles, bb->styles_count ); // todo: styles
+  const char* end = parse_tag( &tag, idbuf, &open, &ispre, s, bb );
   assert(end > s);
   if (open) {
     if (!ispre) {
@@ -750,14 +865,7 @@ ic_private ssize_t bbcode_process_tag( bbcode_t* bb, const char* s, const ssize_
   }
   else {
     // pop the tag
-    tag_t prev;
-    if (bbcode_close( bb, nesting_base, tag.name, &prev)) {
-      *cur_attr = prev.attr;
-      if (prev.width.w > 0) {
-        // closed a width tag; restrict the output to width
-        bbcode_restrict_width( prev.pos, prev.width, out, attr_out);
-      }
-    }
+    bbcode_close_restrict( bb, nesting_base, tag.name, out, attr_out, cur_attr );
   }  
   return (end - s);
 }
@@ -768,15 +876,13 @@ ic_private void bbcode_append( bbcode_t* bb, const char* s, stringbuf_t* out, at
   const ssize_t base = bb->tags_nesting; // base; will not be popped
   ssize_t i = 0;
   while( s[i] != 0 ) {
-    // handle no tags in bulk
+    // handle no tags in bulk (using `strcspn` which is vectorized in most C libraries)
     ssize_t nobb = 0;
-    char c;
-    while( (c = s[i+nobb]) != 0) {
-      if (c == '[' || c == '\\') { break; }
-      if (c == '\x1B' && s[i+nobb+1] == '[') {
-        nobb++; // don't count 'ESC[' as a tag opener
-      }
+    while (true) {
+      nobb += (ssize_t)strcspn(s+i+nobb, "[\\\x1B");
+      if (s[i+nobb] != '\x1B') break;   // at '[', '\\', or the end
       nobb++;
+      if (s[i+nobb] == '[') { nobb++; }  // don't count 'ESC[' as a tag opener
     }
     if (nobb > 0) { attrbuf_append_n(out, attr_out, s+i, nobb, attr); }
     i += nobb;
@@ -802,13 +908,18 @@ ic_private void bbcode_append( bbcode_t* bb, const char* s, stringbuf_t* out, at
   };
 }
 
+// write and clear the print buffer
+static void bbcode_flush( bbcode_t* bb ) {
+  term_write_formatted( bb->term, sbuf_string(bb->out), bb->out_attrs );
+  attrbuf_clear(bb->out_attrs);
+  sbuf_clear(bb->out);
+}
+
 ic_private void bbcode_print( bbcode_t* bb, const char* s ) {
   if (bb->out == NULL || bb->out_attrs == NULL || s == NULL) return;
   assert(sbuf_len(bb->out) == 0 && attrbuf_len(bb->out_attrs) == 0);
   bbcode_append( bb, s, bb->out, bb->out_attrs );
-  term_write_formatted( bb->term, sbuf_string(bb->out), attrbuf_attrs(bb->out_attrs,sbuf_len(bb->out)) );
-  attrbuf_clear(bb->out_attrs);
-  sbuf_clear(bb->out);
+  bbcode_flush(bb);
 }
 
 ic_private void bbcode_println( bbcode_t* bb, const char* s ) {
@@ -840,3 +951,351 @@ ic_private ssize_t bbcode_column_width( bbcode_t* bb, const char* s ) {
   sbuf_clear(bb->vout);
   return w;
 }
+
+
+//---------------------------------------------------------
+// Compiled formats
+// A format is parsed once into a list of operations: literal
+// text, `printf` directives, and tag opens and closes with their 
+// attributes already resolved. Printing then only substitutes 
+// the arguments and appends the text.
+//---------------------------------------------------------
+
+#define FMT_DIRECTIVE_MAX  (64)
+
+typedef enum fmt_op_kind_e {
+  FMT_TEXT,     // literal text
+  FMT_ARG,      // `printf` directive
+  FMT_OPEN,     // open a tag
+  FMT_CLOSE     // close a tag
+} fmt_op_kind_t;
+
+// the type of the argument of a directive
+typedef enum fmt_arg_e {
+  FMT_ARG_INT,
+  FMT_ARG_UINT,
+  FMT_ARG_LONG,
+  FMT_ARG_ULONG,
+  FMT_ARG_LLONG,
+  FMT_ARG_ULLONG,
+  FMT_ARG_INTMAX,
+  FMT_ARG_UINTMAX,
+  FMT_ARG_SIZE,
+  FMT_ARG_PTRDIFF,
+  FMT_ARG_DOUBLE,
+  FMT_ARG_LDOUBLE,
+  FMT_ARG_STR,
+  FMT_ARG_PTR
+} fmt_arg_t;
+
+typedef union fmt_value_u {
+  int                i;
+  unsigned int       u;
+  long               l;
+  unsigned long      ul;
+  long long          ll;
+  unsigned long long ull;
+  intmax_t           im;
+  uintmax_t          uim;
+  size_t             sz;
+  ptrdiff_t          pd;
+  double             d;
+  long double        ld;
+  const void*        p;
+} fmt_value_t;
+
+typedef struct fmt_op_s {
+  fmt_op_kind_t kind;
+  ssize_t       ofs;    // text or directive in the format string
+  ssize_t       len;
+  fmt_arg_t     arg;    // argument type of a directive
+  ssize_t       stars;  // number of `*` width and precision arguments of a directive
+  tag_t         tag;    // tag to open (or the name of the tag to close)
+} fmt_op_t;
+
+struct ic_format_s {
+  alloc_t*  mem;
+  char*     fmt;        // copy of the format string
+  fmt_op_t* ops;
+  ssize_t   count;
+  ssize_t   capacity;
+};
+
+ic_private void bbcode_format_free( ic_format_t* f ) {
+  if (f == NULL) return;
+  mem_free(f->mem, f->ops);
+  mem_free(f->mem, f->fmt);
+  mem_free(f->mem, f);
+}
+
+static fmt_op_t* fmt_push( ic_format_t* f, fmt_op_kind_t kind, ssize_t ofs, ssize_t len ) {
+  if (f->count >= f->capacity) {
+    ssize_t newcap = (f->capacity <= 0 ? 8 : 2*f->capacity);
+    fmt_op_t* p = mem_realloc_tp( f->mem, fmt_op_t, f->ops, newcap );
+    if (p == NULL) return NULL;
+    f->ops = p;
+    f->capacity = newcap;
+  }
+  fmt_op_t* op = &f->ops[f->count++];
+  memset(op, 0, sizeof(*op));
+  op->kind = kind;
+  op->ofs  = ofs;
+  op->len  = len;
+  return op;
+}
+
+// parse a `printf` directive `%[flags][width][.precision][length]conversion`; 
+// returns its length (or 0 if unsupported)
+static ssize_t fmt_parse_directive( const char* s, fmt_arg_t* arg, ssize_t* stars ) {
+  assert(*s == '%');
+  ssize_t i = 1;
+  *stars = 0;
+  while (s[i] == '-' || s[i] == '+' || s[i] == ' ' || s[i] == '#' || s[i] == '0' || s[i] == '\'') { i++; }
+  if (s[i] == '*') { (*stars)++; i++; }
+  else { while (s[i] >= '0' && s[i] <= '9') { i++; } }
+  if (s[i] == '.') {
+    i++;
+    if (s[i] == '*') { (*stars)++; i++; }
+    else { while (s[i] >= '0' && s[i] <= '9') { i++; } }
+  }
+  // length modifier
+  char lenmod = 0;
+  if ((s[i] == 'h' || s[i] == 'l') && s[i+1] == s[i]) { lenmod = (s[i] == 'l' ? 'q' : 'H'); i += 2; }
+  else if (s[i] == 'h' || s[i] == 'l' || s[i] == 'j' || s[i] == 'z' || s[i] == 't' || s[i] == 'L') { lenmod = s[i]; i++; }
+  // conversion
+  const char c = s[i];
+  if (c == 'd' || c == 'i' || c == 'o' || c == 'u' || c == 'x' || c == 'X') {
+    const bool is_signed = (c == 'd' || c == 'i');
+    switch (lenmod) {
+      case 0: case 'h': case 'H': *arg = (is_signed ? FMT_ARG_INT : FMT_ARG_UINT); break;
+      case 'l': *arg = (is_signed ? FMT_ARG_LONG : FMT_ARG_ULONG); break;
+      case 'q': *arg = (is_signed ? FMT_ARG_LLONG : FMT_ARG_ULLONG); break;
+      case 'j': *arg = (is_signed ? FMT_ARG_INTMAX : FMT_ARG_UINTMAX); break;
+      case 'z': *arg = FMT_ARG_SIZE; break;
+      case 't': *arg = FMT_ARG_PTRDIFF; break;
+      default : return 0;
+    }
+  }
+  else if (c == 'e' || c == 'E' || c == 'f' || c == 'F' || c == 'g' || c == 'G' || c == 'a' || c == 'A') {
+    if (lenmod == 0 || lenmod == 'l') { *arg = FMT_ARG_DOUBLE; }
+    else if (lenmod == 'L') { *arg = FMT_ARG_LDOUBLE; }
+    else return 0;
+  }
+  else if (c == 'c' && (lenmod == 0 || lenmod == 'l')) { *arg = FMT_ARG_INT; }
+  else if (c == 's' && lenmod == 0) { *arg = FMT_ARG_STR; }
+  else if ((c == 's' && lenmod == 'l') || (c == 'p' && lenmod == 0)) { *arg = FMT_ARG_PTR; }
+  else return 0;  // including `%n`
+  return (i+1);
+}
+
+// compile text with `printf` directives
+static bool fmt_compile_text( ic_format_t* f, ssize_t ofs, ssize_t len ) {
+  const char* s = f->fmt;
+  const ssize_t end = ofs + len;
+  while (ofs < end) {
+    const char* pct = (const char*)memchr(s + ofs, '%', to_size_t(end - ofs));
+    const ssize_t n = (pct == NULL ? end - ofs : (ssize_t)(pct - (s + ofs)));
+    if (n > 0 && fmt_push(f, FMT_TEXT, ofs, n) == NULL) return false;
+    ofs += n;
+    if (ofs >= end) break;
+    if (ofs + 1 < end && s[ofs+1] == '%') {
+      // escaped `%%`
+      if (fmt_push(f, FMT_TEXT, ofs+1, 1) == NULL) return false;
+      ofs += 2;
+      continue;
+    }
+    fmt_arg_t arg = FMT_ARG_INT;
+    ssize_t stars = 0;
+    const ssize_t dlen = fmt_parse_directive(s + ofs, &arg, &stars);
+    if (dlen <= 0 || dlen > end - ofs || dlen >= FMT_DIRECTIVE_MAX) {
+      // print unsupported directives as is
+      bbcode_invalid("bbcode: unsupported format directive: %.10s...\n", s + ofs);
+      if (fmt_push(f, FMT_TEXT, ofs, 1) == NULL) return false;
+      ofs++;
+      continue;
+    }
+    fmt_op_t* op = fmt_push(f, FMT_ARG, ofs, dlen);
+    if (op == NULL) return false;
+    op->arg   = arg;
+    op->stars = stars;
+    ofs += dlen;
+  }
+  return true;
+}
+
+// compile a tag at `ofs`; returns the length of the tag (and pre content) or -1 on allocation failure
+static ssize_t fmt_compile_tag( bbcode_t* bb, ic_format_t* f, ssize_t ofs ) {
+  const char* s = f->fmt + ofs;
+  assert(*s == '[');
+  tag_t tag;
+  tag_init(&tag);
+  bool open = true;
+  bool ispre = false;
+  char idbuf[128];
+  const char* end = parse_tag( &tag, idbuf, &open, &ispre, s, bb );
+  assert(end > s);
+  fmt_op_t* op = fmt_push(f, (open ? FMT_OPEN : FMT_CLOSE), 0, 0);
+  if (op == NULL) return -1;
+  op->tag = tag;
+  if (open && ispre) {
+    // pre content is only substituted
+    char pre[132];
+    if (snprintf(pre, 132, "[/%s]", idbuf) < ssizeof(pre)) {
+      op->tag.width.w = 0;
+      const char* etag = strstr(end,pre);
+      const ssize_t len = (etag == NULL ? ic_strlen(end) : (ssize_t)(etag - end));
+      if (!fmt_compile_text(f, (ssize_t)(end - f->fmt), len)) return -1;
+      end = (etag == NULL ? end + len : etag + ic_strlen(pre));
+      op = fmt_push(f, FMT_CLOSE, 0, 0);
+      if (op == NULL) return -1;
+      op->tag.name = tag.name;
+    }
+    else {
+      f->count--;   // ignore the tag
+    }
+  }
+  return (end - s);
+}
+
+ic_private ic_format_t* bbcode_format_compile( bbcode_t* bb, const char* fmt ) {
+  if (bb == NULL || fmt == NULL) return NULL;
+  ic_format_t* f = mem_zalloc_tp(bb->mem, ic_format_t);
+  if (f == NULL) return NULL;
+  f->mem = bb->mem;
+  f->fmt = mem_strdup(bb->mem, fmt);
+  if (f->fmt == NULL) {
+    bbcode_format_free(f);
+    return NULL;
+  }
+  // this mirrors `bbcode_append`
+  const char* s = f->fmt;
+  ssize_t i = 0;
+  while( s[i] != 0 ) {
+    ssize_t nobb = 0;
+    while (true) {
+      nobb += (ssize_t)strcspn(s+i+nobb, "[\\\x1B");
+      if (s[i+nobb] != '\x1B') break;   // at '[', '\\', or the end
+      nobb++;
+      if (s[i+nobb] == '[') { nobb++; }  // don't count 'ESC[' as a tag opener
+    }
+    if (nobb > 0 && !fmt_compile_text(f, i, nobb)) goto failed;
+    i += nobb;
+    if (s[i] == '[') {
+      const ssize_t n = fmt_compile_tag(bb, f, i);
+      if (n < 0) goto failed;
+      i += n;
+    }
+    else if (s[i] == '\\') {
+      const bool escape = (s[i+1] == '\\' || s[i+1] == '[');
+      if (fmt_push(f, FMT_TEXT, (escape ? i+1 : i), 1) == NULL) goto failed;
+      i += (escape ? 2 : 1);
+    }
+  }
+  return f;
+
+failed:
+  bbcode_format_free(f);
+  return NULL;
+}
+
+static void fmt_value_get( fmt_arg_t arg, va_list* args, fmt_value_t* v ) {
+  switch (arg) {
+    case FMT_ARG_INT:     v->i   = va_arg(*args, int); break;
+    case FMT_ARG_UINT:    v->u   = va_arg(*args, unsigned int); break;
+    case FMT_ARG_LONG:    v->l   = va_arg(*args, long); break;
+    case FMT_ARG_ULONG:   v->ul  = va_arg(*args, unsigned long); break;
+    case FMT_ARG_LLONG:   v->ll  = va_arg(*args, long long); break;
+    case FMT_ARG_ULLONG:  v->ull = va_arg(*args, unsigned long long); break;
+    case FMT_ARG_INTMAX:  v->im  = va_arg(*args, intmax_t); break;
+    case FMT_ARG_UINTMAX: v->uim = va_arg(*args, uintmax_t); break;
+    case FMT_ARG_SIZE:    v->sz  = va_arg(*args, size_t); break;
+    case FMT_ARG_PTRDIFF: v->pd  = va_arg(*args, ptrdiff_t); break;
+    case FMT_ARG_DOUBLE:  v->d   = va_arg(*args, double); break;
+    case FMT_ARG_LDOUBLE: v->ld  = va_arg(*args, long double); break;
+    case FMT_ARG_STR:     
+    case FMT_ARG_PTR:     v->p   = va_arg(*args, const void*); break;
+  }
+}
+
+static int fmt_value_snprintf( char* buf, size_t size, const char* spec, fmt_arg_t arg, const fmt_value_t* v ) {
+  switch (arg) {
+    case FMT_ARG_INT:     return snprintf(buf, size, spec, v->i);
+    case FMT_ARG_UINT:    return snprintf(buf, size, spec, v->u);
+    case FMT_ARG_LONG:    return snprintf(buf, size, spec, v->l);
+    case FMT_ARG_ULONG:   return snprintf(buf, size, spec, v->ul);
+    case FMT_ARG_LLONG:   return snprintf(buf, size, spec, v->ll);
+    case FMT_ARG_ULLONG:  return snprintf(buf, size, spec, v->ull);
+    case FMT_ARG_INTMAX:  return snprintf(buf, size, spec, v->im);
+    case FMT_ARG_UINTMAX: return snprintf(buf, size, spec, v->uim);
+    case FMT_ARG_SIZE:    return snprintf(buf, size, spec, v->sz);
+    case FMT_ARG_PTRDIFF: return snprintf(buf, size, spec, v->pd);
+    case FMT_ARG_DOUBLE:  return snprintf(buf, size, spec, v->d);
+    case FMT_ARG_LDOUBLE: return snprintf(buf, size, spec, v->ld);
+    case FMT_ARG_STR:     return snprintf(buf, size, spec, (v->p == NULL ? "(null)" : (const char*)v->p));
+    case FMT_ARG_PTR:     return snprintf(buf, size, spec, v->p);
+  }
+  return -1;
+}
+
+// append the substitution of a directive
+static void bbcode_format_arg( bbcode_t* bb, const ic_format_t* f, const fmt_op_t* op, va_list* args, attr_t attr ) {
+  // copy the directive and substitute `*` width and precision arguments
+  char spec[FMT_DIRECTIVE_MAX + 2*16];
+  ssize_t n = 0;
+  for (ssize_t i = 0; i < op->len; i++) {
+    const char c = f->fmt[op->ofs + i];
+    if (c == '*') {
+      n += snprintf(spec + n, to_size_t(ssizeof(spec) - n), "%d", va_arg(*args, int));
+    }
+    else {
+      spec[n++] = c;
+    }
+  }
+  spec[n] = 0;
+  fmt_value_t v;
+  fmt_value_get(op->arg, args, &v);
+  if (op->arg == FMT_ARG_STR && op->len == 2) {
+    // plain `%s`
+    const char* str = (v.p == NULL ? "(null)" : (const char*)v.p);
+    attrbuf_append_n(bb->out, bb->out_attrs, str, ic_strlen(str), attr);
+    return;
+  }
+  char buf[128];
+  const int needed = fmt_value_snprintf(buf, sizeof(buf), spec, op->arg, &v);
+  if (needed < 0) return;
+  if (needed < ssizeof(buf)) {
+    attrbuf_append_n(bb->out, bb->out_attrs, buf, needed, attr);
+  }
+  else {
+    char* large = mem_malloc_tp_n(bb->mem, char, needed + 1);
+    if (large == NULL) return;
+    fmt_value_snprintf(large, to_size_t(needed + 1), spec, op->arg, &v);
+    attrbuf_append_n(bb->out, bb->out_attrs, large, needed, attr);
+    mem_free(bb->mem, large);
+  }
+}
+
+ic_private void bbcode_format_vprint( bbcode_t* bb, const ic_format_t* f, va_list args ) {
+  if (f == NULL || bb->out == NULL || bb->out_attrs == NULL) return;
+  assert(sbuf_len(bb->out) == 0 && attrbuf_len(bb->out_attrs) == 0);
+  va_list ap;
+  va_copy(ap, args);
+  attr_t attr = attr_none();
+  const ssize_t base = bb->tags_nesting; // base; will not be popped
+  for (ssize_t i = 0; i < f->count; i++) {
+    const fmt_op_t* op = &f->ops[i];
+    switch (op->kind) {
+      case FMT_TEXT:  attrbuf_append_n(bb->out, bb->out_attrs, f->fmt + op->ofs, op->len, attr); break;
+      case FMT_ARG:   bbcode_format_arg(bb, f, op, &ap, attr); break;
+      case FMT_OPEN:  attr = bbcode_open(bb, sbuf_len(bb->out), &op->tag, attr); break;
+      case FMT_CLOSE: bbcode_close_restrict(bb, base, op->tag.name, bb->out, bb->out_attrs, &attr); break;
+    }
+  }
+  va_end(ap);
+  // pop unclosed openings
+  assert(bb->tags_nesting >= base);
+  while( bb->tags_nesting > base ) {
+    bbcode_tag_pop(bb,NULL);
+  };
+  bbcode_flush(bb);
+}
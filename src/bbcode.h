@@ -24,6 +24,10 @@ ic_private void bbcode_style_open( bbcode_t* bb, const char* fmt );
 ic_private void bbcode_style_close( bbcode_t* bb, const char* fmt );
 ic_private attr_t bbcode_style( bbcode_t* bb, const char* style_name );
 
+// style handles are > 0 and stay valid for the lifetime of `bb`.
+ic_private ssize_t bbcode_style_lookup( bbcode_t* bb, const char* style_name );
+ic_private attr_t bbcode_style_at( bbcode_t* bb, ssize_t handle );
+
 ic_private void bbcode_print( bbcode_t* bb, const char* s );
 ic_private void bbcode_println( bbcode_t* bb, const char* s );
 ic_private void bbcode_printf( bbcode_t* bb, const char* fmt, ... );
@@ -34,4 +38,8 @@ ic_private ssize_t bbcode_column_width( bbcode_t* bb, const char* s );
 // allows `attr_out == NULL`.
 ic_private void bbcode_append( bbcode_t* bb, const char* s, stringbuf_t* out, attrbuf_t* attr_out );
 
+ic_private ic_format_t* bbcode_format_compile( bbcode_t* bb, const char* fmt );
+ic_private void bbcode_format_free( ic_format_t* f );
+ic_private void bbcode_format_vprint( bbcode_t* bb, const ic_format_t* f, va_list args );
+
 #endif // IC_BBCODE_H
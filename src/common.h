@@ -71,6 +71,46 @@ ic_private int     ic_stricmp(const char* s1, const char* s2);
 ic_private int     ic_strnicmp(const char* s1, const char* s2, ssize_t n);
 
 
+//-------------------------------------------------------------
+// Atomic pointer operations (for data shared between threads)
+// and relaxed loads/stores (for self-contained cache entries)
+//-------------------------------------------------------------
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+static inline void* ic_atomic_load_ptr(void* volatile* p) { 
+  return *p;  // volatile loads have acquire semantics on msvc
+}
+static inline void* ic_atomic_exchange_ptr(void* volatile* p, void* x) { 
+  return _InterlockedExchangePointer(p, x); 
+}
+static inline bool ic_atomic_cas_ptr(void* volatile* p, void** expected, void* desired) {
+  void* prev = _InterlockedCompareExchangePointer(p, desired, *expected);
+  if (prev == *expected) return true;
+  *expected = prev;
+  return false;
+}
+static inline uint8_t  ic_atomic_load_relaxed_u8(uint8_t volatile* p)             { return *p; }
+static inline void     ic_atomic_store_relaxed_u8(uint8_t volatile* p, uint8_t x)  { *p = x; }
+static inline uint32_t ic_atomic_load_relaxed_u32(uint32_t volatile* p)            { return *p; }
+static inline void     ic_atomic_store_relaxed_u32(uint32_t volatile* p, uint32_t x) { *p = x; }
+#else
+static inline void* ic_atomic_load_ptr(void* volatile* p) { 
+  return __atomic_load_n(p, __ATOMIC_ACQUIRE); 
+}
+static inline void* ic_atomic_exchange_ptr(void* volatile* p, void* x) { 
+  return __atomic_exchange_n(p, x, __ATOMIC_ACQ_REL); 
+}
+static inline bool ic_atomic_cas_ptr(void* volatile* p, void** expected, void* desired) {
+  return __atomic_compare_exchange_n(p, expected, desired, true /* weak */, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+static inline uint8_t  ic_atomic_load_relaxed_u8(uint8_t volatile* p)             { return __atomic_load_n(p, __ATOMIC_RELAXED); }
+static inline void     ic_atomic_store_relaxed_u8(uint8_t volatile* p, uint8_t x)  { __atomic_store_n(p, x, __ATOMIC_RELAXED); }
+static inline uint32_t ic_atomic_load_relaxed_u32(uint32_t volatile* p)            { return __atomic_load_n(p, __ATOMIC_RELAXED); }
+static inline void     ic_atomic_store_relaxed_u32(uint32_t volatile* p, uint32_t x) { __atomic_store_n(p, x, __ATOMIC_RELAXED); }
+#endif
+
+
 
 //---------------------------------------------------------------------
 // Unicode
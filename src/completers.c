@@ -28,10 +28,10 @@ typedef struct word_closure_s {
 
 
 // word completion callback
-static bool token_add_completion_ex(ic_env_t* env, void* closure, const char* replacement, const char* display, const char* help, long delete_before, long delete_after) {
+static bool token_add_completion_ex(ic_env_t* env, void* closure, const char* replacement, const char* display, const char* help, long delete_before, long delete_after, long score) {
   word_closure_t* wenv = (word_closure_t*)(closure);
   // call the previous completer with an adjusted delete-before
-  return (*wenv->prev_complete)(env, wenv->prev_env, replacement, display, help, wenv->delete_before_adjust + delete_before, delete_after);
+  return (*wenv->prev_complete)(env, wenv->prev_env, replacement, display, help, wenv->delete_before_adjust + delete_before, delete_after, score);
 }
 
 
@@ -91,7 +91,7 @@ typedef struct qword_closure_s {
 
 // word completion callback
 static bool qword_add_completion_ex(ic_env_t* env, void* closure, const char* replacement, const char* display, const char* help, 
-                                       long delete_before, long delete_after) {
+                                       long delete_before, long delete_after, long score) {
   qword_closure_t* wenv = (qword_closure_t*)(closure);
   sbuf_replace( wenv->sbuf, replacement );   
   if (wenv->quote != 0) {
@@ -112,7 +112,7 @@ static bool qword_add_completion_ex(ic_env_t* env, void* closure, const char* re
     }
   }
   // and call the previous completion function
-  return (*wenv->prev_complete)( env, wenv->prev_env, sbuf_string(wenv->sbuf), display, help, wenv->delete_before_adjust + delete_before, delete_after );  
+  return (*wenv->prev_complete)( env, wenv->prev_env, sbuf_string(wenv->sbuf), display, help, wenv->delete_before_adjust + delete_before, delete_after, score );  
 }
 
 
@@ -261,6 +261,7 @@ ic_public void ic_complete_qword_ex( ic_completion_env_t* cenv, const char* pref
 // Listing files
 //-------------------------------------------------------------
 #include <stdlib.h>
+#include <time.h>
 
 typedef enum file_type_e {
   // must follow BSD style LSCOLORS order
@@ -377,12 +378,6 @@ static void ls_colorize(bool no_lscolor, stringbuf_t* sb, file_type_t ft, const
 #include <io.h>
 #include <sys/stat.h>
 
-static bool os_is_dir(const char* cpath) {
-  struct _stat64 st = { 0 };
-  _stat64(cpath, &st);
-  return ((st.st_mode & _S_IFDIR) != 0);
-}
-
 static file_type_t os_get_filetype(const char* cpath) {
   struct _stat64 st = { 0 };
   _stat64(cpath, &st);
@@ -393,6 +388,13 @@ static file_type_t os_get_filetype(const char* cpath) {
   return FT_DEFAULT;
 }
 
+static bool os_get_mtime(const char* cpath, time_t* mtime) {
+  struct _stat64 st = { 0 };
+  if (_stat64(cpath, &st) != 0) return false;
+  *mtime = (time_t)st.st_mtime;
+  return true;
+}
+
 
 #define dir_cursor intptr_t
 #define dir_entry  struct __finddata64_t
@@ -419,6 +421,15 @@ static const char* os_direntry_name(dir_entry* entry) {
   return entry->name;  
 }
 
+// Get the file type of an entry from its attributes; returns `true` if `ft` is precise, 
+// and `false` if it still needs `os_get_filetype` for coloring (see `dir_item_resolve`).
+static bool os_direntry_filetype(dir_cursor d, dir_entry* entry, file_type_t* ft, bool* isdir) {
+  ic_unused(d);
+  *isdir = ((entry->attrib & _A_SUBDIR) != 0);
+  *ft = (*isdir ? FT_DIR : FT_DEFAULT);
+  return *isdir;
+}
+
 static bool os_path_is_absolute( const char* path ) {
   if (path != NULL && path[0] != 0 && path[1] == ':' && (path[2] == '\\' || path[2] == '/' || path[2] == 0)) {
     char drive = path[0];
@@ -436,19 +447,10 @@ ic_private char ic_dirsep(void) {
 #include <sys/stat.h>
 #include <dirent.h>
 #include <errno.h>
+#include <fcntl.h>   // AT_SYMLINK_NOFOLLOW
 
-static bool os_is_dir(const char* cpath) {
-  struct stat st;
-  memset(&st, 0, sizeof(st));
-  stat(cpath, &st);
-  return (S_ISDIR(st.st_mode));
-}
-
-static file_type_t os_get_filetype(const char* cpath) {
-  struct stat st;
-  memset(&st, 0, sizeof(st));
-  lstat(cpath, &st);
-  switch ((st.st_mode)&S_IFMT) {
+static file_type_t os_get_filetype_from_mode(mode_t mode) {
+  switch (mode & S_IFMT) {
     case S_IFSOCK: return FT_SOCK;
     case S_IFLNK: {
       return FT_SYM;
@@ -457,21 +459,36 @@ static file_type_t os_get_filetype(const char* cpath) {
     case S_IFCHR:  return FT_CHAR;
     case S_IFBLK:  return FT_BLOCK;
     case S_IFDIR: {
-      if ((st.st_mode & S_ISUID) != 0) return FT_SETUID;
-      if ((st.st_mode & S_ISGID) != 0) return FT_SETGID;
-      if ((st.st_mode & S_IWGRP) != 0 && (st.st_mode & S_ISVTX) != 0) return FT_DIR_OW_STICKY;
-      if ((st.st_mode & S_IWGRP)) return FT_DIR_OW;
-      if ((st.st_mode & S_ISVTX)) return FT_DIR_STICKY;
+      if ((mode & S_ISUID) != 0) return FT_SETUID;
+      if ((mode & S_ISGID) != 0) return FT_SETGID;
+      if ((mode & S_IWGRP) != 0 && (mode & S_ISVTX) != 0) return FT_DIR_OW_STICKY;
+      if ((mode & S_IWGRP)) return FT_DIR_OW;
+      if ((mode & S_ISVTX)) return FT_DIR_STICKY;
       return FT_DIR;
     }
     case S_IFREG:
     default: {
-      if ((st.st_mode & S_IXUSR) != 0) return FT_EXE;
+      if ((mode & S_IXUSR) != 0) return FT_EXE;
       return FT_DEFAULT;
     }
   }  
 }
 
+static file_type_t os_get_filetype(const char* cpath) {
+  struct stat st;
+  memset(&st, 0, sizeof(st));
+  if (lstat(cpath, &st) != 0) return FT_DEFAULT;
+  return os_get_filetype_from_mode(st.st_mode);
+}
+
+static bool os_get_mtime(const char* cpath, time_t* mtime) {
+  struct stat st;
+  memset(&st, 0, sizeof(st));
+  if (stat(cpath, &st) != 0) return false;
+  *mtime = st.st_mtime;
+  return true;
+}
+
 
 #define dir_cursor DIR*
 #define dir_entry  struct dirent*
@@ -500,6 +517,41 @@ static const char* os_direntry_name(dir_entry* entry) {
   return (*entry)->d_name;  
 }
 
+// Get the file type of an entry; returns `true` if `ft` is precise, and `false` if it 
+// still needs the mode bits for coloring (see `dir_item_resolve`).
+// We use `d_type` if possible; only if the type is unknown or a symbolic link, we `fstatat` 
+// relative to the directory. The mode bits of regular files and directories (executable,
+// sticky etc.) are only looked up later for the entries that match the completion prefix.
+static bool os_direntry_filetype(dir_cursor d, dir_entry* entry, file_type_t* ft, bool* isdir) {
+  const char* name = (*entry)->d_name;
+  #if defined(DT_UNKNOWN)
+  const unsigned char dtype = (*entry)->d_type;
+  if (dtype != DT_UNKNOWN && dtype != DT_LNK) {
+    *isdir = (dtype == DT_DIR);
+    switch (dtype) {
+      case DT_DIR:  *ft = FT_DIR; break;
+      case DT_SOCK: *ft = FT_SOCK; break;
+      case DT_FIFO: *ft = FT_PIPE; break;
+      case DT_CHR:  *ft = FT_CHAR; break;
+      case DT_BLK:  *ft = FT_BLOCK; break;
+      default:      *ft = FT_DEFAULT; break;
+    }
+    return (dtype != DT_DIR && dtype != DT_REG);
+  }
+  #endif
+  struct stat st;
+  memset(&st, 0, sizeof(st));
+  fstatat(dirfd(d), name, &st, AT_SYMLINK_NOFOLLOW);
+  *ft = os_get_filetype_from_mode(st.st_mode);
+  if (S_ISLNK(st.st_mode)) {
+    // follow the link to see if it is a directory
+    memset(&st, 0, sizeof(st));
+    fstatat(dirfd(d), name, &st, 0);
+  }
+  *isdir = S_ISDIR(st.st_mode);
+  return true;
+}
+
 static bool os_path_is_absolute( const char* path ) {
   return (path != NULL && path[0] == '/');
 }
@@ -511,6 +563,356 @@ ic_private char ic_dirsep(void) {
 
 
 
+//-------------------------------------------------------------
+// Directory listing cache
+// Filename completion runs on every hint refresh so we cache
+// the listing (names and file types) of recently completed 
+// directories. A listing is valid as long as the modification
+// time of the directory is unchanged; this costs a single 
+// `stat` instead of reading and `stat`ing every entry. 
+// The mode bits for coloring are looked up lazily, only for
+// the entries that match a completion, and are then cached too.
+// (Changes to the file type of an entry (like `chmod +x`) do 
+//  not update the directory time and may show stale colors)
+//-------------------------------------------------------------
+
+#define IC_DIRCACHE_MAX  (32)    // maximal number of cached directories
+
+typedef struct dir_item_s {
+  ssize_t      name_ofs;         // offset of the name in `names`
+  file_type_t  ft;
+  bool         isdir;
+  bool         precise;          // is `ft` precise? or do we still need the mode bits (see `dir_item_resolve`)
+} dir_item_t;
+
+typedef struct dir_listing_s {
+  char*        path;             // directory path (NULL if the slot is unused)
+  time_t       mtime;            // modification time of the directory when it was listed
+  time_t       listed;           // time of listing
+  uint64_t     last_used;        // for LRU eviction
+  ssize_t      count;
+  ssize_t      len;
+  dir_item_t*  items;
+  char*        names;            // all names, each 0 terminated
+  ssize_t      names_count;
+  ssize_t      names_len;
+} dir_listing_t;
+
+struct dircache_s {
+  alloc_t*      mem;
+  uint64_t      ticks;
+  dir_listing_t listings[IC_DIRCACHE_MAX];
+};
+
+static void dir_listing_clear(alloc_t* mem, dir_listing_t* dl) {
+  mem_free(mem, dl->path);
+  mem_free(mem, dl->items);
+  mem_free(mem, dl->names);
+  memset(dl, 0, sizeof(*dl));
+}
+
+static bool dir_listing_push(alloc_t* mem, dir_listing_t* dl, const char* name, file_type_t ft, bool isdir, bool precise) {
+  ssize_t nlen = ic_strlen(name) + 1;
+  if (dl->names_count + nlen > dl->names_len) {
+    ssize_t newlen = (dl->names_len <= 0 ? 1024 : 2*dl->names_len);
+    while (newlen < dl->names_count + nlen) { newlen *= 2; }
+    char* newnames = mem_realloc_tp(mem, char, dl->names, newlen);
+    if (newnames == NULL) return false;
+    dl->names = newnames;
+    dl->names_len = newlen;
+  }
+  if (dl->count >= dl->len) {
+    ssize_t newlen = (dl->len <= 0 ? 64 : 2*dl->len);
+    dir_item_t* newitems = mem_realloc_tp(mem, dir_item_t, dl->items, newlen);
+    if (newitems == NULL) return false;
+    dl->items = newitems;
+    dl->len = newlen;
+  }
+  dir_item_t* item = &dl->items[dl->count++];
+  item->name_ofs = dl->names_count;
+  item->ft       = ft;
+  item->isdir    = isdir;
+  item->precise  = precise;
+  ic_memcpy(dl->names + dl->names_count, name, nlen);
+  dl->names_count += nlen;
+  return true;
+}
+
+typedef struct dir_scan_s dir_scan_t;
+static bool dir_scan_cancelled(dir_scan_t* scan);
+
+// read the directory `path` into `dl` (which must be cleared); stops early if the `scan` is cancelled.
+static bool dir_listing_read(alloc_t* mem, const char* path, dir_listing_t* dl, dir_scan_t* scan) {
+  bool ok = true;
+  dir_cursor d = 0;
+  dir_entry entry;
+  if (os_findfirst(mem, path, &d, &entry)) {
+    do {
+      const char* name = os_direntry_name(&entry);
+      if (name != NULL && strcmp(name, ".") != 0 && strcmp(name, "..") != 0) {
+        file_type_t ft;
+        bool isdir;
+        const bool precise = os_direntry_filetype(d, &entry, &ft, &isdir);
+        ok = dir_listing_push(mem, dl, name, ft, isdir, precise);
+        if (ok && (dl->count % 64) == 0 && dir_scan_cancelled(scan)) { ok = false; }
+      }
+    } while (ok && os_findnext(d, &entry));
+    os_findclose(d);
+  }
+  return ok;
+}
+
+// look up the precise file type of an item (with the mode bits) for coloring
+static void dir_item_resolve(const dir_listing_t* dl, dir_item_t* item, stringbuf_t* fpath) {
+  if (item->precise) return;
+  sbuf_clear(fpath);
+  sbuf_append(fpath, dl->path);
+  sbuf_append_char(fpath, ic_dirsep());
+  sbuf_append(fpath, dl->names + item->name_ofs);
+  item->ft = os_get_filetype(sbuf_string(fpath));
+  item->precise = true;
+}
+
+ic_private void dircache_free(dircache_t* dc) {
+  if (dc == NULL) return;
+  for (ssize_t i = 0; i < IC_DIRCACHE_MAX; i++) {
+    dir_listing_clear(dc->mem, &dc->listings[i]);
+  }
+  mem_free(dc->mem, dc);
+}
+
+static dircache_t* dircache_get(ic_env_t* env) {
+  if (env->dircache == NULL) {
+    env->dircache = mem_zalloc_tp(env->mem, dircache_t);
+    if (env->dircache == NULL) return NULL;
+    env->dircache->mem = env->mem;
+  }
+  return env->dircache;
+}
+
+static dir_listing_t* dircache_find(dircache_t* dc, const char* path) {
+  if (dc == NULL) return NULL;
+  for (ssize_t i = 0; i < IC_DIRCACHE_MAX; i++) {
+    dir_listing_t* dl = &dc->listings[i];
+    if (dl->path != NULL && strcmp(dl->path, path) == 0) return dl;
+  }
+  return NULL;
+}
+
+// valid if unchanged, and not modified in the same second as it was listed (as the time is not precise enough)
+static bool dir_listing_is_valid(const dir_listing_t* dl, time_t mtime) {
+  return (dl->mtime == mtime && dl->mtime < dl->listed);
+}
+
+
+//-------------------------------------------------------------
+// Threads
+//-------------------------------------------------------------
+
+#if defined(IC_NO_THREADS)
+typedef int ic_thread_t;
+typedef int ic_mutex_t;
+typedef int ic_cond_t;
+static void ic_mutex_init(ic_mutex_t* m)    { ic_unused(m); }
+static void ic_mutex_done(ic_mutex_t* m)    { ic_unused(m); }
+static void ic_mutex_lock(ic_mutex_t* m)    { ic_unused(m); }
+static void ic_mutex_unlock(ic_mutex_t* m)  { ic_unused(m); }
+static void ic_cond_init(ic_cond_t* c)      { ic_unused(c); }
+static void ic_cond_done(ic_cond_t* c)      { ic_unused(c); }
+static void ic_cond_wait(ic_cond_t* c, ic_mutex_t* m) { ic_unused(c); ic_unused(m); assert(false); }
+static void ic_cond_broadcast(ic_cond_t* c) { ic_unused(c); }
+#elif defined(_WIN32)
+#include <windows.h>
+typedef HANDLE             ic_thread_t;
+typedef SRWLOCK            ic_mutex_t;
+typedef CONDITION_VARIABLE ic_cond_t;
+static void ic_mutex_init(ic_mutex_t* m)    { InitializeSRWLock(m); }
+static void ic_mutex_done(ic_mutex_t* m)    { ic_unused(m); }
+static void ic_mutex_lock(ic_mutex_t* m)    { AcquireSRWLockExclusive(m); }
+static void ic_mutex_unlock(ic_mutex_t* m)  { ReleaseSRWLockExclusive(m); }
+static void ic_cond_init(ic_cond_t* c)      { InitializeConditionVariable(c); }
+static void ic_cond_done(ic_cond_t* c)      { ic_unused(c); }
+static void ic_cond_wait(ic_cond_t* c, ic_mutex_t* m) { SleepConditionVariableSRW(c, m, INFINITE, 0); }
+static void ic_cond_broadcast(ic_cond_t* c) { WakeAllConditionVariable(c); }
+#else
+#include <pthread.h>
+typedef pthread_t          ic_thread_t;
+typedef pthread_mutex_t    ic_mutex_t;
+typedef pthread_cond_t     ic_cond_t;
+static void ic_mutex_init(ic_mutex_t* m)    { pthread_mutex_init(m, NULL); }
+static void ic_mutex_done(ic_mutex_t* m)    { pthread_mutex_destroy(m); }
+static void ic_mutex_lock(ic_mutex_t* m)    { pthread_mutex_lock(m); }
+static void ic_mutex_unlock(ic_mutex_t* m)  { pthread_mutex_unlock(m); }
+static void ic_cond_init(ic_cond_t* c)      { pthread_cond_init(c, NULL); }
+static void ic_cond_done(ic_cond_t* c)      { pthread_cond_destroy(c); }
+static void ic_cond_wait(ic_cond_t* c, ic_mutex_t* m) { pthread_cond_wait(c, m); }
+static void ic_cond_broadcast(ic_cond_t* c) { pthread_cond_broadcast(c); }
+#endif
+
+
+//-------------------------------------------------------------
+// Concurrent directory scanning
+// When completing relative to multiple roots (like a PATH), 
+// the directories are listed concurrently by a small number of
+// worker threads while the main thread merges the results in 
+// root order. Only the main thread adds completions and 
+// updates the cache (after all workers are done).
+// The main thread first checks the cached listings; workers are
+// only started if more than one directory needs to be (re)listed.
+//-------------------------------------------------------------
+
+#define IC_DIRSCAN_THREADS  (8)   // maximal number of worker threads
+
+typedef struct dir_job_s {
+  const char*          path;      // directory to list
+  dir_listing_t*       cached;    // cached listing (only used by the main thread), or NULL
+  dir_listing_t        fresh;     // the new listing if there was no valid cached one
+  time_t               mtime;     // modification time of the directory
+  bool                 exists;    // does the directory exist?
+  bool                 incomplete;// was the listing cancelled (or did it fail)?
+  bool                 done;      // (protected by the scan lock)
+} dir_job_t;
+
+struct dir_scan_s {
+  alloc_t*    mem;
+  dir_job_t*  jobs;
+  ssize_t     count;
+  ssize_t     next;               // next job to start (protected by `lock`)
+  bool        cancel;             // stop scanning? (protected by `lock`)
+  ic_mutex_t  lock;
+  ic_cond_t   job_done;
+};
+
+static bool dir_scan_cancelled(dir_scan_t* scan) {
+  ic_mutex_lock(&scan->lock);
+  bool cancel = scan->cancel;
+  ic_mutex_unlock(&scan->lock);
+  return cancel;
+}
+
+// check the directory against the cache (before any workers start); returns `true` if it needs to be listed
+static bool dir_job_prepare(dir_job_t* job) {
+  job->exists = os_get_mtime(job->path, &job->mtime);
+  job->done = (!job->exists || (job->cached != NULL && dir_listing_is_valid(job->cached, job->mtime)));
+  return !job->done;
+}
+
+static void dir_job_run(dir_scan_t* scan, dir_job_t* job) {
+  job->fresh.listed = time(NULL);
+  if (!dir_listing_read(scan->mem, job->path, &job->fresh, scan) || 
+      (job->fresh.path = mem_strdup(scan->mem, job->path)) == NULL) 
+  {
+    dir_listing_clear(scan->mem, &job->fresh);
+    job->incomplete = true;  // keep any cached listing as is
+    return;
+  }
+  job->fresh.mtime = job->mtime;
+}
+
+static dir_listing_t* dir_job_listing(dir_job_t* job) {
+  if (!job->exists || job->incomplete) return NULL;
+  return (job->fresh.path != NULL ? &job->fresh : job->cached);
+}
+
+// run jobs until there are none left (or we are cancelled)
+static void dir_scan_work(dir_scan_t* scan) {
+  ic_mutex_lock(&scan->lock);
+  while (!scan->cancel && scan->next < scan->count) {
+    dir_job_t* job = &scan->jobs[scan->next++];
+    if (job->done) continue;  // cached
+    ic_mutex_unlock(&scan->lock);
+    dir_job_run(scan, job);
+    ic_mutex_lock(&scan->lock);
+    job->done = true;
+    ic_cond_broadcast(&scan->job_done);
+  }
+  ic_mutex_unlock(&scan->lock);
+}
+
+#if defined(IC_NO_THREADS)
+static bool dir_scan_thread_start(ic_thread_t* t, dir_scan_t* scan) {
+  ic_unused(t); ic_unused(scan);
+  return false;
+}
+static void dir_scan_thread_join(ic_thread_t t) {
+  ic_unused(t);
+}
+#elif defined(_WIN32)
+static DWORD WINAPI dir_scan_thread(LPVOID arg) {
+  dir_scan_work((dir_scan_t*)arg);
+  return 0;
+}
+static bool dir_scan_thread_start(ic_thread_t* t, dir_scan_t* scan) {
+  *t = CreateThread(NULL, 0, &dir_scan_thread, scan, 0, NULL);
+  return (*t != NULL);
+}
+static void dir_scan_thread_join(ic_thread_t t) {
+  WaitForSingleObject(t, INFINITE);
+  CloseHandle(t);
+}
+#else
+static void* dir_scan_thread(void* arg) {
+  dir_scan_work((dir_scan_t*)arg);
+  return NULL;
+}
+static bool dir_scan_thread_start(ic_thread_t* t, dir_scan_t* scan) {
+  return (pthread_create(t, NULL, &dir_scan_thread, scan) == 0);
+}
+static void dir_scan_thread_join(ic_thread_t t) {
+  pthread_join(t, NULL);
+}
+#endif
+
+// wait for job `i` to be done; if no worker started it yet, we run it ourselves.
+static void dir_scan_wait(dir_scan_t* scan, ssize_t i) {
+  ic_mutex_lock(&scan->lock);
+  if (scan->next <= i && !scan->jobs[i].done) {
+    // (any jobs in between were done from the cache)
+    scan->next = i + 1;
+    ic_mutex_unlock(&scan->lock);
+    dir_job_run(scan, &scan->jobs[i]);
+    ic_mutex_lock(&scan->lock);
+    scan->jobs[i].done = true;
+  }
+  while (!scan->jobs[i].done) {
+    ic_cond_wait(&scan->job_done, &scan->lock);
+  }
+  ic_mutex_unlock(&scan->lock);
+}
+
+// update the cache with the result of a job
+static void dircache_update(dircache_t* dc, alloc_t* mem, dir_job_t* job) {
+  if (dc == NULL) {
+    dir_listing_clear(mem, &job->fresh);
+    return;
+  }
+  dc->ticks++;
+  dir_listing_t* dl = dircache_find(dc, job->path);
+  if (job->incomplete) {
+    // leave the cache alone
+  }
+  else if (!job->exists) {
+    if (dl != NULL) { dir_listing_clear(dc->mem, dl); }
+  }
+  else if (job->fresh.path != NULL) {
+    if (dl == NULL) {
+      // evict the least recently used
+      dl = &dc->listings[0];
+      for (ssize_t i = 1; i < IC_DIRCACHE_MAX; i++) {
+        if (dc->listings[i].last_used < dl->last_used) { dl = &dc->listings[i]; }
+      }
+    }
+    dir_listing_clear(dc->mem, dl);
+    *dl = job->fresh;
+    memset(&job->fresh, 0, sizeof(job->fresh));
+    dl->last_used = dc->ticks;
+  }
+  else if (dl != NULL) {
+    dl->last_used = dc->ticks;
+  }
+}
+
+
 //-------------------------------------------------------------
 // File completion 
 //-------------------------------------------------------------
@@ -548,50 +950,90 @@ static bool match_extension(const char* name, const char* extensions) {
   return false;
 }
 
-static bool filename_complete_indir( ic_completion_env_t* cenv, stringbuf_t* dir, 
+static bool filename_complete_indir( ic_completion_env_t* cenv, dir_listing_t* dl, bool with_mode,
                                       stringbuf_t* dir_prefix, stringbuf_t* display,
                                        const char* base_prefix, 
                                         char dir_sep, const char* extensions ) 
 {
-  dir_cursor d = 0;
-  dir_entry entry;
   bool cont = true;
-  if (os_findfirst(cenv->env->mem, sbuf_string(dir), &d, &entry)) {
-    do {
-      const char* name = os_direntry_name(&entry);
-      if (name != NULL && strcmp(name, ".") != 0 && strcmp(name, "..") != 0 && 
-          ic_istarts_with(name, base_prefix))
-      {
-        // possible match, first check if it is a directory
-        file_type_t ft;
-        bool isdir;
-        const ssize_t plen = sbuf_len(dir_prefix);
-        sbuf_append(dir_prefix, name);
-        { // check directory and potentially add a dirsep to the dir_prefix
-          const ssize_t dlen = sbuf_len(dir);
-          sbuf_append_char(dir,ic_dirsep());
-          sbuf_append(dir,name);
-          ft = os_get_filetype(sbuf_string(dir));
-          isdir = os_is_dir(sbuf_string(dir));
-          if (isdir && dir_sep != 0) {
-            sbuf_append_char(dir_prefix,dir_sep); 
-          }
-          sbuf_delete_from(dir,dlen);  // restore dir
-        }
-        if (isdir || match_extension(name, extensions)) {
-          // add completion
-          sbuf_clear(display);
-          ls_colorize(cenv->env->no_lscolors, display, ft, name, NULL, (isdir ? dir_sep : 0));
-          cont = ic_add_completion_ex(cenv, sbuf_string(dir_prefix), sbuf_string(display), NULL);
-        }
-        sbuf_delete_from( dir_prefix, plen ); // restore dir_prefix
+  for (ssize_t i = 0; cont && i < dl->count; i++) {
+    dir_item_t* item = &dl->items[i];
+    const char* name = dl->names + item->name_ofs;
+    if (ic_istarts_with(name, base_prefix)) {
+      // possible match, potentially add a dirsep to the dir_prefix
+      const ssize_t plen = sbuf_len(dir_prefix);
+      sbuf_append(dir_prefix, name);
+      if (item->isdir && dir_sep != 0) {
+        sbuf_append_char(dir_prefix,dir_sep); 
       }
-    } while (cont && os_findnext(d, &entry));
-    os_findclose(d);
+      if (item->isdir || match_extension(name, extensions)) {
+        // add completion
+        if (with_mode) { dir_item_resolve(dl, item, display); }
+        sbuf_clear(display);
+        ls_colorize(cenv->env->no_lscolors, display, item->ft, name, NULL, (item->isdir ? dir_sep : 0));
+        cont = ic_add_completion_ex(cenv, sbuf_string(dir_prefix), sbuf_string(display), NULL);
+      }
+      sbuf_delete_from( dir_prefix, plen ); // restore dir_prefix
+    }
   }
   return cont;
 }
 
+// complete in all directories of `jobs` (in order)
+static void filename_complete_dirs( ic_completion_env_t* cenv, dir_job_t* jobs, ssize_t count,
+                                     stringbuf_t* dir_prefix, stringbuf_t* display,
+                                      const char* base_prefix, 
+                                       char dir_sep, const char* extensions ) 
+{
+  ic_env_t* env = cenv->env;
+  dircache_t* dc = dircache_get(env);
+  dir_scan_t scan;
+  memset(&scan, 0, sizeof(scan));
+  scan.mem       = env->mem;
+  scan.jobs      = jobs;
+  scan.count     = count;
+  const bool with_mode = (!env->no_lscolors && ls_colors_init());
+  ic_mutex_init(&scan.lock);
+  ic_cond_init(&scan.job_done);
+  ssize_t stale = 0;
+  for (ssize_t i = 0; i < count; i++) {
+    jobs[i].cached = dircache_find(dc, jobs[i].path);
+    if (dir_job_prepare(&jobs[i])) { stale++; }
+  }
+
+  // start workers if more than one directory needs to be listed
+  ic_thread_t threads[IC_DIRSCAN_THREADS];
+  ssize_t nthreads = 0;
+  while (nthreads < stale - 1 && nthreads < IC_DIRSCAN_THREADS) {
+    if (!dir_scan_thread_start(&threads[nthreads], &scan)) break;
+    nthreads++;
+  }
+
+  // merge the results in order
+  bool cont = true;
+  for (ssize_t i = 0; cont && i < count; i++) {
+    dir_scan_wait(&scan, i);
+    dir_listing_t* dl = dir_job_listing(&jobs[i]);
+    if (dl != NULL) {
+      cont = filename_complete_indir(cenv, dl, with_mode, dir_prefix, display, base_prefix, dir_sep, extensions);
+    }
+  }
+  
+  // cancel remaining work, and update the cache
+  ic_mutex_lock(&scan.lock);
+  scan.cancel = true;
+  ic_mutex_unlock(&scan.lock);
+  for (ssize_t t = 0; t < nthreads; t++) {
+    dir_scan_thread_join(threads[t]);
+  }
+  for (ssize_t i = 0; i < count; i++) {
+    if (jobs[i].done) { dircache_update(dc, env->mem, &jobs[i]); }
+    dir_listing_clear(env->mem, &jobs[i].fresh);
+  }
+  ic_cond_done(&scan.job_done);
+  ic_mutex_done(&scan.lock);
+}
+
 typedef struct filename_closure_s {
   const char* roots;
   const char* extensions;
@@ -623,15 +1065,25 @@ static void filename_completer( ic_completion_env_t* cenv, const char* prefix )
       if (base != NULL) {
         sbuf_append_n( root_dir, prefix, (base - prefix));  // include dir separator
       }
-      filename_complete_indir( cenv, root_dir, dir_prefix, display,  
-                                (base != NULL ? base : prefix), 
-                                 fclosure->dir_sep, fclosure->extensions );   
+      dir_job_t job;
+      memset(&job, 0, sizeof(job));
+      job.path = sbuf_string(root_dir);
+      filename_complete_dirs( cenv, &job, 1, dir_prefix, display,  
+                               (base != NULL ? base : prefix), 
+                                fclosure->dir_sep, fclosure->extensions );   
     }
     else {
       // relative path, complete with respect to every root.
+      ssize_t count = 1;
+      for (const char* r = fclosure->roots; r != NULL && *r != 0; r++) {
+        if (*r == ';') count++;
+      }
+      dir_job_t* jobs = mem_zalloc_tp_n(cenv->env->mem, dir_job_t, count);
+      if (jobs == NULL) count = 0;
+      ssize_t i = 0;
       const char* next;
       const char* root = fclosure->roots;
-      while ( root != NULL ) {
+      while ( root != NULL && i < count ) {
         // create full root in `root_dir`
         sbuf_clear(root_dir);
         next = strchr(root,';');
@@ -650,11 +1102,18 @@ static void filename_completer( ic_completion_env_t* cenv, const char* prefix )
           sbuf_append_n( root_dir, prefix, (base - prefix) - 1);
         }
 
-        // and complete in this directory    
-        filename_complete_indir( cenv, root_dir, dir_prefix, display,
-                                  (base != NULL ? base : prefix), 
-                                   fclosure->dir_sep, fclosure->extensions);
+        const char* path = mem_strdup(cenv->env->mem, sbuf_string(root_dir));
+        if (path != NULL) { jobs[i++].path = path; }
+      }
+
+      // and complete in these directories
+      filename_complete_dirs( cenv, jobs, i, dir_prefix, display,
+                               (base != NULL ? base : prefix), 
+                                fclosure->dir_sep, fclosure->extensions);
+      for (ssize_t j = 0; j < i; j++) {
+        mem_free(cenv->env->mem, jobs[j].path);
       }
+      mem_free(cenv->env->mem, jobs);
     }
   }
   sbuf_free(display);
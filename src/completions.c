@@ -25,8 +25,15 @@ typedef struct completion_s {
   const char* help;
   ssize_t     delete_before;
   ssize_t     delete_after;
+  ssize_t     score;          // fuzzy match score (0 if not scored)
 } completion_t;
 
+typedef struct word_freq_s {
+  const char* word;           // points into a history entry
+  ssize_t     len;
+  ssize_t     count;
+} word_freq_t;
+
 struct completions_s {
   ic_completer_fun_t* completer;
   void* completer_arg;
@@ -34,22 +41,28 @@ struct completions_s {
   ssize_t count;
   ssize_t len;
   completion_t* elems;
+  ssize_t lowest;             // index of the lowest scored completion (or -1 if not yet known)
+  word_freq_t* freqs;         // word frequencies in the history (only valid during generation)
+  ssize_t freqs_len;
   alloc_t* mem;
 };
 
 static void default_filename_completer( ic_completion_env_t* cenv, const char* prefix );
+static void completions_freq_done(completions_t* cms);
 
 ic_private completions_t* completions_new(alloc_t* mem) {
   completions_t* cms = mem_zalloc_tp(mem, completions_t);
   if (cms == NULL) return NULL;
   cms->mem = mem;
   cms->completer = &default_filename_completer;
+  cms->lowest = -1;
   return cms;
 }
 
 ic_private void completions_free(completions_t* cms) {
   if (cms == NULL) return;
   completions_clear(cms);  
+  completions_freq_done(cms);
   if (cms->elems != NULL) {
     mem_free(cms->mem, cms->elems);
     cms->elems = NULL;
@@ -69,9 +82,10 @@ ic_private void completions_clear(completions_t* cms) {
     memset(cm,0,sizeof(*cm));
     cms->count--;    
   }
+  cms->lowest = -1;
 }
 
-static void completions_push(completions_t* cms, const char* replacement, const char* display, const char* help, ssize_t delete_before, ssize_t delete_after) 
+static void completions_push(completions_t* cms, const char* replacement, const char* display, const char* help, ssize_t delete_before, ssize_t delete_after, ssize_t score) 
 {
   if (cms->count >= cms->len) {
     ssize_t newlen = (cms->len <= 0 ? 32 : cms->len*2);
@@ -87,7 +101,9 @@ static void completions_push(completions_t* cms, const char* replacement, const
   cm->help          = mem_strdup(cms->mem,help);
   cm->delete_before = delete_before;
   cm->delete_after  = delete_after;
+  cm->score         = score;
   cms->count++;
+  cms->lowest = -1;
 }
 
 ic_private ssize_t completions_count(completions_t* cms) {
@@ -102,12 +118,42 @@ static bool completions_contains(completions_t* cms, const char* replacement) {
   return false;
 } 
 
-ic_private bool completions_add(completions_t* cms, const char* replacement, const char* display, const char* help, ssize_t delete_before, ssize_t delete_after) {
-  if (cms->completer_max <= 0) return false;
+// When we have enough completions, a scored completion replaces the lowest scored one
+// if it ranks higher. This way we keep the best `max` completions for ranked matching.
+// Unscored completions (from other completers) are never replaced.
+static bool completions_replace_lowest(completions_t* cms, const char* replacement, const char* display, const char* help, ssize_t delete_before, ssize_t delete_after, ssize_t score) 
+{
+  if (cms->lowest < 0) {
+    for (ssize_t i = 0; i < cms->count; i++) {
+      const ssize_t iscore = cms->elems[i].score;
+      if (iscore > 0 && (cms->lowest < 0 || iscore < cms->elems[cms->lowest].score)) { cms->lowest = i; }
+    }
+    if (cms->lowest < 0) return false;  // no scored completions to replace
+  }
+  completion_t* cm = cms->elems + cms->lowest;
+  if (score <= cm->score || completions_contains(cms, replacement)) return true;
+  mem_free(cms->mem, cm->display);
+  mem_free(cms->mem, cm->replacement);
+  mem_free(cms->mem, cm->help);
+  cm->replacement   = mem_strdup(cms->mem, replacement);
+  cm->display       = mem_strdup(cms->mem, display);
+  cm->help          = mem_strdup(cms->mem, help);
+  cm->delete_before = delete_before;
+  cm->delete_after  = delete_after;
+  cm->score         = score;
+  cms->lowest = -1;
+  return true;
+}
+
+ic_private bool completions_add(completions_t* cms, const char* replacement, const char* display, const char* help, ssize_t delete_before, ssize_t delete_after, ssize_t score) {
+  if (cms->completer_max <= 0) {
+    if (score <= 0) return false;
+    return completions_replace_lowest(cms, replacement, display, help, delete_before, delete_after, score);
+  }
   cms->completer_max--;
   //debug_msg("completion: add: %d,%d, %s\n", delete_before, delete_after, replacement);
   if (!completions_contains(cms,replacement)) {
-    completions_push(cms, replacement, display, help, delete_before, delete_after);
+    completions_push(cms, replacement, display, help, delete_before, delete_after, score);
   }
   return true;
 }
@@ -131,12 +177,14 @@ ic_private const char* completions_get_help( completions_t* cms, ssize_t index )
   return cm->help;
 }
 
-ic_private const char* completions_get_hint(completions_t* cms, ssize_t index, const char** help) {
+ic_private const char* completions_get_hint(completions_t* cms, ssize_t index, const char* input, ssize_t pos, const char** help) {
   if (help != NULL) { *help = NULL; }
   completion_t* cm = completions_get(cms, index);
   if (cm == NULL) return NULL;
   ssize_t len = ic_strlen(cm->replacement);
-  if (len < cm->delete_before) return NULL;
+  if (len < cm->delete_before || pos < cm->delete_before) return NULL;
+  // only hint if the completion extends the input (which is not the case for a fuzzy match)
+  if (ic_strnicmp(input + pos - cm->delete_before, cm->replacement, cm->delete_before) != 0) return NULL;
   const char* hint = (cm->replacement + cm->delete_before);
   if (*hint == 0 || utf8_is_cont((uint8_t)(*hint))) return NULL;  // utf8 boundary?
   if (help != NULL) { *help = cm->help; }
@@ -193,6 +241,7 @@ static int completion_compare(const void* p1, const void* p2) {
   if (p1 == NULL || p2 == NULL) return 0;
   const completion_t* cm1 = (const completion_t*)p1;
   const completion_t* cm2 = (const completion_t*)p2;  
+  if (cm1->score != cm2->score) return (cm1->score > cm2->score ? -1 : 1);  // highest score first
   return ic_stricmp(cm1->replacement, cm2->replacement);
 }
 
@@ -239,6 +288,9 @@ ic_private ssize_t completions_apply_longest_prefix(completions_t* cms, stringbu
   ssize_t len = ic_strlen(prefix);
   if (len <= 0 || len < delete_before) return -1;
 
+  // and that it extends the current input (which may not be the case with fuzzy matches)
+  if (pos < delete_before || ic_strnicmp(sbuf_string_at(sbuf, pos - delete_before), prefix, delete_before) != 0) return -1;
+
   // we found a prefix :-)
   completion_t cprefix;
   memset(&cprefix,0,sizeof(cprefix));
@@ -270,6 +322,82 @@ ic_public bool ic_add_completions(ic_completion_env_t* cenv, const char* prefix,
   return true;
 }
 
+
+//-------------------------------------------------------------
+// Vocabulary: an immutable sorted index of words
+//-------------------------------------------------------------
+
+struct ic_vocab_s {
+  alloc_t*     mem;
+  ssize_t      count;
+  const char** words;   // sorted ignoring (ascii) case; points into the same allocation
+};
+
+// compare at most `n` bytes (or all if `n < 0`) as unsigned bytes ignoring (ascii) case;
+// used for both sorting and lookup so they agree on the order of non-ascii words.
+static int vocab_strncmp(const char* s1, const char* s2, ssize_t n) {
+  ssize_t i;
+  for (i = 0; i != n && s1[i] != 0 && ic_tolower(s1[i]) == ic_tolower(s2[i]); i++) { }
+  if (i == n) return 0;
+  return ((int)(uint8_t)ic_tolower(s1[i]) - (int)(uint8_t)ic_tolower(s2[i]));
+}
+
+static int vocab_compare(const void* p1, const void* p2) {
+  return vocab_strncmp(*((const char**)p1), *((const char**)p2), -1);
+}
+
+ic_public ic_vocab_t* ic_vocab_new(const char** words) {
+  ic_env_t* env = ic_get_env(); if (env == NULL) return NULL;
+  // allocate the header, the word array, and the words themselves in one block
+  ssize_t count = 0;
+  ssize_t size = 0;
+  if (words != NULL) {
+    for (const char** pw = words; *pw != NULL; pw++) {
+      count++;
+      size += ic_strlen(*pw) + 1;
+    }
+  }
+  ic_vocab_t* vocab = (ic_vocab_t*)mem_malloc(env->mem, ssizeof(ic_vocab_t) + count*ssizeof(char*) + size);
+  if (vocab == NULL) return NULL;
+  vocab->mem   = env->mem;
+  vocab->count = count;
+  vocab->words = (const char**)(vocab + 1);
+  char* p = (char*)(vocab->words + count);
+  for (ssize_t i = 0; i < count; i++) {
+    ssize_t len = ic_strlen(words[i]);
+    ic_memcpy(p, words[i], len + 1);
+    vocab->words[i] = p;
+    p += len + 1;
+  }
+  if (count > 1) {
+    qsort((void*)vocab->words, to_size_t(count), sizeof(char*), &vocab_compare);
+  }
+  return vocab;
+}
+
+ic_public void ic_vocab_free(ic_vocab_t* vocab) {
+  if (vocab == NULL) return;
+  mem_free(vocab->mem, vocab);
+}
+
+ic_public bool ic_complete_from_vocab(ic_completion_env_t* cenv, const char* prefix, const ic_vocab_t* vocab) {
+  if (vocab == NULL) return true;
+  ssize_t plen = ic_strlen(prefix);
+  // binary search for the first word that is not smaller than the prefix
+  ssize_t lo = 0;
+  ssize_t hi = vocab->count;
+  while (lo < hi) {
+    ssize_t mid = lo + (hi - lo)/2;
+    if (vocab_strncmp(vocab->words[mid], prefix, plen) < 0) { lo = mid + 1; }
+                                                       else { hi = mid; }
+  }
+  // all words starting with the prefix follow consecutively
+  for (ssize_t i = lo; i < vocab->count && vocab_strncmp(vocab->words[i], prefix, plen) == 0; i++) {
+    if (!ic_add_completion_ex(cenv, vocab->words[i], NULL, NULL)) return false;
+  }
+  return true;
+}
+
 ic_public bool ic_add_completion(ic_completion_env_t* cenv, const char* replacement) {
   return ic_add_completion_ex(cenv, replacement, NULL, NULL);
 }
@@ -279,12 +407,192 @@ ic_public bool ic_add_completion_ex( ic_completion_env_t* cenv, const char* repl
 }
 
 ic_public bool ic_add_completion_prim(ic_completion_env_t* cenv, const char* replacement, const char* display, const char* help, long delete_before, long delete_after) {
-  return (*cenv->complete)(cenv->env, cenv->closure, replacement, display, help, delete_before, delete_after );
+  return (*cenv->complete)(cenv->env, cenv->closure, replacement, display, help, delete_before, delete_after, 0 );
 }
 
-static bool prim_add_completion(ic_env_t* env, void* funenv, const char* replacement, const char* display, const char* help, long delete_before, long delete_after) {
+static bool prim_add_completion(ic_env_t* env, void* funenv, const char* replacement, const char* display, const char* help, long delete_before, long delete_after, long score) {
   ic_unused(funenv);
-  return completions_add(env->completions, replacement, display, help, delete_before, delete_after);
+  return completions_add(env->completions, replacement, display, help, delete_before, delete_after, score);
+}
+
+
+//-------------------------------------------------------------
+// Fuzzy matching
+//-------------------------------------------------------------
+
+#define IC_FUZZY_MAX          (256)  // only the first 256 bytes of a candidate are matched
+#define IC_FUZZY_MATCH        (16)   // score for each matched character
+#define IC_FUZZY_BOUNDARY     (8)    // bonus for a match at the start of a word (after `_`, `-`, `.`, etc.)
+#define IC_FUZZY_CAMEL        (7)    // bonus for a match at a camelCase hump (or first digit)
+#define IC_FUZZY_CONSECUTIVE  (4)    // bonus for a match directly after a previous match
+#define IC_FUZZY_GAP          (1)    // penalty for each skipped character inside the match
+#define IC_FUZZY_PREFIX       (32)   // bonus if the pattern is a prefix of the candidate
+#define IC_FUZZY_HISTORY      (12)   // bonus for each use in the history ..
+#define IC_FUZZY_HISTORY_MAX  (8)    // .. up to 8 uses
+
+// character classes
+#define FC_SEP    (0)
+#define FC_LOWER  (1)
+#define FC_UPPER  (2)
+#define FC_DIGIT  (3)
+
+// bonus for a match given the class of the previous and current character
+static const uint8_t fuzzy_bonus[4][4] = {
+  /* prev SEP   */ { 0, IC_FUZZY_BOUNDARY, IC_FUZZY_BOUNDARY, IC_FUZZY_BOUNDARY },
+  /* prev LOWER */ { 0, 0, IC_FUZZY_CAMEL, IC_FUZZY_CAMEL },
+  /* prev UPPER */ { 0, 0, 0, IC_FUZZY_CAMEL },
+  /* prev DIGIT */ { 0, 0, 0, 0 }
+};
+
+// Return the (case-insensitive) fuzzy match score of `pattern` in `s`, or 0 if it does not match.
+// The pattern must occur as a subsequence of `s`, and we score the shortest match that ends
+// at the first position where the subsequence is complete (as in fzf "v1").
+// The candidate is first classified in a single pass over fixed size arrays without
+// data dependent branches so the compiler can vectorize it.
+static ssize_t fuzzy_score(const char* pattern, ssize_t m, const char* s) {
+  uint8_t lower[IC_FUZZY_MAX];
+  uint8_t bonus[IC_FUZZY_MAX];
+  uint8_t cls[IC_FUZZY_MAX+1];
+  if (m <= 0) return 1;
+  if (m > IC_FUZZY_MAX) return 0;
+  ssize_t n = 0;
+  while (n < IC_FUZZY_MAX && s[n] != 0) { n++; }
+  if (n < m) return 0;
+
+  // 1. classify all characters (unicode bytes are treated as lower case letters)
+  cls[0] = FC_SEP;
+  for (ssize_t i = 0; i < n; i++) {
+    const uint8_t c = (uint8_t)s[i];
+    const uint8_t is_upper = (uint8_t)(c >= 'A' && c <= 'Z');
+    const uint8_t is_lower = (uint8_t)((c >= 'a' && c <= 'z') || c >= 0x80);
+    const uint8_t is_digit = (uint8_t)(c >= '0' && c <= '9');
+    cls[i+1] = (uint8_t)(is_lower*FC_LOWER + is_upper*FC_UPPER + is_digit*FC_DIGIT);
+    lower[i] = (uint8_t)(c + is_upper*('a' - 'A'));
+  }
+  for (ssize_t i = 0; i < n; i++) {
+    bonus[i] = fuzzy_bonus[cls[i]][cls[i+1]];
+  }
+
+  // 2. find the first end of the pattern as a subsequence
+  ssize_t pi = 0;
+  ssize_t end = -1;
+  for (ssize_t i = 0; i < n; i++) {
+    if (lower[i] == (uint8_t)ic_tolower(pattern[pi])) {
+      pi++;
+      if (pi >= m) { end = i; break; }
+    }
+  }
+  if (end < 0) return 0;
+
+  // 3. scan backward to find the shortest match ending there
+  ssize_t start = 0;
+  pi = m - 1;
+  for (ssize_t i = end; i >= 0; i--) {
+    if (lower[i] == (uint8_t)ic_tolower(pattern[pi])) {
+      if (pi == 0) { start = i; break; }
+      pi--;
+    }
+  }
+
+  // 4. and score it
+  ssize_t score = 0;
+  bool consecutive = false;
+  pi = 0;
+  for (ssize_t i = start; i <= end && pi < m; i++) {
+    if (lower[i] == (uint8_t)ic_tolower(pattern[pi])) {
+      score += IC_FUZZY_MATCH + bonus[i] + (consecutive ? IC_FUZZY_CONSECUTIVE : 0);
+      consecutive = true;
+      pi++;
+    }
+    else {
+      score -= IC_FUZZY_GAP;
+      consecutive = false;
+    }
+  }
+  if (start == 0 && end == m - 1) {
+    score += IC_FUZZY_PREFIX;
+  }
+  return (score < 1 ? 1 : score);
+}
+
+
+// The history word frequencies are built lazily on the first scored completion
+// and released at the end of `completions_generate`.
+
+static uint32_t fuzzy_hash(const char* s, ssize_t len) {
+  uint32_t h = 2166136261U;  // FNV-1a
+  for (ssize_t i = 0; i < len; i++) {
+    h = (h ^ (uint8_t)s[i]) * 16777619U;
+  }
+  return h;
+}
+
+static word_freq_t* completions_freq_find(completions_t* cms, const char* word, ssize_t len) {
+  if (cms->freqs == NULL) return NULL;
+  const size_t mask = to_size_t(cms->freqs_len - 1);
+  size_t i = fuzzy_hash(word, len) & mask;
+  while (cms->freqs[i].word != NULL) {
+    word_freq_t* wf = &cms->freqs[i];
+    if (wf->len == len && strncmp(wf->word, word, to_size_t(len)) == 0) return wf;
+    i = (i + 1) & mask;
+  }
+  return &cms->freqs[i];  // empty slot
+}
+
+static void completions_freq_done(completions_t* cms) {
+  mem_free(cms->mem, cms->freqs);
+  cms->freqs = NULL;
+  cms->freqs_len = 0;
+}
+
+static void completions_freq_init(completions_t* cms, const history_t* h) {
+  if (cms->freqs != NULL) return;
+  // count the words to size the table (at most half full)
+  ssize_t words = 0;
+  for (ssize_t n = 0; n < history_count(h); n++) {
+    const char* entry = history_get(h, n);
+    for (ssize_t i = 0; entry[i] != 0; i++) {
+      if (ic_char_is_idletter(entry + i, 1) && (i == 0 || !ic_char_is_idletter(entry + i - 1, 1))) { words++; }
+    }
+  }
+  if (words <= 0) return;
+  ssize_t len = 64;
+  while (len < 2*words) { len *= 2; }
+  cms->freqs = mem_zalloc_tp_n(cms->mem, word_freq_t, len);
+  if (cms->freqs == NULL) return;
+  cms->freqs_len = len;
+  // and count every word
+  for (ssize_t n = 0; n < history_count(h); n++) {
+    const char* entry = history_get(h, n);
+    ssize_t i = 0;
+    while (entry[i] != 0) {
+      if (!ic_char_is_idletter(entry + i, 1)) { i++; continue; }
+      ssize_t start = i;
+      while (entry[i] != 0 && ic_char_is_idletter(entry + i, 1)) { i++; }
+      word_freq_t* wf = completions_freq_find(cms, entry + start, i - start);
+      if (wf->word == NULL) {
+        wf->word = entry + start;
+        wf->len  = i - start;
+      }
+      wf->count++;
+    }
+  }
+}
+
+static ssize_t completions_freq_bonus(completions_t* cms, const char* word) {
+  word_freq_t* wf = completions_freq_find(cms, word, ic_strlen(word));
+  if (wf == NULL || wf->word == NULL) return 0;
+  return IC_FUZZY_HISTORY * (wf->count > IC_FUZZY_HISTORY_MAX ? IC_FUZZY_HISTORY_MAX : wf->count);
+}
+
+ic_public bool ic_add_completion_scored(ic_completion_env_t* cenv, const char* prefix, const char* completion, const char* display, const char* help) {
+  if (completion == NULL) return true;
+  ssize_t score = fuzzy_score(prefix, ic_strlen(prefix), completion);
+  if (score <= 0) return true;  // no match
+  completions_t* cms = cenv->env->completions;
+  completions_freq_init(cms, cenv->env->history);
+  score += completions_freq_bonus(cms, completion);
+  return (*cenv->complete)(cenv->env, cenv->closure, completion, display, help, 0, 0, (long)score);
 }
 
 ic_public void ic_set_default_completer(ic_completer_fun_t* completer, void* arg) {
@@ -312,6 +620,7 @@ ic_private ssize_t completions_generate(struct ic_env_s* env, completions_t* cms
 
   // restore
   mem_free(cms->mem,prefix);
+  completions_freq_done(cms);
   return completions_count(cms);
 }
 
@@ -23,22 +23,27 @@ typedef struct completions_s completions_t;
 ic_private completions_t* completions_new(alloc_t* mem);
 ic_private void        completions_free(completions_t* cms);
 ic_private void        completions_clear(completions_t* cms);
-ic_private bool        completions_add(completions_t* cms , const char* replacement, const char* display, const char* help, ssize_t delete_before, ssize_t delete_after);
+ic_private bool        completions_add(completions_t* cms , const char* replacement, const char* display, const char* help, ssize_t delete_before, ssize_t delete_after, ssize_t score);
 ic_private ssize_t     completions_count(completions_t* cms);
 ic_private ssize_t     completions_generate(struct ic_env_s* env, completions_t* cms , const char* input, ssize_t pos, ssize_t max);
 ic_private void        completions_sort(completions_t* cms);
 ic_private void        completions_set_completer(completions_t* cms, ic_completer_fun_t* completer, void* arg);
 ic_private const char* completions_get_display(completions_t* cms , ssize_t index, const char** help);
-ic_private const char* completions_get_hint(completions_t* cms, ssize_t index, const char** help);
+ic_private const char* completions_get_hint(completions_t* cms, ssize_t index, const char* input, ssize_t pos, const char** help);
 ic_private void        completions_get_completer(completions_t* cms, ic_completer_fun_t** completer, void** arg);
 
 ic_private ssize_t     completions_apply(completions_t* cms, ssize_t index, stringbuf_t* sbuf, ssize_t pos);
 ic_private ssize_t     completions_apply_longest_prefix(completions_t* cms, stringbuf_t* sbuf, ssize_t pos);
 
+// cached directory listings for filename completion (in completers.c)
+typedef struct dircache_s dircache_t;
+
+ic_private void        dircache_free(dircache_t* dc);
+
 //-------------------------------------------------------------
 // Completion environment
 //-------------------------------------------------------------
-typedef bool (ic_completion_fun_t)( ic_env_t* env, void* funenv, const char* replacement, const char* display, const char* help, long delete_before, long delete_after );
+typedef bool (ic_completion_fun_t)( ic_env_t* env, void* funenv, const char* replacement, const char* display, const char* help, long delete_before, long delete_after, long score );
 
 struct ic_completion_env_s {
   ic_env_t*   env;       // the isocline environment
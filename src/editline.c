@@ -53,9 +53,15 @@ typedef struct editor_s {
 // Main edit line 
 //-------------------------------------------------------------
 static char* edit_line( ic_env_t* env, const char* prompt_text );  // defined at bottom
+static bool  edit_start( ic_env_t* env, editor_t* eb, const char* prompt_text );
+static bool  edit_key( ic_env_t* env, editor_t* eb, code_t c );
+static char* edit_finish( ic_env_t* env, editor_t* eb, code_t c );
 static void edit_refresh(ic_env_t* env, editor_t* eb);
+static bool edit_resize(ic_env_t* env, editor_t* eb);
 
 ic_private char* ic_editline(ic_env_t* env, const char* prompt_text) {
+  if (env->editor != NULL) return NULL;  // already editing (see `ic_editline_start`)
+  ic_async_output_edit_start(env);
   tty_start_raw(env->tty);
   term_start_raw(env->term);
   char* line = edit_line(env,prompt_text);
@@ -63,10 +69,131 @@ ic_private char* ic_editline(ic_env_t* env, const char* prompt_text) {
   tty_end_raw(env->tty);
   term_writeln(env->term,"");
   term_flush(env->term);
+  ic_async_output_edit_done(env);
   return line;
 }
 
 
+//-------------------------------------------------------------
+// Non-blocking edit line: the editor state is kept in the 
+// environment and we process keys as they become available.
+//-------------------------------------------------------------
+
+ic_private bool ic_editline_start(ic_env_t* env, const char* prompt_text) {
+  if (env->editor != NULL) return false;
+  editor_t* eb = mem_zalloc_tp(env->mem, editor_t);
+  if (eb == NULL) return false;
+  // keep a copy of the prompt as we return before editing is done
+  char* prompt = mem_strdup(env->mem, (prompt_text != NULL ? prompt_text : ""));
+  if (prompt == NULL) {
+    mem_free(env->mem, eb);
+    return false;
+  }
+  ic_async_output_edit_start(env);
+  tty_start_raw(env->tty);
+  term_start_raw(env->term);
+  if (!edit_start(env, eb, prompt)) {
+    term_end_raw(env->term, false);
+    tty_end_raw(env->tty);
+    ic_async_output_edit_done(env);
+    mem_free(env->mem, prompt);
+    mem_free(env->mem, eb);
+    return false;
+  }
+  term_flush(env->term);
+  env->editor = eb;
+  return true;
+}
+
+static char* ic_editline_end(ic_env_t* env, code_t c) {
+  editor_t* eb = env->editor;
+  env->editor = NULL;
+  char* line = edit_finish(env, eb, c);
+  mem_free(env->mem, eb->prompt_text);
+  mem_free(env->mem, eb);
+  term_end_raw(env->term, false);
+  tty_end_raw(env->tty);
+  term_writeln(env->term, "");
+  term_flush(env->term);
+  ic_async_output_edit_done(env);
+  return line;
+}
+
+// insert input bytes in the rest input at `pos` 
+static bool ic_editline_rest_insert(ic_env_t* env, ssize_t pos, const uint8_t* bytes, ssize_t len) {
+  if (len <= 0) return true;
+  uint8_t* rest = mem_realloc_tp(env->mem, uint8_t, env->input_rest, env->input_rest_len + len);
+  if (rest == NULL) return false;
+  ic_memmove(rest + pos + len, rest + pos, env->input_rest_len - pos);
+  ic_memcpy(rest + pos, bytes, len);
+  env->input_rest = rest;
+  env->input_rest_len += len;
+  return true;
+}
+
+// move as much of the rest input into the tty as fits
+static void ic_editline_rest_feed(ic_env_t* env) {
+  if (env->input_rest_len <= 0) return;
+  ssize_t n = tty_feed(env->tty, env->input_rest, env->input_rest_len);
+  env->input_rest_len -= n;
+  ic_memmove(env->input_rest, env->input_rest + n, env->input_rest_len);
+}
+
+// keep input that follows a finished line for the next edit 
+// (instead of discarding it when the terminal leaves raw mode)
+static void ic_editline_rest_keep(ic_env_t* env) {
+  uint8_t buf[256];
+  ssize_t pos = 0;
+  ssize_t n;
+  while ((n = tty_take_input(env->tty, buf, 256)) > 0) {
+    if (!ic_editline_rest_insert(env, pos, buf, n)) break;
+    pos += n;
+  }
+}
+
+// process all available input without blocking; returns `true` when done.
+ic_private bool ic_editline_poll(ic_env_t* env, char** line) {
+  *line = NULL;
+  editor_t* eb = env->editor;
+  if (eb == NULL) return true;
+  code_t c;
+  while (true) {
+    ic_editline_rest_feed(env);
+    if (!tty_read_timeout(env->tty, 0, &c)) break;
+    if (edit_key(env, eb, c)) {
+      ic_editline_rest_keep(env);
+      *line = ic_editline_end(env, c);
+      return true;
+    }
+  }
+  // no more input: handle a resize, and display a pending hint directly 
+  if (tty_term_resize_event(env->tty)) {
+    edit_resize(env, eb);
+  }
+  if (sbuf_len(eb->hint) > 0) {
+    edit_refresh(env, eb);
+  }
+  term_flush(env->term);
+  return false;
+}
+
+ic_private bool ic_editline_feed(ic_env_t* env, const char* bytes, ssize_t len, char** line) {
+  *line = NULL;
+  if (env->editor == NULL) return true;
+  // the input is processed in order after any rest input; input that
+  // follows a finished line is kept for the next `ic_editline_start`
+  ic_editline_rest_insert(env, env->input_rest_len, (const uint8_t*)bytes, len);
+  return ic_editline_poll(env, line);
+}
+
+// abort an active non-blocking edit (at exit)
+ic_private void ic_editline_done(ic_env_t* env) {
+  if (env->editor == NULL) return;
+  char* line = ic_editline_end(env, KEY_CTRL_C);
+  mem_free(env->mem, line);
+}
+
+
 //-------------------------------------------------------------
 // Undo/Redo
 //-------------------------------------------------------------
@@ -219,7 +346,7 @@ static bool edit_refresh_rows_iter(
     term_write_n( term, s + row_start, row_len );
   }
   else {
-    term_write_formatted_n( term, s + row_start, attrbuf_attrs(info->attrs, row_start + row_len) + row_start, row_len );
+    term_write_formatted_n( term, s, info->attrs, row_start, row_len );
   }
 
   // write line ending
@@ -383,6 +510,18 @@ static void edit_clear(ic_env_t* env, editor_t* eb ) {
 }
 
 
+// print pending asynchronous output above the prompt and redraw the prompt (once per batch)
+static void edit_print_async(ic_env_t* env, editor_t* eb) {
+  if (ic_atomic_load_ptr(&env->async_output) == NULL) return;
+  buffer_mode_t bmode = term_set_buffer_mode(env->term, BUFFERED);
+  edit_clear(env, eb);
+  ic_async_output_flush(env);
+  eb->cur_rows = 0;
+  eb->cur_row = 0;
+  edit_refresh(env, eb);
+  term_set_buffer_mode(env->term, bmode);
+}
+
 // clear screen and refresh
 static void edit_clear_screen(ic_env_t* env, editor_t* eb ) {
   ssize_t cur_rows = eb->cur_rows;
@@ -461,7 +600,7 @@ static void edit_refresh_hint(ic_env_t* env, editor_t* eb) {
   ssize_t count = completions_generate(env, env->completions, sbuf_string(eb->input), eb->pos, 2);
   if (count == 1) {
     const char* help = NULL;
-    const char* hint = completions_get_hint(env->completions, 0, &help);
+    const char* hint = completions_get_hint(env->completions, 0, sbuf_string(eb->input), eb->pos, &help);
     if (hint != NULL) {
       sbuf_replace(eb->hint, hint); 
       editor_append_hint_help(eb, help);
@@ -479,7 +618,7 @@ static void edit_refresh_hint(ic_env_t* env, editor_t* eb) {
             count = completions_generate(env, env->completions, sbuf_string(sb), pos, 2);
             if (count == 1) {
               const char* extra_help = NULL;
-              extra_hint = completions_get_hint(env->completions, 0, &extra_help);
+              extra_hint = completions_get_hint(env->completions, 0, sbuf_string(sb), pos, &extra_help);
               if (extra_hint != NULL) {
                 editor_append_hint_help(eb, extra_help);
                 sbuf_append(eb->hint, extra_hint);
@@ -847,40 +986,11 @@ static char* edit_line( ic_env_t* env, const char* prompt_text )
 {
   // set up an edit buffer
   editor_t eb;
-  memset(&eb, 0, sizeof(eb));
-  eb.mem      = env->mem;
-  eb.input    = sbuf_new(env->mem);
-  eb.extra    = sbuf_new(env->mem);
-  eb.hint     = sbuf_new(env->mem);
-  eb.hint_help= sbuf_new(env->mem);
-  eb.termw    = term_get_width(env->term);  
-  eb.pos      = 0;
-  eb.cur_rows = 1; 
-  eb.cur_row  = 0; 
-  eb.modified = false;  
-  eb.prompt_text   = (prompt_text != NULL ? prompt_text : "");
-  eb.history_idx   = 0;  
-  editstate_init(&eb.undo);
-  editstate_init(&eb.redo);
-  if (eb.input==NULL || eb.extra==NULL || eb.hint==NULL || eb.hint_help==NULL) {
-    return NULL;
-  }
-
-  // caching
-  if (!(env->no_highlight && env->no_bracematch)) {
-    eb.attrs = attrbuf_new(env->mem);
-    eb.attrs_extra = attrbuf_new(env->mem);
-  }
-  
-  // show prompt
-  edit_write_prompt(env, &eb, 0, false);   
-
-  // always a history entry for the current input
-  history_push(env->history, "");
+  if (!edit_start(env, &eb, prompt_text)) return NULL;
 
   // process keys
   code_t c;          // current key code
-  while(true) {    
+  do {    
     // read a character
     term_flush(env->term);
     if (env->hint_delay <= 0 || sbuf_len(eb.hint) == 0) {
@@ -903,239 +1013,287 @@ static char* edit_line( ic_env_t* env, const char* prompt_text )
         sbuf_clear(eb.hint_help);
       }
     }
-    
-    // update terminal in case of a resize
-    if (tty_term_resize_event(env->tty)) {
-      edit_resize(env,&eb);            
-    }
+  } 
+  while (!edit_key(env, &eb, c));
+
+  return edit_finish(env, &eb, c);
+}
+
+static bool edit_start( ic_env_t* env, editor_t* eb, const char* prompt_text )
+{
+  memset(eb, 0, sizeof(*eb));
+  eb->mem      = env->mem;
+  eb->input    = sbuf_new(env->mem);
+  eb->extra    = sbuf_new(env->mem);
+  eb->hint     = sbuf_new(env->mem);
+  eb->hint_help= sbuf_new(env->mem);
+  eb->termw    = term_get_width(env->term);  
+  eb->pos      = 0;
+  eb->cur_rows = 1; 
+  eb->cur_row  = 0; 
+  eb->modified = false;  
+  eb->prompt_text   = (prompt_text != NULL ? prompt_text : "");
+  eb->history_idx   = 0;  
+  editstate_init(&eb->undo);
+  editstate_init(&eb->redo);
+  if (eb->input==NULL || eb->extra==NULL || eb->hint==NULL || eb->hint_help==NULL) {
+    return false;
+  }
+
+  // caching
+  if (!(env->no_highlight && env->no_bracematch)) {
+    eb->attrs = attrbuf_new(env->mem);
+    eb->attrs_extra = attrbuf_new(env->mem);
+  }
+  
+  // show prompt (after any pending asynchronous output)
+  ic_async_output_flush(env);
+  edit_write_prompt(env, eb, 0, false);   
+
+  // always a history entry for the current input
+  history_push(env->history, "");
+  return true;
+}
 
-    // clear hint only after a potential resize (so resize row calculations are correct)
-    const bool had_hint = (sbuf_len(eb.hint) > 0);
-    sbuf_clear(eb.hint);
-    sbuf_clear(eb.hint_help);
+// process a key; returns `true` if editing is done
+static bool edit_key( ic_env_t* env, editor_t* eb, code_t c )
+{
+  // update terminal in case of a resize
+  if (tty_term_resize_event(env->tty)) {
+    edit_resize(env,eb);            
+  }
+  if (c == KEY_EVENT_RESIZE) return false;  // (posted by the tty once the size settles, and handled above)
 
-    // if the user tries to move into a hint with left-cursor or end, we complete it first
-    if ((c == KEY_RIGHT || c == KEY_END) && had_hint) {
-      edit_generate_completions(env, &eb, true);
-      c = KEY_NONE;      
+  // clear hint only after a potential resize (so resize row calculations are correct)
+  const bool had_hint = (sbuf_len(eb->hint) > 0);
+  sbuf_clear(eb->hint);
+  sbuf_clear(eb->hint_help);
+
+  // if the user tries to move into a hint with left-cursor or end, we complete it first
+  if ((c == KEY_RIGHT || c == KEY_END) && had_hint) {
+    edit_generate_completions(env, eb, true);
+    c = KEY_NONE;      
+  }
+
+  // Operations that may return
+  if (c == KEY_ENTER) {
+    if (!env->singleline_only && eb->pos > 0 && 
+         sbuf_string(eb->input)[eb->pos-1] == env->multiline_eol && 
+          edit_pos_is_at_row_end(env,eb)) 
+    {
+      // replace line-continuation with newline
+      edit_multiline_eol(env,eb);        
     }
+    else {
+      // otherwise done
+      return true;
+    }
+  } 
+  else if (c == KEY_CTRL_D) {
+    if (eb->pos == 0 && editor_pos_is_at_end(eb)) return true; // ctrl+D on empty quits with NULL
+    edit_delete_char(env,eb);     // otherwise it is like delete
+  } 
+  else if (c == KEY_CTRL_C || c == KEY_EVENT_STOP) {
+    return true; // ctrl+C or STOP event quits with NULL
+  }
+  else if (c == KEY_ESC) {
+    if (eb->pos == 0 && editor_pos_is_at_end(eb)) return true;  // ESC on empty input returns with empty input
+    edit_delete_all(env,eb);      // otherwise delete the current input
+    // edit_delete_line(env,eb);  // otherwise delete the current line
+  }
+  else if (c == KEY_BELL /* ^G */) {
+    edit_delete_all(env,eb);
+    return true; // ctrl+G cancels (and returns empty input)
+  }
 
-    // Operations that may return
-    if (c == KEY_ENTER) {
-      if (!env->singleline_only && eb.pos > 0 && 
-           sbuf_string(eb.input)[eb.pos-1] == env->multiline_eol && 
-            edit_pos_is_at_row_end(env,&eb)) 
-      {
-        // replace line-continuation with newline
-        edit_multiline_eol(env,&eb);        
+  // Editing Operations
+  else switch(c) {
+    // events
+    case KEY_EVENT_AUTOTAB:
+      edit_generate_completions(env, eb, true);
+      break;
+    case KEY_EVENT_OUTPUT:
+      edit_print_async(env, eb);
+      break;
+
+    // completion, history, help, undo
+    case KEY_TAB:
+    case WITH_ALT('?'):
+      edit_generate_completions(env,eb,false);
+      break;
+    case KEY_CTRL_R:
+    case KEY_CTRL_S:
+      edit_history_search_with_current_word(env,eb);
+      break;
+    case KEY_CTRL_P:
+      edit_history_prev(env, eb);
+      break;
+    case KEY_CTRL_N:
+      edit_history_next(env, eb);
+      break;
+    case KEY_CTRL_L:
+      edit_clear_screen(env, eb);
+      break;
+    case KEY_CTRL_Z:
+    case WITH_CTRL('_'):
+      edit_undo_restore(env, eb);
+      break;
+    case KEY_CTRL_Y:
+      edit_redo_restore(env, eb);
+      break;
+    case KEY_F1:
+      edit_show_help(env, eb);
+      break;
+
+    // navigation
+    case KEY_LEFT:
+    case KEY_CTRL_B:
+      edit_cursor_left(env,eb);
+      break;
+    case KEY_RIGHT:
+    case KEY_CTRL_F:
+      if (eb->pos == sbuf_len(eb->input)) { 
+        edit_generate_completions( env, eb, false );
       }
       else {
-        // otherwise done
-        break;
+        edit_cursor_right(env,eb);
       }
-    } 
-    else if (c == KEY_CTRL_D) {
-      if (eb.pos == 0 && editor_pos_is_at_end(&eb)) break; // ctrl+D on empty quits with NULL
-      edit_delete_char(env,&eb);     // otherwise it is like delete
-    } 
-    else if (c == KEY_CTRL_C || c == KEY_EVENT_STOP) {
-      break; // ctrl+C or STOP event quits with NULL
-    }
-    else if (c == KEY_ESC) {
-      if (eb.pos == 0 && editor_pos_is_at_end(&eb)) break;  // ESC on empty input returns with empty input
-      edit_delete_all(env,&eb);      // otherwise delete the current input
-      // edit_delete_line(env,&eb);  // otherwise delete the current line
-    }
-    else if (c == KEY_BELL /* ^G */) {
-      edit_delete_all(env,&eb);
-      break; // ctrl+G cancels (and returns empty input)
-    }
-
-    // Editing Operations
-    else switch(c) {
-      // events
-      case KEY_EVENT_RESIZE:  // not used
-        edit_resize(env,&eb);
-        break;
-      case KEY_EVENT_AUTOTAB:
-        edit_generate_completions(env, &eb, true);
-        break;
-
-      // completion, history, help, undo
-      case KEY_TAB:
-      case WITH_ALT('?'):
-        edit_generate_completions(env,&eb,false);
-        break;
-      case KEY_CTRL_R:
-      case KEY_CTRL_S:
-        edit_history_search_with_current_word(env,&eb);
-        break;
-      case KEY_CTRL_P:
-        edit_history_prev(env, &eb);
-        break;
-      case KEY_CTRL_N:
-        edit_history_next(env, &eb);
-        break;
-      case KEY_CTRL_L:
-        edit_clear_screen(env, &eb);
-        break;
-      case KEY_CTRL_Z:
-      case WITH_CTRL('_'):
-        edit_undo_restore(env, &eb);
-        break;
-      case KEY_CTRL_Y:
-        edit_redo_restore(env, &eb);
-        break;
-      case KEY_F1:
-        edit_show_help(env, &eb);
-        break;
-
-      // navigation
-      case KEY_LEFT:
-      case KEY_CTRL_B:
-        edit_cursor_left(env,&eb);
-        break;
-      case KEY_RIGHT:
-      case KEY_CTRL_F:
-        if (eb.pos == sbuf_len(eb.input)) { 
-          edit_generate_completions( env, &eb, false );
-        }
-        else {
-          edit_cursor_right(env,&eb);
-        }
-        break;
-      case KEY_UP:
-        edit_cursor_row_up(env,&eb);
-        break;
-      case KEY_DOWN:
-        edit_cursor_row_down(env,&eb);
-        break;                 
-      case KEY_HOME:
-      case KEY_CTRL_A:
-        edit_cursor_line_start(env,&eb);
-        break;
-      case KEY_END:
-      case KEY_CTRL_E:
-        edit_cursor_line_end(env,&eb);
-        break;
-      case KEY_CTRL_LEFT:
-      case WITH_SHIFT(KEY_LEFT):    
-      case WITH_ALT('b'):
-        edit_cursor_prev_word(env,&eb);
-        break;
-      case KEY_CTRL_RIGHT:
-      case WITH_SHIFT(KEY_RIGHT):      
-      case WITH_ALT('f'):
-        if (eb.pos == sbuf_len(eb.input)) { 
-          edit_generate_completions( env, &eb, false );
-        }
-        else {
-          edit_cursor_next_word(env,&eb);
-        }
-        break;      
-      case KEY_CTRL_HOME:
-      case WITH_SHIFT(KEY_HOME):      
-      case KEY_PAGEUP:
-      case WITH_ALT('<'):
-        edit_cursor_to_start(env,&eb);
-        break;
-      case KEY_CTRL_END:
-      case WITH_SHIFT(KEY_END):      
-      case KEY_PAGEDOWN:
-      case WITH_ALT('>'):
-        edit_cursor_to_end(env,&eb);
-        break;
-      case WITH_ALT('m'):
-        edit_cursor_match_brace(env,&eb);
-        break;
-
-      // deletion
-      case KEY_BACKSP:
-        edit_backspace(env,&eb);
-        break;
-      case KEY_DEL:
-        edit_delete_char(env,&eb);
-        break;
-      case WITH_ALT('d'):
-        edit_delete_to_end_of_word(env,&eb);
-        break;
-      case KEY_CTRL_W:
-        edit_delete_to_start_of_ws_word(env, &eb);
-        break;
-      case WITH_ALT(KEY_DEL):
-      case WITH_ALT(KEY_BACKSP):
-        edit_delete_to_start_of_word(env,&eb);
-        break;      
-      case KEY_CTRL_U:
-        edit_delete_to_start_of_line(env,&eb);
-        break;
-      case KEY_CTRL_K:
-        edit_delete_to_end_of_line(env,&eb);
-        break;
-      case KEY_CTRL_T:
-        edit_swap_char(env,&eb);
-        break;
-
-      // Editing
-      case KEY_SHIFT_TAB:
-      case KEY_LINEFEED: // '\n' (ctrl+J, shift+enter)
-        if (!env->singleline_only) { 
-          edit_insert_char(env, &eb, '\n'); 
-        }
-        break;
-      default: {
-        char chr;
-        unicode_t uchr;
-        if (code_is_ascii_char(c,&chr)) {
-          edit_insert_char(env,&eb,chr);
-        }
-        else if (code_is_unicode(c, &uchr)) {
-          edit_insert_unicode(env,&eb, uchr);
-        }
-        else {
-          debug_msg( "edit: ignore code: 0x%04x\n", c);
-        }
-        break;
+      break;
+    case KEY_UP:
+      edit_cursor_row_up(env,eb);
+      break;
+    case KEY_DOWN:
+      edit_cursor_row_down(env,eb);
+      break;                 
+    case KEY_HOME:
+    case KEY_CTRL_A:
+      edit_cursor_line_start(env,eb);
+      break;
+    case KEY_END:
+    case KEY_CTRL_E:
+      edit_cursor_line_end(env,eb);
+      break;
+    case KEY_CTRL_LEFT:
+    case WITH_SHIFT(KEY_LEFT):    
+    case WITH_ALT('b'):
+      edit_cursor_prev_word(env,eb);
+      break;
+    case KEY_CTRL_RIGHT:
+    case WITH_SHIFT(KEY_RIGHT):      
+    case WITH_ALT('f'):
+      if (eb->pos == sbuf_len(eb->input)) { 
+        edit_generate_completions( env, eb, false );
+      }
+      else {
+        edit_cursor_next_word(env,eb);
+      }
+      break;      
+    case KEY_CTRL_HOME:
+    case WITH_SHIFT(KEY_HOME):      
+    case KEY_PAGEUP:
+    case WITH_ALT('<'):
+      edit_cursor_to_start(env,eb);
+      break;
+    case KEY_CTRL_END:
+    case WITH_SHIFT(KEY_END):      
+    case KEY_PAGEDOWN:
+    case WITH_ALT('>'):
+      edit_cursor_to_end(env,eb);
+      break;
+    case WITH_ALT('m'):
+      edit_cursor_match_brace(env,eb);
+      break;
+
+    // deletion
+    case KEY_BACKSP:
+      edit_backspace(env,eb);
+      break;
+    case KEY_DEL:
+      edit_delete_char(env,eb);
+      break;
+    case WITH_ALT('d'):
+      edit_delete_to_end_of_word(env,eb);
+      break;
+    case KEY_CTRL_W:
+      edit_delete_to_start_of_ws_word(env, eb);
+      break;
+    case WITH_ALT(KEY_DEL):
+    case WITH_ALT(KEY_BACKSP):
+      edit_delete_to_start_of_word(env,eb);
+      break;      
+    case KEY_CTRL_U:
+      edit_delete_to_start_of_line(env,eb);
+      break;
+    case KEY_CTRL_K:
+      edit_delete_to_end_of_line(env,eb);
+      break;
+    case KEY_CTRL_T:
+      edit_swap_char(env,eb);
+      break;
+
+    // Editing
+    case KEY_SHIFT_TAB:
+    case KEY_LINEFEED: // '\n' (ctrl+J, shift+enter)
+      if (!env->singleline_only) { 
+        edit_insert_char(env, eb, '\n'); 
+      }
+      break;
+    default: {
+      char chr;
+      unicode_t uchr;
+      if (code_is_ascii_char(c,&chr)) {
+        edit_insert_char(env,eb,chr);
+      }
+      else if (code_is_unicode(c, &uchr)) {
+        edit_insert_unicode(env,eb, uchr);
       }
+      else {
+        debug_msg( "edit: ignore code: 0x%04x\n", c);
+      }
+      break;
     }
-
   }
+  return false;
+}
 
+// finish editing and return the result (`c` is the final key)
+static char* edit_finish( ic_env_t* env, editor_t* eb, code_t c )
+{
   // goto end
-  eb.pos = sbuf_len(eb.input);
+  eb->pos = sbuf_len(eb->input);
 
   // refresh once more but without brace matching
   bool bm = env->no_bracematch;
   env->no_bracematch = true;
-  edit_refresh(env,&eb);
+  edit_refresh(env,eb);
   env->no_bracematch = bm;
   
   // save result
   char* res; 
-  if ((c == KEY_CTRL_D && sbuf_len(eb.input) == 0) || c == KEY_CTRL_C || c == KEY_EVENT_STOP) {
+  if ((c == KEY_CTRL_D && sbuf_len(eb->input) == 0) || c == KEY_CTRL_C || c == KEY_EVENT_STOP) {
     res = NULL;
   }
   else if (!tty_is_utf8(env->tty)) {
-    res = sbuf_strdup_from_utf8(eb.input);
+    res = sbuf_strdup_from_utf8(eb->input);
   }
   else {
-    res = sbuf_strdup(eb.input);
+    res = sbuf_strdup(eb->input);
   }
 
   // update history
-  history_update(env->history, sbuf_string(eb.input));
-  if (res == NULL || sbuf_len(eb.input) <= 1) { ic_history_remove_last(); } // no empty or single-char entries
+  history_update(env->history, sbuf_string(eb->input));
+  if (res == NULL || sbuf_len(eb->input) <= 1) { ic_history_remove_last(); } // no empty or single-char entries
   history_save(env->history);
 
   // free resources 
-  editstate_done(env->mem, &eb.undo);
-  editstate_done(env->mem, &eb.redo);
-  attrbuf_free(eb.attrs);
-  attrbuf_free(eb.attrs_extra);
-  sbuf_free(eb.input);
-  sbuf_free(eb.extra);
-  sbuf_free(eb.hint);
-  sbuf_free(eb.hint_help);
+  editstate_done(env->mem, &eb->undo);
+  editstate_done(env->mem, &eb->redo);
+  attrbuf_free(eb->attrs);
+  attrbuf_free(eb->attrs_extra);
+  sbuf_free(eb->input);
+  sbuf_free(eb->extra);
+  sbuf_free(eb->hint);
+  sbuf_free(eb->hint_help);
 
   return res;
 }
@@ -163,6 +163,15 @@ again:
     edit_resize(env, eb);
   }
   sbuf_clear(eb->extra);
+
+  // asynchronous output?
+  if (c == KEY_EVENT_OUTPUT) {
+    edit_print_async(env, eb);
+    goto again;
+  }
+  else if (c == KEY_EVENT_RESIZE) {
+    goto again;  // (already handled)
+  }
   
   // direct selection?
   if (c >= '1' && c <= '9') {
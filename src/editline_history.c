@@ -163,8 +163,15 @@ again:
   sbuf_clear(eb->extra);
 
   // Process commands
-  if (c == KEY_ESC || c == KEY_BELL /* ^G */ || c == KEY_CTRL_C) {
-    c = 0;  
+  if (c == KEY_EVENT_OUTPUT) {
+    edit_print_async(env, eb);
+    goto again;
+  }
+  else if (c == KEY_EVENT_RESIZE) {
+    goto again;  // (already handled)
+  }
+  else if (c == KEY_ESC || c == KEY_BELL /* ^G */ || c == KEY_CTRL_C || c == KEY_EVENT_STOP) {
+    if (c != KEY_EVENT_STOP) { c = 0; }  // a stop event is passed on to the main edit loop
     eb->disable_undo = false;
     editor_undo_restore(eb, false);
   } 
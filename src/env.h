@@ -29,6 +29,12 @@ struct ic_env_s {
   completions_t*  completions;      // current completions
   history_t*      history;          // edit history
   bbcode_t*       bbcode;           // print with bbcodes
+  dircache_t*     dircache;         // cached directory listings for filename completion (can be NULL)
+  struct editor_s* editor;          // the active non-blocking editor (see `ic_readline_start`), or NULL
+  uint8_t*        input_rest;       // fed input that is not yet processed by the non-blocking editor (see `ic_readline_feed`)
+  ssize_t         input_rest_len;
+  void* volatile  async_output;     // lock-free stack of pending asynchronous output (see `ic_print_async`)
+  void* volatile  async_state;      // who uses the terminal: NULL if free, or editing or printing (see `ic_async_output_take`)
   const char*     prompt_marker;    // the prompt marker (defaults to "> ")
   const char*     cprompt_marker;   // prompt marker for continuation lines (defaults to `prompt_marker`)
   ic_highlight_fun_t* highlighter;  // highlight callback
@@ -52,6 +58,14 @@ struct ic_env_s {
 };
 
 ic_private char*        ic_editline(ic_env_t* env, const char* prompt_text);
+ic_private bool         ic_editline_start(ic_env_t* env, const char* prompt_text);
+ic_private bool         ic_editline_poll(ic_env_t* env, char** line);
+ic_private bool         ic_editline_feed(ic_env_t* env, const char* bytes, ssize_t len, char** line);
+ic_private void         ic_editline_done(ic_env_t* env);
+
+ic_private bool         ic_async_output_flush(ic_env_t* env);
+ic_private void         ic_async_output_edit_start(ic_env_t* env);
+ic_private void         ic_async_output_edit_done(ic_env_t* env);
 
 ic_private ic_env_t*    ic_get_env(void);
 ic_private const char*  ic_env_get_auto_braces(ic_env_t* env);
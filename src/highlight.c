@@ -108,6 +108,47 @@ ic_public void ic_highlight(ic_highlight_env_t* henv, long pos, long count, cons
   highlight_attr(henv,pos,count,bbcode_style( henv->bbcode, style ));
 }
 
+ic_public void ic_highlight_style(ic_highlight_env_t* henv, long pos, long count, ic_style_handle_t style ) {
+  if (henv == NULL || style <= 0 || pos < 0) return;
+  highlight_attr(henv,pos,count,bbcode_style_at( henv->bbcode, style ));
+}
+
+ic_public void ic_highlight_spans(ic_highlight_env_t* henv, const ic_highlight_span_t* spans, long n ) {
+  if (henv == NULL || spans == NULL || n <= 0) return;
+  // sorted spans that do not overlap are applied together in one pass over the attribute runs
+  attr_span_t* batch = mem_malloc_tp_n(henv->mem, attr_span_t, (ssize_t)n);
+  ssize_t count = 0;
+  ic_style_handle_t style = 0;
+  attr_t attr = attr_none();
+  for( long i = 0; i < n; i++) {
+    const ic_highlight_span_t* span = &spans[i];
+    if (span->style <= 0 || span->pos < 0) continue;
+    if (span->style != style) {  // consecutive tokens often share a style
+      style = span->style;
+      attr = bbcode_style_at(henv->bbcode, style);
+    }
+    ssize_t pos = span->pos;
+    ssize_t len = span->count;
+    pos_adjust(henv, &pos, &len);
+    if (pos < 0 || len <= 0) continue;
+    if (batch == NULL) {
+      attrbuf_update_at(henv->attrs, pos, len, attr);
+      continue;
+    }
+    if (count > 0 && pos < batch[count-1].pos + batch[count-1].count) {
+      // out of order or overlapping: apply the spans before it first
+      attrbuf_update_spans(henv->attrs, batch, count);
+      count = 0;
+    }
+    batch[count].pos   = pos;
+    batch[count].count = len;
+    batch[count].attr  = attr;
+    count++;
+  }
+  attrbuf_update_spans(henv->attrs, batch, count);
+  mem_free(henv->mem, batch);
+}
+
 ic_public void ic_highlight_formatted(ic_highlight_env_t* henv, const char* s, const char* fmt) {
   if (s==NULL || s[0] == 0 || fmt==NULL) return;
   attrbuf_t* attrs = attrbuf_new(henv->mem);
@@ -118,8 +159,12 @@ ic_public void ic_highlight_formatted(ic_highlight_env_t* henv, const char* s, c
     if (sbuf_len(out) != len) {
       debug_msg("highlight: formatted string content differs from the original input:\n  original: %s\n  formatted: %s\n", s, fmt);
     }
-    for( ssize_t i = 0; i < len; i++) {
-      attrbuf_update_at(henv->attrs, i, 1, attrbuf_attr_at(attrs,i));
+    for( ssize_t i = 0; i < len; ) {
+      ssize_t n = 0;
+      const attr_t attr = attrbuf_run_at(attrs, i, &n);
+      if (n <= 0 || n > len - i) { n = len - i; }
+      attrbuf_update_at(henv->attrs, i, n, attr);
+      i += n;
     }
   }
   sbuf_free(out);
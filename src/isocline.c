@@ -79,6 +79,41 @@ ic_public char* ic_readline(const char* prompt_text)
   }
 }
 
+ic_public bool ic_readline_start(const char* prompt_text) {
+  ic_env_t* env = ic_get_env();
+  if (env == NULL || env->noedit) return false;
+  return ic_editline_start(env, prompt_text);  // in editline.c
+}
+
+ic_public int ic_readline_get_fd(void) {
+  ic_env_t* env = ic_get_env();
+  if (env == NULL || env->tty == NULL) return -1;
+  return tty_get_fd(env->tty);
+}
+
+ic_public int ic_readline_get_wake_fd(void) {
+  ic_env_t* env = ic_get_env();
+  if (env == NULL || env->tty == NULL) return -1;
+  return tty_get_wake_fd(env->tty);
+}
+
+ic_public bool ic_readline_poll(char** line) {
+  ic_env_t* env = ic_get_env();
+  if (line == NULL) return false;
+  *line = NULL;
+  if (env == NULL) return true;
+  return ic_editline_poll(env, line);
+}
+
+ic_public bool ic_readline_feed(const char* bytes, size_t len, char** line) {
+  ic_env_t* env = ic_get_env();
+  if (line == NULL) return false;
+  *line = NULL;
+  if (env == NULL) return true;
+  if (bytes == NULL) len = 0;
+  return ic_editline_feed(env, bytes, (ssize_t)len, line);
+}
+
 
 //-------------------------------------------------------------
 // Read a line from the stdin stream if there is no editing 
@@ -115,19 +150,51 @@ ic_public void ic_printf(const char* fmt, ...) {
   va_end(ap);
 }
 
+static bool ic_async_output_lock(ic_env_t* env);
+static void ic_async_output_unlock(ic_env_t* env, bool locked);
+
 ic_public void ic_vprintf(const char* fmt, va_list args) {
   ic_env_t* env = ic_get_env(); if (env==NULL || env->bbcode == NULL) return;
+  const bool locked = ic_async_output_lock(env);
   bbcode_vprintf(env->bbcode, fmt, args);
+  ic_async_output_unlock(env, locked);
 }
 
 ic_public void ic_print(const char* s) {
   ic_env_t* env = ic_get_env(); if (env==NULL || env->bbcode==NULL) return;
+  const bool locked = ic_async_output_lock(env);
   bbcode_print(env->bbcode, s);
+  ic_async_output_unlock(env, locked);
 }
 
 ic_public void ic_println(const char* s) {
   ic_env_t* env = ic_get_env(); if (env==NULL || env->bbcode==NULL) return;
+  const bool locked = ic_async_output_lock(env);
   bbcode_println(env->bbcode, s);
+  ic_async_output_unlock(env, locked);
+}
+
+ic_public ic_format_t* ic_format_compile(const char* fmt) {
+  ic_env_t* env = ic_get_env(); if (env==NULL || env->bbcode==NULL) return NULL;
+  return bbcode_format_compile(env->bbcode, fmt);
+}
+
+ic_public void ic_format_print(const ic_format_t* fmt, ...) {
+  va_list ap;
+  va_start(ap, fmt);
+  ic_format_vprint(fmt, ap);
+  va_end(ap);
+}
+
+ic_public void ic_format_vprint(const ic_format_t* fmt, va_list args) {
+  ic_env_t* env = ic_get_env(); if (env==NULL || env->bbcode==NULL) return;
+  const bool locked = ic_async_output_lock(env);
+  bbcode_format_vprint(env->bbcode, fmt, args);
+  ic_async_output_unlock(env, locked);
+}
+
+ic_public void ic_format_free(ic_format_t* fmt) {
+  bbcode_format_free(fmt);
 }
 
 void ic_style_def(const char* name, const char* fmt) {
@@ -135,6 +202,11 @@ void ic_style_def(const char* name, const char* fmt) {
   bbcode_style_def(env->bbcode, name, fmt);
 }
 
+ic_public ic_style_handle_t ic_style_lookup(const char* style_name) {
+  ic_env_t* env = ic_get_env(); if (env==NULL || env->bbcode==NULL) return 0;
+  return (ic_style_handle_t)bbcode_style_lookup(env->bbcode, style_name);
+}
+
 void ic_style_open(const char* fmt) {
   ic_env_t* env = ic_get_env(); if (env==NULL || env->bbcode==NULL) return;
   bbcode_style_open(env->bbcode, fmt);
@@ -146,6 +218,109 @@ void ic_style_close(void) {
 }
 
 
+//-------------------------------------------------------------
+// Asynchronous output
+// Messages are pushed on a lock-free stack by any thread; the 
+// first message of a batch wakes up the editor which takes 
+// the whole stack at once and prints it in order.
+// If no editor is active, the thread that pushes the first
+// message of a batch prints the stack itself. The `async_state`
+// ensures only one thread writes to the terminal at a time: it
+// is taken by the editor for the whole edit, and by a thread
+// while it prints. Whoever releases it prints the messages
+// that were pushed in the meantime.
+//-------------------------------------------------------------
+
+static char ic_async_tag_editing;
+static char ic_async_tag_printing;
+#define IC_ASYNC_EDITING   ((void*)&ic_async_tag_editing)
+#define IC_ASYNC_PRINTING  ((void*)&ic_async_tag_printing)
+
+// try to take the terminal (and wait while another thread prints if `wait` is set);
+// returns `false` if an editor is active (or another thread prints and `wait` is not set).
+static bool ic_async_output_take(ic_env_t* env, void* tag, bool wait) {
+  void* expected = NULL;
+  while (!ic_atomic_cas_ptr(&env->async_state, &expected, tag)) {
+    if (expected == IC_ASYNC_EDITING || (expected != NULL && !wait)) return false;
+    expected = NULL;
+  }
+  return true;
+}
+
+// release the terminal and print the messages that were pushed while we held it
+static void ic_async_output_release(ic_env_t* env) {
+  do {
+    if (ic_async_output_flush(env)) { term_flush(env->term); }
+    ic_atomic_exchange_ptr(&env->async_state, NULL);
+  } while (ic_atomic_load_ptr(&env->async_output) != NULL && ic_async_output_take(env, IC_ASYNC_PRINTING, false));
+}
+
+static bool ic_async_output_lock(ic_env_t* env) {
+  return ic_async_output_take(env, IC_ASYNC_PRINTING, true);  // (`false` when printing from within the editor)
+}
+
+static void ic_async_output_unlock(ic_env_t* env, bool locked) {
+  if (locked) ic_async_output_release(env);
+}
+
+ic_private void ic_async_output_edit_start(ic_env_t* env) {
+  ic_async_output_take(env, IC_ASYNC_EDITING, true);
+}
+
+ic_private void ic_async_output_edit_done(ic_env_t* env) {
+  ic_async_output_release(env);
+}
+
+typedef struct async_msg_s {
+  struct async_msg_s* next;
+  char                text[1];
+} async_msg_t;
+
+ic_public void ic_print_async(const char* s) {
+  ic_env_t* env = ic_get_env(); if (env==NULL || s==NULL) return;
+  const ssize_t len = ic_strlen(s);
+  async_msg_t* msg = (async_msg_t*)mem_malloc(env->mem, ssizeof(async_msg_t) + len);
+  if (msg == NULL) return;
+  ic_memcpy(msg->text, s, len + 1);
+  void* head = ic_atomic_load_ptr(&env->async_output);
+  do {
+    msg->next = (async_msg_t*)head;
+  } while (!ic_atomic_cas_ptr(&env->async_output, &head, msg));
+  if (head != NULL) return;  // not the first message of a batch
+  if (ic_async_output_take(env, IC_ASYNC_PRINTING, false)) {
+    // no editor is active: print directly
+    ic_async_output_release(env);
+  }
+  else if (env->tty != NULL) {
+    // wake up the editor (or the thread that prints releases and prints it)
+    tty_async_post(env->tty, KEY_EVENT_OUTPUT);
+  }
+}
+
+// print all pending asynchronous output (on the main thread); returns `true` if anything was printed.
+ic_private bool ic_async_output_flush(ic_env_t* env) {
+  async_msg_t* msg = (async_msg_t*)ic_atomic_exchange_ptr(&env->async_output, NULL);
+  if (msg == NULL) return false;
+  // reverse to print in order
+  async_msg_t* rev = NULL;
+  while (msg != NULL) {
+    async_msg_t* next = msg->next;
+    msg->next = rev;
+    rev = msg;
+    msg = next;
+  }
+  buffer_mode_t bmode = term_set_buffer_mode(env->term, BUFFERED);
+  while (rev != NULL) {
+    async_msg_t* next = rev->next;
+    if (env->bbcode != NULL) { bbcode_println(env->bbcode, rev->text); }
+    mem_free(env->mem, rev);
+    rev = next;
+  }
+  term_set_buffer_mode(env->term, bmode);
+  return true;
+}
+
+
 //-------------------------------------------------------------
 // Interface
 //-------------------------------------------------------------
@@ -192,6 +367,16 @@ ic_public bool ic_enable_beep( bool enable ) {
   return term_enable_beep(env->term, enable);
 }
 
+ic_public bool ic_enable_kitty_keyboard( bool enable ) {
+  ic_env_t* env = ic_get_env(); if (env==NULL || env->term==NULL) return false;
+  return term_enable_kitty_keys(env->term, enable);
+}
+
+ic_public void ic_set_term_cache( const char* fname ) {
+  ic_env_t* env = ic_get_env(); if (env==NULL || env->term==NULL) return;
+  term_set_cache(env->term, fname);
+}
+
 ic_public bool ic_enable_color( bool enable ) {
   ic_env_t* env = ic_get_env(); if (env==NULL) return false;
   return term_enable_color( env->term, enable );
@@ -486,9 +671,13 @@ static void ic_atexit(void);
 
 static void ic_env_free(ic_env_t* env) {
   if (env == NULL) return;
+  ic_editline_done(env);
+  mem_free(env->mem, env->input_rest);
+  ic_async_output_flush(env);
   history_save(env->history);
   history_free(env->history);
   completions_free(env->completions);
+  dircache_free(env->dircache);
   bbcode_free(env->bbcode);
   term_free(env->term);
   tty_free(env->tty);
@@ -22,6 +22,9 @@
 #include "wcwidth.c"
 // #endif
 
+// grapheme cluster break properties
+#include "graphemes.c"
+
 #include <stdio.h>
 #include <string.h>
 #include <inttypes.h>
@@ -29,64 +32,112 @@
 #include "common.h"
 #include "stringbuf.h"
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define IC_SIMD_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define IC_SIMD_SSE2
+#endif
+#if defined(_MSC_VER) && (defined(IC_SIMD_AVX2) || defined(IC_SIMD_SSE2))
+#include <intrin.h>
+#endif
+
 //-------------------------------------------------------------
 // In place growable utf-8 strings
 //-------------------------------------------------------------
 
+// A row of the string as laid out on the terminal
+typedef struct row_info_s {
+  ssize_t start;
+  ssize_t len;
+  ssize_t startw;    // prompt width
+  ssize_t maxw;      // upper bound of the column width of any prefix of the row (or -1 if unknown)
+  bool    is_wrap;
+} row_info_t;
+
+// A position with its column on its row (without the prompt)
+typedef struct row_mark_s {
+  ssize_t pos;
+  ssize_t row;
+  ssize_t col;
+} row_mark_t;
+
+// Cached row layout for a terminal and prompt width (see `sbuf_rows_update`)
+typedef struct row_index_s {
+  row_info_t* rows;
+  ssize_t     rows_count;
+  ssize_t     rows_capacity;
+  row_mark_t* marks;
+  ssize_t     marks_count;
+  ssize_t     marks_capacity;
+  ssize_t     termw;
+  ssize_t     promptw;
+  ssize_t     cpromptw;
+  bool        complete;   // if not complete, the last row is still open
+} row_index_t;
+
 struct stringbuf_s {
-  char*     buf;
-  ssize_t   buflen;
-  ssize_t   count;  
-  alloc_t*  mem;
+  char*       buf;
+  ssize_t     buflen;
+  ssize_t     count;  
+  alloc_t*    mem;
+  row_index_t rowidx;
 };
 
 
 //-------------------------------------------------------------
-// String column width
+// Code point decoding and column width
 //-------------------------------------------------------------
 
-// column width of a utf8 single character sequence.
-static ssize_t utf8_char_width( const char* s, ssize_t n ) {
-  if (n <= 0) return 0;
-
+// decode a utf8 single character sequence; returns -1 if invalid.
+static int32_t utf8_decode( const char* s, ssize_t n ) {
+  if (n <= 0) return -1;
   uint8_t b = (uint8_t)s[0];
-  int32_t c;
-  if (b < ' ') {
-    return 0;
-  }
-  else if (b <= 0x7F) {
-    return 1;
+  if (b <= 0x7F) {
+    return b;
   }
   else if (b <= 0xC1) { // invalid continuation byte or invalid 0xC0, 0xC1 (check is strictly not necessary as we don't validate..)
-    return 1;
+    return -1;
   }
   else if (b <= 0xDF && n >= 2) { // b >= 0xC2  // 2 bytes
-    c = (((b & 0x1F) << 6) | (s[1] & 0x3F));
+    int32_t c = (((b & 0x1F) << 6) | (s[1] & 0x3F));
     assert(c < 0xD800 || c > 0xDFFF);
-    int w = wcwidth(c);
-    return w;
+    return c;
   }
   else if (b <= 0xEF && n >= 3) { // b >= 0xE0  // 3 bytes 
-    c = (((b & 0x0F) << 12) | ((s[1] & 0x3F) << 6) | (s[2] & 0x3F));
-    return wcwidth(c);    
+    return (((b & 0x0F) << 12) | ((s[1] & 0x3F) << 6) | (s[2] & 0x3F));
   }
   else if (b <= 0xF4 && n >= 4) { // b >= 0xF0  // 4 bytes 
-    c = (((b & 0x07) << 18) | ((s[1] & 0x3F) << 12) | ((s[2] & 0x3F) << 6) | (s[3] & 0x3F));
-    return wcwidth(c);
+    return (((b & 0x07) << 18) | ((s[1] & 0x3F) << 12) | ((s[2] & 0x3F) << 6) | (s[3] & 0x3F));
   }
   else {
     // failed
-    return 1;
+    return -1;
   }
 }
 
+// column width of a unicode code point (or -1 if invalid).
+static ssize_t unicode_char_width( int32_t c ) {
+  if (c < 0) {
+    return 1;   // invalid
+  }
+  else if (c < ' ') {
+    return 0;
+  }
+  else if (c <= 0x7F) {
+    return 1;
+  }
+  else {
+    return wcwidth(c);
+  }
+}
 
 // The column width of a codepoint (0, 1, or 2)
-static ssize_t char_column_width( const char* s, ssize_t n ) {
-  if (s == NULL || n <= 0) return 0;
-  else if ((uint8_t)(*s) < ' ') return 0;   // also for CSI escape sequences
+static ssize_t unicode_column_width( int32_t c ) {
+  if (c >= 0 && c < ' ') return 0;   // also for CSI escape sequences
   else {
-    ssize_t w = utf8_char_width(s, n);
+    ssize_t w = unicode_char_width(c);
     #ifdef _WIN32
     return (w <= 0 ? 1 : w); // windows console seems to use at least one column
     #else
@@ -95,15 +146,201 @@ static ssize_t char_column_width( const char* s, ssize_t n ) {
   }
 }
 
+// The column width of a utf8 single character sequence
+static ssize_t char_column_width( const char* s, ssize_t n ) {
+  if (s == NULL || n <= 0) return 0;
+  return unicode_column_width(utf8_decode(s, n));
+}
+
+//-------------------------------------------------------------
+// Grapheme clusters
+// <https://www.unicode.org/reports/tr29>
+//
+// We navigate by extended grapheme clusters so emoji sequences,
+// flags, and combining marks move and delete as one character and
+// take the columns the terminal uses to display them. 
+//-------------------------------------------------------------
+
+// byte length of the utf8 sequence that starts at `pos`
+static ssize_t utf8_next_len( const char* s, ssize_t len, ssize_t pos ) {
+  ssize_t ofs = 1;
+  while (len > pos + ofs) {
+    uint8_t u = (uint8_t)s[pos + ofs];
+    if (u < 0x80 || u > 0xBF) break;  // break if not a follower
+    ofs++;
+  }
+  return ofs;
+}
+
+// byte length of the utf8 sequence that ends at `pos` (> 0)
+static ssize_t utf8_prev_len( const char* s, ssize_t pos ) {
+  ssize_t ofs = 1;
+  while (pos > ofs) {
+    uint8_t u = (uint8_t)s[pos - ofs];
+    if (u < 0x80 || u > 0xBF) break;  // continue while follower
+    ofs++;
+  }
+  return ofs;
+}
+
+static gcb_t utf8_gcb( const char* s, ssize_t n ) {
+  return gcb_of(utf8_decode(s, n));
+}
+
+// Is there a cluster boundary between code points with properties `p` and `q`? (GB3 to GB9b)
+// Emoji ZWJ sequences (GB11) and regional indicator pairs (GB12, GB13) need 
+// more context and are handled by the caller.
+static bool gcb_is_break( gcb_t p, gcb_t q ) {
+  if (p == GCB_CR && q == GCB_LF) return false;                                   // GB3
+  if (p == GCB_CR || p == GCB_LF || p == GCB_CONTROL) return true;                // GB4
+  if (q == GCB_CR || q == GCB_LF || q == GCB_CONTROL) return true;                // GB5
+  if (p == GCB_L && (q == GCB_L || q == GCB_V || q == GCB_LV || q == GCB_LVT)) return false;  // GB6
+  if ((p == GCB_LV || p == GCB_V) && (q == GCB_V || q == GCB_T)) return false;    // GB7
+  if ((p == GCB_LVT || p == GCB_T) && q == GCB_T) return false;                   // GB8
+  if (q == GCB_EXTEND || q == GCB_ZWJ || q == GCB_SPACINGMARK) return false;      // GB9, GB9a
+  if (p == GCB_PREPEND) return false;                                             // GB9b
+  return true;                                                                    // GB999
+}
+
+// Segmentation state for the rules that need more context than
+// the previous code point.
+typedef struct gcb_state_s {
+  gcb_t   prev;     // property of the previous code point
+  bool    emoji;    // ExtPict Extend* 
+  bool    joined;   // ExtPict Extend* ZWJ
+  ssize_t ri;       // count of trailing regional indicators
+} gcb_state_t;
+
+static void gcb_state_start( gcb_state_t* st, gcb_t p ) {
+  st->prev   = p;
+  st->emoji  = (p == GCB_EXTPICT);
+  st->joined = false;
+  st->ri     = (p == GCB_RI ? 1 : 0);
+}
+
+// Is there a cluster boundary before a code point with property `q`? 
+// (and advance the state to include `q`)
+static bool gcb_state_is_break( gcb_state_t* st, gcb_t q ) {
+  bool brk = gcb_is_break(st->prev, q);
+  if (brk) {
+    if (st->joined && q == GCB_EXTPICT) brk = false;                                 // GB11
+    else if (st->prev == GCB_RI && q == GCB_RI && (st->ri % 2) == 1) brk = false;   // GB12, GB13
+  }
+  st->joined = (st->emoji && q == GCB_ZWJ);
+  st->emoji  = (q == GCB_EXTPICT || (st->emoji && q == GCB_EXTEND));
+  st->ri     = (q == GCB_RI ? st->ri + 1 : 0);   // (the parity stays correct after a break)
+  st->prev   = q;
+  return brk;
+}
+
+// The column width of a cluster of width `w` extended with the code point `c`.
+// This is the sum of the code point widths, except that joined emoji and 
+// skin tone modifiers take no extra columns, and an emoji presentation 
+// selector makes a narrow character wide.
+static ssize_t gcb_extend_width( ssize_t w, gcb_t p, gcb_t q, int32_t c ) {
+  if (p == GCB_ZWJ && q == GCB_EXTPICT) return w;    // joined emoji are displayed as one
+  if (c == 0xFE0F) return (w == 1 ? 2 : w);          // emoji presentation
+  if (c >= 0x1F3FB && c <= 0x1F3FF) return w;        // skin tone modifier
+  return w + unicode_char_width(c);
+}
+
+// Length of the grapheme cluster that starts at `pos`. 
+static ssize_t str_cluster_len( const char* s, ssize_t len, ssize_t pos, ssize_t* cwidth ) {
+  ssize_t ofs = utf8_next_len(s, len, pos);
+  int32_t c   = utf8_decode(s + pos, ofs);
+  ssize_t w   = unicode_column_width(c);
+  gcb_state_t st;
+  gcb_state_start(&st, gcb_of(c));
+  while (len > pos + ofs) {
+    const ssize_t n = utf8_next_len(s, len, pos + ofs);
+    c = utf8_decode(s + pos + ofs, n);
+    const gcb_t   p = st.prev;
+    const gcb_t   q = gcb_of(c);
+    if (gcb_state_is_break(&st, q)) break;
+    w = gcb_extend_width(w, p, q, c);
+    ofs += n;
+  }
+  if (cwidth != NULL) *cwidth = w;
+  return ofs;
+}
+
+// Is the code point ending at `pos` preceded by ExtPict Extend*? (for GB11)
+static bool str_is_emoji_before( const char* s, ssize_t pos ) {
+  while (pos > 0) {
+    const ssize_t n = utf8_prev_len(s, pos);
+    const gcb_t   p = utf8_gcb(s + pos - n, n);
+    if (p == GCB_EXTPICT) return true;
+    if (p != GCB_EXTEND) return false;
+    pos -= n;
+  }
+  return false;
+}
+
+// The number of regional indicators that end at `pos` (for GB12, GB13)
+static ssize_t str_count_ri_before( const char* s, ssize_t pos ) {
+  ssize_t count = 0;
+  while (pos > 0) {
+    const ssize_t n = utf8_prev_len(s, pos);
+    if (utf8_gcb(s + pos - n, n) != GCB_RI) break;
+    count++;
+    pos -= n;
+  }
+  return count;
+}
+
+
+
+//-------------------------------------------------------------
+// String column width
+//-------------------------------------------------------------
+
+ic_private bool skip_esc( const char* s, ssize_t len, ssize_t* esclen );
+
 static ssize_t str_column_width_n( const char* s, ssize_t len ) {
   if (s == NULL || len <= 0) return 0;
   ssize_t pos = 0;
   ssize_t cwidth = 0;
   ssize_t cw;
   ssize_t ofs;
-  while (s[pos] != 0 && (ofs = str_next_ofs(s, len, pos, &cw)) > 0) {
+  while (true) {
+    // plain ascii characters are one column each 
+    // (except the last one if it may start a grapheme cluster)
+    ssize_t ascii = str_ascii_run(s + pos, len - pos);
+    if (ascii > 0 && pos + ascii < len && (uint8_t)s[pos + ascii] >= 0x80) ascii--;
+    cwidth += ascii;
+    pos += ascii;
+    if (pos >= len || s[pos] == 0) break;
+    if (skip_esc(s + pos, len - pos, &ofs)) {
+      pos += ofs;
+      continue;
+    }
+    if ((uint8_t)s[pos] < 0x80 && s[pos] != '\r' && (pos + 1 >= len || (uint8_t)s[pos+1] < 0x80)) {
+      pos++;  // a control character on its own
+      continue;
+    }
+    // go through the code points (just once) until we are back at ascii
+    ssize_t n = utf8_next_len(s, len, pos);
+    int32_t c = utf8_decode(s + pos, n);
+    gcb_state_t st;
+    gcb_state_start(&st, gcb_of(c));
+    cw = unicode_column_width(c);
+    pos += n;
+    while (pos < len && s[pos] != 0) {
+      n = utf8_next_len(s, len, pos);
+      c = utf8_decode(s + pos, n);
+      const gcb_t   p = st.prev;
+      const gcb_t   q = gcb_of(c);
+      if (gcb_state_is_break(&st, q)) {
+        if ((uint8_t)s[pos] < 0x80) break;   
+        cwidth += cw;
+        cw = unicode_column_width(c);
+      }
+      else {
+        cw = gcb_extend_width(cw, p, q, c);
+      }
+      pos += n;
+    }
     cwidth += cw;
-    pos += ofs;
   }  
   return cwidth;
 }
@@ -146,19 +383,88 @@ ic_private ssize_t str_take_while_fit( const char* s, ssize_t max_width) {
 // String navigation 
 //-------------------------------------------------------------
 
-// get offset of the previous codepoint. does not skip back over CSI sequences.
+// get offset of the previous grapheme cluster. does not skip back over CSI sequences.
 ic_private ssize_t str_prev_ofs( const char* s, ssize_t pos, ssize_t* width ) {
-  ssize_t ofs = 0;
-  if (s != NULL && pos > 0) {
-    ofs = 1;
-    while (pos > ofs) {
-      uint8_t u = (uint8_t)s[pos - ofs];
-      if (u < 0x80 || u > 0xBF) break;  // continue while follower
-      ofs++;
+  if (s == NULL || pos <= 0) {
+    if (width != NULL) *width = 0;
+    return 0;
+  }
+  // fast path: an ascii character preceded by ascii is a cluster by itself (except for CR LF)
+  const uint8_t b = (uint8_t)s[pos-1];
+  if (b < 0x80 && b != '\n' && (pos == 1 || (uint8_t)s[pos-2] < 0x80)) {
+    if (width != NULL) *width = (b >= ' ' ? 1 : 0);
+    return 1;
+  }
+  ssize_t start = pos - utf8_prev_len(s, pos);
+  gcb_t q = utf8_gcb(s + start, pos - start);
+  while (start > 0) {
+    const ssize_t n = utf8_prev_len(s, start);
+    const gcb_t   p = utf8_gcb(s + start - n, n);
+    if (gcb_is_break(p, q)) {
+      if (p == GCB_ZWJ && q == GCB_EXTPICT && str_is_emoji_before(s, start - n)) {
+        // GB11
+      }
+      else if (p == GCB_RI && q == GCB_RI && (str_count_ri_before(s, start - n) % 2) == 0) {
+        // GB12, GB13
+      }
+      else break;
     }
+    start -= n;
+    q = p;
   }
-  if (width != NULL) *width = char_column_width( s+(pos-ofs), ofs );
-  return ofs;
+  if (width != NULL) str_cluster_len(s, pos, start, width);
+  return (pos - start);
+}
+
+//-------------------------------------------------------------
+// Scan for plain ascii: most output is plain ascii so we find 
+// the next control character (including ESC and 0) or utf-8 byte
+// (>= 0x80) 32 (AVX2) or 16 (SSE2) bytes at a time, or 8 bytes at
+// a time in portable code.
+//-------------------------------------------------------------
+
+#if defined(IC_SIMD_AVX2) || defined(IC_SIMD_SSE2)
+static inline ssize_t ic_ctz32(uint32_t x) {  // x != 0
+  #if defined(_MSC_VER)
+  unsigned long idx;
+  _BitScanForward(&idx, x);
+  return (ssize_t)idx;
+  #else
+  return (ssize_t)__builtin_ctz(x);
+  #endif
+}
+#endif
+
+// Length of the prefix of plain ascii characters (0x20 to 0x7F)
+ic_private ssize_t str_ascii_run( const char* s, ssize_t len ) {
+  if (s == NULL || len <= 0) return 0;
+  ssize_t i = 0;
+  // as signed bytes, the plain ascii characters are exactly those greater than 0x1F
+  #if defined(IC_SIMD_AVX2)
+  const __m256i lo32 = _mm256_set1_epi8(0x1F);
+  for (; i + 32 <= len; i += 32) {
+    const __m256i v = _mm256_loadu_si256((const __m256i*)(const void*)(s + i));
+    const uint32_t plain = (uint32_t)_mm256_movemask_epi8(_mm256_cmpgt_epi8(v, lo32));
+    if (plain != 0xFFFFFFFFU) return i + ic_ctz32(~plain);
+  }
+  #endif
+  #if defined(IC_SIMD_AVX2) || defined(IC_SIMD_SSE2)
+  const __m128i lo16 = _mm_set1_epi8(0x1F);
+  for (; i + 16 <= len; i += 16) {
+    const __m128i v = _mm_loadu_si128((const __m128i*)(const void*)(s + i));
+    const uint32_t plain = (uint32_t)_mm_movemask_epi8(_mm_cmpgt_epi8(v, lo16));
+    if (plain != 0xFFFFU) return i + ic_ctz32(~plain & 0xFFFFU);
+  }
+  #else
+  for (; i + 8 <= len; i += 8) {
+    uint64_t w;
+    memcpy(&w, s + i, 8);
+    // the high bit is set in a byte >= 0x80, or (due to the borrow) in a byte < 0x20
+    if (((w | (w - 0x2020202020202020ULL)) & 0x8080808080808080ULL) != 0) break;  
+  }
+  #endif
+  while (i < len && (uint8_t)s[i] >= 0x20 && (uint8_t)s[i] <= 0x7F) { i++; }
+  return i;
 }
 
 // skip an escape sequence
@@ -199,21 +505,21 @@ ic_private bool skip_esc( const char* s, ssize_t len, ssize_t* esclen ) {
   return false;
 }
 
-// Offset to the next codepoint, treats CSI escape sequences as a single code point.
+// Offset to the next grapheme cluster, treats CSI escape sequences as a single code point.
 ic_private ssize_t str_next_ofs( const char* s, ssize_t len, ssize_t pos, ssize_t* cwidth ) {
   ssize_t ofs = 0;
   if (s != NULL && len > pos) {
-    if (skip_esc(s+pos,len-pos,&ofs)) {
+    // fast path: an ascii character followed by ascii is a cluster by itself (except for CR LF and escape sequences)
+    const uint8_t b = (uint8_t)s[pos];
+    if (b < 0x80 && b != '\r' && b != '\x1B' && (len == pos + 1 || (uint8_t)s[pos+1] < 0x80)) {
+      if (cwidth != NULL) *cwidth = (b >= ' ' ? 1 : 0);
+      return 1;
+    }
+    else if (skip_esc(s+pos,len-pos,&ofs)) {
       // skip escape sequence      
     }
     else {
-      ofs = 1;
-      // utf8 extended character?
-      while(len > pos + ofs) {
-        uint8_t u = (uint8_t)s[pos + ofs];
-        if (u < 0x80 || u > 0xBF) break;  // break if not a follower
-        ofs++;
-      }      
+      return str_cluster_len(s, len, pos, cwidth);
     } 
   }
   if (cwidth != NULL) *cwidth = char_column_width( s+pos, ofs );
@@ -355,6 +661,7 @@ static ssize_t str_for_each_row( const char* s, ssize_t len, ssize_t termw, ssiz
       rcount++;
       rstart = i;
       rcol   = 0;
+      startw = cpromptw;  // of the new row (which may be closed by a newline right away)
     }
     if (s[i] == '\n') {
       // newline
@@ -369,6 +676,7 @@ static ssize_t str_for_each_row( const char* s, ssize_t len, ssize_t termw, ssiz
     i += next;
     rcol += w;
   }
+  startw = (rcount == 0 ? promptw : cpromptw);
   if (fun != NULL) {
     if (fun(s,rcount,rstart,i - rstart,startw,false,arg,res)) return rcount;
   }
@@ -542,6 +850,255 @@ static ssize_t str_get_pos_at_rc(const char* s, ssize_t len, ssize_t termw, ssiz
 }
 
 
+//-------------------------------------------------------------
+// Row index
+// The row layout of a string buffer is cached for a given terminal
+// and prompt width: the start and length of each row, and column marks
+// at each row start and every `IC_ROW_MARK_STRIDE` bytes within a row.
+// A row/column query is then a binary search followed by a short scan
+// from the nearest mark. Edits invalidate the index from the edit 
+// position onward and the next query only lays out the rest.
+//-------------------------------------------------------------
+
+#define IC_ROW_MARK_STRIDE  (256)
+
+static void row_index_done( alloc_t* mem, row_index_t* ri ) {
+  mem_free(mem, ri->rows);
+  mem_free(mem, ri->marks);
+  memset(ri, 0, sizeof(*ri));
+}
+
+static void row_index_clear( row_index_t* ri ) {
+  ri->rows_count  = 0;
+  ri->marks_count = 0;
+  ri->complete    = false;
+}
+
+static bool row_index_push_row( alloc_t* mem, row_index_t* ri, ssize_t start ) {
+  if (ri->rows_count >= ri->rows_capacity) {
+    ssize_t newcap = (ri->rows_capacity <= 0 ? 16 : 2*ri->rows_capacity);
+    row_info_t* newrows = mem_realloc_tp(mem, row_info_t, ri->rows, newcap);
+    if (newrows == NULL) return false;
+    ri->rows = newrows;
+    ri->rows_capacity = newcap;
+  }
+  row_info_t* row = &ri->rows[ri->rows_count++];
+  row->start   = start;
+  row->len     = 0;
+  row->startw  = 0;
+  row->maxw    = -1;
+  row->is_wrap = false;
+  return true;
+}
+
+static bool row_index_push_mark( alloc_t* mem, row_index_t* ri, ssize_t pos, ssize_t row, ssize_t col ) {
+  if (ri->marks_count >= ri->marks_capacity) {
+    ssize_t newcap = (ri->marks_capacity <= 0 ? 16 : 2*ri->marks_capacity);
+    row_mark_t* newmarks = mem_realloc_tp(mem, row_mark_t, ri->marks, newcap);
+    if (newmarks == NULL) return false;
+    ri->marks = newmarks;
+    ri->marks_capacity = newcap;
+  }
+  row_mark_t* mark = &ri->marks[ri->marks_count++];
+  mark->pos = pos;
+  mark->row = row;
+  mark->col = col;
+  return true;
+}
+
+static void row_index_close_row( row_index_t* ri, ssize_t row, ssize_t end, ssize_t startw, ssize_t maxw, bool is_wrap ) {
+  assert(row < ri->rows_count);
+  ri->rows[row].len     = end - ri->rows[row].start;
+  ri->rows[row].startw  = startw;
+  ri->rows[row].maxw    = maxw;
+  ri->rows[row].is_wrap = is_wrap;
+}
+
+// index of the last mark with a position `<= pos` (or -1)
+static ssize_t row_index_find_mark( const row_index_t* ri, ssize_t pos ) {
+  ssize_t lo = 0;
+  ssize_t hi = ri->marks_count;
+  while (lo < hi) {
+    ssize_t mid = lo + (hi - lo)/2;
+    if (ri->marks[mid].pos <= pos) lo = mid + 1;
+                              else hi = mid;
+  }
+  return lo - 1;
+}
+
+// invalidate the row index from `pos` onward
+static void sbuf_rows_invalidate( stringbuf_t* sbuf, ssize_t pos ) {
+  row_index_t* ri = &sbuf->rowidx;
+  if (ri->marks_count == 0) return;
+  // the grapheme cluster before `pos` may join with the changed text
+  // (and with invalid utf-8 a lead byte may join with continuation bytes at `pos`)
+  if (pos > sbuf->count) pos = sbuf->count;
+  while (pos > 0 && pos < sbuf->count && (uint8_t)sbuf->buf[pos] >= 0x80 && (uint8_t)sbuf->buf[pos] <= 0xBF) pos--;
+  if (pos > 0) pos -= str_prev_ofs(sbuf->buf, pos, NULL);
+  const ssize_t m = row_index_find_mark(ri, pos - 1);  // last mark before `pos`
+  if (m < 0) {
+    row_index_clear(ri);
+    return;
+  }
+  ri->marks_count = m + 1;
+  ri->rows_count  = ri->marks[m].row + 1;  // the row of the last mark is open again
+  ri->complete    = false;
+}
+
+// Lay out the rest of the string; returns `false` on allocation failure.
+// This must match `str_for_each_row`.
+static bool sbuf_rows_update( stringbuf_t* sbuf, ssize_t termw, ssize_t promptw, ssize_t cpromptw ) {
+  row_index_t* ri = &sbuf->rowidx;
+  if (ri->termw != termw || ri->promptw != promptw || ri->cpromptw != cpromptw) {
+    row_index_clear(ri);
+    ri->termw    = termw;
+    ri->promptw  = promptw;
+    ri->cpromptw = cpromptw;
+  }
+  if (ri->complete) return true;
+  
+  const char*   s   = (sbuf->buf == NULL ? "" : sbuf->buf);
+  const ssize_t len = sbuf->count;
+  ssize_t i;
+  ssize_t rcount;
+  ssize_t rcol;
+  ssize_t rmax;   // maximal `rcol` on the current row (or -1 if unknown)
+  ssize_t rstart;
+  ssize_t lastmark;
+  ssize_t startw;
+  bool    stride = true;  // can we place marks within the current row?
+  bool    wrapped = false; // did we already wrap at `i`?
+  if (ri->marks_count == 0) {
+    if (!row_index_push_row(sbuf->mem, ri, 0) || !row_index_push_mark(sbuf->mem, ri, 0, 0, 0)) goto failed;
+    i = rcount = rcol = rmax = rstart = 0;
+  }
+  else {
+    // resume from the last mark
+    const row_mark_t* mark = &ri->marks[ri->marks_count-1];
+    i      = mark->pos;
+    rcount = mark->row;
+    rcol   = mark->col;
+    rstart = ri->rows[rcount].start;
+    rmax   = ri->rows[rcount].maxw;  // still an upper bound as the row is unchanged up to the mark
+    wrapped = (rcount > 0 && i == rstart && ri->rows[rcount-1].is_wrap);
+    if (i > 0 && i == rstart && s[i-1] == '\n') {
+      // a newline row starts right after the newline, but stray continuation 
+      // bytes after it are scanned as part of the newline
+      ssize_t w;
+      i = (i-1) + str_next_ofs(s, len, i-1, &w);
+      rcol = w;
+      stride = (i == rstart);
+      if (!stride) rmax = -1;
+    }
+  }
+  lastmark = i;
+  while (i < len) {
+    ssize_t w;
+    ssize_t next = str_next_ofs(s, len, i, &w);    
+    if (next <= 0) {
+      assert(false);
+      break;
+    }
+    startw = (rcount == 0 ? promptw : cpromptw);
+    ssize_t termcol = rcol + w + startw + 1 /* for the cursor */;
+    if (termw != 0 && i != 0 && termcol >= termw && !wrapped) {  
+      // wrap
+      row_index_close_row(ri, rcount, i, startw, rmax, true);
+      rcount++;
+      rstart = i;
+      rcol   = 0;
+      rmax   = 0;
+      stride = true;
+      startw = cpromptw;  // of the new row (which may be closed by a newline right away)
+      if (!row_index_push_row(sbuf->mem, ri, rstart) || !row_index_push_mark(sbuf->mem, ri, rstart, rcount, 0)) goto failed;
+      lastmark = rstart;
+    }
+    if (s[i] == '\n') {
+      // newline
+      row_index_close_row(ri, rcount, i, startw, rmax, false);
+      rcount++;
+      rstart = i+1;
+      rcol = 0;
+      stride = (next == 1);  // rows are measured from their start which is not a scan point otherwise
+      rmax = (stride ? 0 : -1);
+      if (!row_index_push_row(sbuf->mem, ri, rstart) || !row_index_push_mark(sbuf->mem, ri, rstart, rcount, 0)) goto failed;
+      lastmark = rstart;
+    }
+    i += next;
+    rcol += w;
+    if (rmax >= 0 && rcol > rmax) rmax = rcol;
+    wrapped = false;
+    if (stride && i - lastmark >= IC_ROW_MARK_STRIDE && i < len) {
+      if (!row_index_push_mark(sbuf->mem, ri, i, rcount, rcol)) goto failed;
+      lastmark = i;
+    }
+  }
+  startw = (rcount == 0 ? promptw : cpromptw);
+  row_index_close_row(ri, rcount, i, startw, rmax, false);
+  assert(ri->rows_count == rcount + 1);
+  ri->complete = true;
+  return true;
+
+failed:
+  row_index_clear(ri);
+  return false;
+}
+
+static ssize_t sbuf_rows_get_rc_at_pos( stringbuf_t* sbuf, ssize_t pos, rowcol_t* rc ) {
+  const row_index_t* ri = &sbuf->rowidx;
+  memset(rc, 0, sizeof(*rc));
+  if (pos < 0 || pos > sbuf->count) return ri->rows_count;
+  const ssize_t m = row_index_find_mark(ri, pos);
+  assert(m >= 0);
+  const row_mark_t* mark = &ri->marks[m];
+  const row_info_t* row  = &ri->rows[mark->row];
+  const char* s = (sbuf->buf == NULL ? "" : sbuf->buf);
+  rc->row_start = row->start;
+  rc->row_len   = row->len;
+  rc->row = mark->row;
+  rc->col = mark->col + str_column_width_n( s + mark->pos, pos - mark->pos );
+  rc->first_on_row = (pos == row->start);
+  if (row->is_wrap) {
+    // if wrapped, we check if the next character is at row_len
+    ssize_t next = str_next_ofs(s, row->start + row->len, pos, NULL);
+    rc->last_on_row = (pos + next >= row->start + row->len);
+  }
+  else {
+    // normal last position is right after the last character
+    rc->last_on_row = (pos >= row->start + row->len); 
+  }
+  return ri->rows_count;
+}
+
+static ssize_t sbuf_rows_get_pos_at_rc( stringbuf_t* sbuf, ssize_t row, ssize_t col ) {
+  const row_index_t* ri = &sbuf->rowidx;
+  if (row < 0 || row >= ri->rows_count) return -1;
+  const row_info_t* rinfo = &ri->rows[row];
+  const ssize_t end = rinfo->start + rinfo->len;
+  // find the last mark on the row before the column (where the first mark of a row is its start)
+  ssize_t lo = 0;
+  ssize_t hi = ri->marks_count - 1;
+  while (lo < hi) {
+    ssize_t mid = lo + (hi - lo + 1)/2;
+    if (ri->marks[mid].row < row || (ri->marks[mid].row == row && ri->marks[mid].col < col)) lo = mid;
+                                                                                           else hi = mid - 1;
+  }
+  if (ri->marks[lo].row < row) lo++;   // (the row start mark)
+  assert(lo >= 0 && ri->marks[lo].row == row);
+  const char* s = (sbuf->buf == NULL ? "" : sbuf->buf);
+  ssize_t i  = ri->marks[lo].pos;
+  ssize_t cw = ri->marks[lo].col;
+  while (cw < col && i < end) {
+    ssize_t w;
+    ssize_t next = str_next_ofs(s, end, i, &w);
+    if (next <= 0) break;
+    i  += next;
+    cw += w;
+  }
+  return i;
+}
+
+
 //-------------------------------------------------------------
 // String buffer
 //-------------------------------------------------------------
@@ -571,9 +1128,11 @@ static void sbuf_init( stringbuf_t* sbuf, alloc_t* mem ) {
   sbuf->buf = NULL;
   sbuf->buflen = 0;
   sbuf->count = 0;
+  memset(&sbuf->rowidx, 0, sizeof(sbuf->rowidx));
 }
 
 static void sbuf_done( stringbuf_t* sbuf ) {
+  row_index_done( sbuf->mem, &sbuf->rowidx );
   mem_free( sbuf->mem, sbuf->buf );
   sbuf->buf = NULL;
   sbuf->buflen = 0;
@@ -644,14 +1203,15 @@ ic_private ssize_t sbuf_append_vprintf(stringbuf_t* sb, const char* fmt, va_list
   ssize_t avail = sb->buflen - sb->count;
   va_list args0;
   va_copy(args0, args);
-  ssize_t needed = vsnprintf(sb->buf + sb->count, to_size_t(avail), fmt, args0);
+  ssize_t needed = vsnprintf(sb->buf + sb->count, to_size_t(avail + 1), fmt, args0);  // (+1 for the terminating zero)
   if (needed > avail) {
     sb->buf[sb->count] = 0;
     if (!sbuf_ensure_extra(sb, needed)) return sb->count;
     avail = sb->buflen - sb->count;
-    needed = vsnprintf(sb->buf + sb->count, to_size_t(avail), fmt, args);
+    needed = vsnprintf(sb->buf + sb->count, to_size_t(avail + 1), fmt, args);
   }
   assert(needed <= avail);
+  sbuf_rows_invalidate(sb, sb->count);
   sb->count += (needed > avail ? avail : (needed >= 0 ? needed : 0));
   assert(sb->count <= sb->buflen);
   sb->buf[sb->count] = 0;
@@ -671,10 +1231,12 @@ ic_private ssize_t sbuf_insert_at_n(stringbuf_t* sbuf, const char* s, ssize_t n,
   if (pos < 0 || pos > sbuf->count || s == NULL) return pos;
   n = str_limit_to_length(s,n);
   if (n <= 0 || !sbuf_ensure_extra(sbuf,n)) return pos;
+  sbuf_rows_invalidate(sbuf, pos);
   ic_memmove(sbuf->buf + pos + n, sbuf->buf + pos, sbuf->count - pos);
   ic_memcpy(sbuf->buf + pos, s, n);
   sbuf->count += n;
   sbuf->buf[sbuf->count] = 0;
+  sbuf_rows_invalidate(sbuf, pos);
   return (pos + n);
 }
 
@@ -684,6 +1246,8 @@ ic_private stringbuf_t* sbuf_split_at( stringbuf_t* sb, ssize_t pos ) {
   if (pos < sb->count) {
     sbuf_append_n(res, sb->buf + pos, sb->count - pos);
     sb->count = pos;
+    sb->buf[sb->count] = 0;
+    sbuf_rows_invalidate(sb, pos);
   }
   return res;
 }
@@ -710,9 +1274,11 @@ ic_private ssize_t sbuf_insert_unicode_at(stringbuf_t* sbuf, unicode_t u, ssize_
 ic_private void sbuf_delete_at( stringbuf_t* sbuf, ssize_t pos, ssize_t count ) {
   if (pos < 0 || pos >= sbuf->count) return;
   if (pos + count > sbuf->count) count = sbuf->count - pos;
+  sbuf_rows_invalidate(sbuf, pos);
   ic_memmove(sbuf->buf + pos, sbuf->buf + pos + count, sbuf->count - pos - count);
   sbuf->count -= count;
   sbuf->buf[sbuf->count] = 0;
+  sbuf_rows_invalidate(sbuf, pos);
 }
 
 ic_private void sbuf_delete_from_to( stringbuf_t* sbuf, ssize_t pos, ssize_t end ) {
@@ -797,6 +1363,7 @@ ic_private ssize_t sbuf_swap_char( stringbuf_t* sbuf, ssize_t pos ) {
   ic_memcpy(buf, sbuf->buf + pos - prev, prev );
   ic_memmove(sbuf->buf + pos - prev, sbuf->buf + pos, next);
   ic_memmove(sbuf->buf + pos - prev + next, buf, prev);
+  sbuf_rows_invalidate(sbuf, pos - prev);
   return pos - prev;
 }
 
@@ -826,21 +1393,54 @@ ic_private ssize_t sbuf_find_ws_word_end( stringbuf_t* sbuf, ssize_t pos ) {
 
 // find row/col position
 ic_private ssize_t sbuf_get_pos_at_rc( stringbuf_t* sbuf, ssize_t termw, ssize_t promptw, ssize_t cpromptw, ssize_t row, ssize_t col ) {
-  return str_get_pos_at_rc( sbuf->buf, sbuf->count, termw, promptw, cpromptw, row, col);
+  if (!sbuf_rows_update(sbuf, termw, promptw, cpromptw)) {
+    return str_get_pos_at_rc( sbuf->buf, sbuf->count, termw, promptw, cpromptw, row, col);
+  }
+  return sbuf_rows_get_pos_at_rc( sbuf, row, col );
 }
 
 // get row/col for a given position
 ic_private ssize_t sbuf_get_rc_at_pos( stringbuf_t* sbuf, ssize_t termw, ssize_t promptw, ssize_t cpromptw, ssize_t pos, rowcol_t* rc ) {
-  return str_get_rc_at_pos( sbuf->buf, sbuf->count, termw, promptw, cpromptw, pos, rc);
+  if (!sbuf_rows_update(sbuf, termw, promptw, cpromptw)) {
+    return str_get_rc_at_pos( sbuf->buf, sbuf->count, termw, promptw, cpromptw, pos, rc);
+  }
+  return sbuf_rows_get_rc_at_pos( sbuf, pos, rc );
 }
 
 ic_private ssize_t sbuf_get_wrapped_rc_at_pos( stringbuf_t* sbuf, ssize_t termw, ssize_t newtermw, ssize_t promptw, ssize_t cpromptw, ssize_t pos, rowcol_t* rc ) {
-  return str_get_wrapped_rc_at_pos( sbuf->buf, sbuf->count, termw, newtermw, promptw, cpromptw, pos, rc);
+  if (!sbuf_rows_update(sbuf, termw, promptw, cpromptw)) {
+    return str_get_wrapped_rc_at_pos( sbuf->buf, sbuf->count, termw, newtermw, promptw, cpromptw, pos, rc);
+  }
+  wrapped_arg_t warg;
+  warg.pos = pos;
+  warg.newtermw = newtermw;
+  wrowcol_t wrc;
+  memset(&wrc,0,sizeof(wrc));
+  const row_index_t* ri = &sbuf->rowidx;
+  const char* s = (sbuf->buf == NULL ? "" : sbuf->buf);
+  for (ssize_t row = 0; row < ri->rows_count; row++) {
+    const row_info_t* rinfo = &ri->rows[row];
+    // only scan rows that may hard-wrap at the new width, or that contain `pos`
+    const bool has_pos = (pos >= rinfo->start && pos <= rinfo->start + rinfo->len);
+    if (!has_pos && rinfo->maxw >= 0 && rinfo->startw + rinfo->maxw + (rinfo->is_wrap ? 2 : 0) <= newtermw) continue;
+    str_get_current_wrapped_pos_iter(s, row, rinfo->start, rinfo->len, rinfo->startw, rinfo->is_wrap, &warg, &wrc);
+  }
+  *rc = wrc.rc;
+  return (ri->rows_count + wrc.hrows);
 }
 
 ic_private ssize_t sbuf_for_each_row( stringbuf_t* sbuf, ssize_t termw, ssize_t promptw, ssize_t cpromptw, row_fun_t* fun, void* arg, void* res ) {
   if (sbuf == NULL) return 0;
-  return str_for_each_row( sbuf->buf, sbuf->count, termw, promptw, cpromptw, fun, arg, res);
+  if (!sbuf_rows_update(sbuf, termw, promptw, cpromptw)) {
+    return str_for_each_row( sbuf->buf, sbuf->count, termw, promptw, cpromptw, fun, arg, res);
+  }
+  const row_index_t* ri = &sbuf->rowidx;
+  const char* s = (sbuf->buf == NULL ? "" : sbuf->buf);
+  for (ssize_t row = 0; row < ri->rows_count; row++) {
+    const row_info_t* rinfo = &ri->rows[row];
+    if (fun != NULL && fun(s, row, rinfo->start, rinfo->len, rinfo->startw, rinfo->is_wrap, arg, res)) return row;
+  }
+  return ri->rows_count;
 }
 
 
@@ -22,6 +22,7 @@
 #include <unistd.h>
 #include <errno.h>
 #include <sys/ioctl.h>
+#include <sys/uio.h>   // writev
 #if defined(__linux__)
 #include <linux/kd.h>
 #endif
@@ -47,6 +48,15 @@ struct term_s {
   bool          nocolor;            // show colors?
   bool          silent;             // enable beep?
   bool          is_utf8;            // utf-8 output? determined by the tty
+  bool          kitty_keys;         // use the kitty keyboard protocol when reading keys?
+  ssize_t       kitty_level;        // raw level at which the kitty keyboard flags were pushed (or 0)
+  bool          probed;             // did we probe the terminal capabilities? (see `term_probe`)
+  bool          probe_answered;     // did the terminal answer the probe?
+  bool          kitty_supported;    // does the terminal support the kitty keyboard protocol? (from the probe)
+  bool          sync_output;        // does the terminal support synchronized output? (from the probe)
+  uint32_t      ansi16_valid;       // bit mask of the `ansi16` colors returned by the probe
+  uint32_t      ansi16[16];         // the probed ansi colors
+  char*         cache_fname;        // capability cache file (or NULL)
   attr_t   attr;               // current text attributes
   palette_t     palette;            // color support
   buffer_mode_t bufmode;            // buffer mode
@@ -66,6 +76,7 @@ struct term_s {
 
 static bool term_write_direct(term_t* term, const char* s, ssize_t n );
 static void term_append_buf(term_t* term, const char* s, ssize_t n);
+static void term_check_flush(term_t* term, bool contains_nl);
 
 //-------------------------------------------------------------
 // Colors
@@ -153,31 +164,33 @@ ic_private attr_t term_get_attr( const term_t* term ) {
   return term->attr;
 }
 
+// we append the SGR sequences directly to the buffer and update the attributes 
+// ourselves, there is no need to parse our own escape sequences again (see `term_append_esc`)
 ic_private void term_set_attr( term_t* term, attr_t attr ) {
   if (term->nocolor) return;
   if (attr.x.color != term->attr.x.color && attr.x.color != IC_COLOR_NONE) {
-    term_color(term,attr.x.color);
-    if (term->palette < ANSIRGB && color_is_rgb(attr.x.color)) {
-      term->attr.x.color = attr.x.color; // actual color may have been approximated but we keep the actual color to avoid updating every time
-    }
+    term_append_color(term,term->buf,attr.x.color);
+    term->attr.x.color = attr.x.color; // actual color may have been approximated but we keep the actual color to avoid updating every time
   }
   if (attr.x.bgcolor != term->attr.x.bgcolor && attr.x.bgcolor != IC_COLOR_NONE) {
-    term_bgcolor(term,attr.x.bgcolor);
-    if (term->palette < ANSIRGB && color_is_rgb(attr.x.bgcolor)) {
-      term->attr.x.bgcolor = attr.x.bgcolor; 
-    }
+    term_append_bgcolor(term,term->buf,attr.x.bgcolor);
+    term->attr.x.bgcolor = attr.x.bgcolor; 
   }
   if (attr.x.bold != term->attr.x.bold && attr.x.bold != IC_NONE) {
-    term_bold(term,attr.x.bold == IC_ON);
+    sbuf_append(term->buf, attr.x.bold == IC_ON ? IC_CSI "1m" : IC_CSI "22m");
+    term->attr.x.bold = attr.x.bold;
   }
   if (attr.x.underline != term->attr.x.underline && attr.x.underline != IC_NONE) {
-    term_underline(term,attr.x.underline == IC_ON);
+    sbuf_append(term->buf, attr.x.underline == IC_ON ? IC_CSI "4m" : IC_CSI "24m");
+    term->attr.x.underline = attr.x.underline;
   }
   if (attr.x.reverse != term->attr.x.reverse && attr.x.reverse != IC_NONE) {
-    term_reverse(term,attr.x.reverse == IC_ON);
+    sbuf_append(term->buf, attr.x.reverse == IC_ON ? IC_CSI "7m" : IC_CSI "27m");
+    term->attr.x.reverse = attr.x.reverse;
   }
   if (attr.x.italic != term->attr.x.italic && attr.x.italic != IC_NONE) {
-    term_italic(term,attr.x.italic == IC_ON);
+    sbuf_append(term->buf, attr.x.italic == IC_ON ? IC_CSI "3m" : IC_CSI "23m");
+    term->attr.x.italic = attr.x.italic;
   }  
   assert(attr.x.color == term->attr.x.color || attr.x.color == IC_COLOR_NONE);
   assert(attr.x.bgcolor == term->attr.x.bgcolor || attr.x.bgcolor == IC_COLOR_NONE);
@@ -213,14 +226,148 @@ ic_private void term_vwritef(term_t* term, const char* fmt, va_list args ) {
   sbuf_append_vprintf(term->buf, fmt, args);
 }
 
-ic_private void term_write_formatted( term_t* term, const char* s, const attr_t* attrs ) {
-  term_write_formatted_n( term, s, attrs, ic_strlen(s));
+//-------------------------------------------------------------
+// Trusted output of formatted text: text runs that need no 
+// processing (see `term_is_plain`) are not rescanned, and in 
+// `UNBUFFERED` mode, the SGR sequences and the text runs are 
+// collected in an iovec list and written at once with `writev` 
+// without copying the text. In the buffered modes the runs are 
+// appended to `term->buf` so a refresh is still written at once
+// (and wrapped in a synchronized update, see `term_flush`).
+//-------------------------------------------------------------
+
+#define TERM_IOV_MAX  (64)
+
+typedef struct term_iov_s {
+  ssize_t      count;
+  ssize_t      buf_start;            // start of the part of `term->buf` that is not in the list yet
+  const char*  text[TERM_IOV_MAX];   // external text, or NULL for a part of `term->buf`
+  ssize_t      ofs[TERM_IOV_MAX];    // offset in `term->buf` (if `text` is NULL)
+  ssize_t      len[TERM_IOV_MAX];
+} term_iov_t;
+
+// can the text be written as is? (no control characters, escape sequences, or raw bytes)
+static bool term_is_plain(const char* s, ssize_t n) {
+  ssize_t i = 0;
+  while ((i += str_ascii_run(s + i, n - i)) < n) {
+    const uint8_t c = (uint8_t)s[i];
+    if (c < ' ' || c == 0xF3) return false;  // 0xF3 may start an encoded raw byte (see `unicode_is_raw`)
+    i++;
+  }
+  return true;
+}
+
+#if !defined(_WIN32)
+
+static bool term_writev_direct(term_t* term, struct iovec* iov, int count) {
+  while (count > 0) {
+    ssize_t nwritten = writev(term->fd_out, iov, count);
+    if (nwritten < 0) {
+      if (errno != EINTR && errno != EAGAIN) {
+        debug_msg("term: writev failed: errno %i\n", errno);
+        return false;
+      }
+      continue;
+    }
+    // skip the written parts
+    size_t n = (size_t)nwritten;
+    while (count > 0 && n >= iov->iov_len) {
+      n -= iov->iov_len;
+      iov++;
+      count--;
+    }
+    if (count > 0) {
+      iov->iov_base = (char*)iov->iov_base + n;
+      iov->iov_len -= n;
+    }
+  }
+  return true;
 }
 
-ic_private void term_write_formatted_n( term_t* term, const char* s, const attr_t* attrs, ssize_t len ) {
+static void term_iov_add(term_iov_t* iov, const char* text, ssize_t ofs, ssize_t len) {
+  assert(iov->count < TERM_IOV_MAX);
+  iov->text[iov->count] = text;
+  iov->ofs[iov->count]  = ofs;
+  iov->len[iov->count]  = len;
+  iov->count++;
+}
+
+// add the part of the buffer that is not yet in the list; returns false if the list is full
+static bool term_iov_add_buf(term_t* term, term_iov_t* iov) {
+  const ssize_t buflen = sbuf_len(term->buf);
+  if (buflen > iov->buf_start) {
+    if (iov->count >= TERM_IOV_MAX) return false;
+    term_iov_add(iov, NULL, iov->buf_start, buflen - iov->buf_start);
+    iov->buf_start = buflen;
+  }
+  return true;
+}
+
+// write out the list together with the rest of the buffer
+static void term_iov_write(term_t* term, term_iov_t* iov) {
+  if (iov->count == 0) return;
+  assert(term->bufmode == UNBUFFERED);  // (text runs are only collected when unbuffered)
+  const bool complete = term_iov_add_buf(term, iov);
+  struct iovec vecs[TERM_IOV_MAX];
+  const char* buf = sbuf_string(term->buf);
+  for (ssize_t i = 0; i < iov->count; i++) {
+    vecs[i].iov_base = (void*)(iov->text[i] != NULL ? iov->text[i] : buf + iov->ofs[i]);
+    vecs[i].iov_len  = to_size_t(iov->len[i]);
+  }
+  term_writev_direct(term, vecs, (int)iov->count);
+  if (!complete) {
+    // the list was full: write the rest of the buffer separately
+    vecs[0].iov_base = (void*)(buf + iov->buf_start);
+    vecs[0].iov_len  = to_size_t(sbuf_len(term->buf) - iov->buf_start);
+    term_writev_direct(term, vecs, 1);
+  }
+  sbuf_clear(term->buf);
+  iov->count = 0;
+  iov->buf_start = 0;
+}
+
+static void term_iov_add_text(term_t* term, term_iov_t* iov, const char* s, ssize_t n) {
+  // keep room for the buffer before the text and the buffer after it at the final write
+  if (iov->count + 3 > TERM_IOV_MAX) {
+    term_iov_write(term, iov);
+  }
+  term_iov_add_buf(term, iov);
+  term_iov_add(iov, s, 0, n);
+}
+
+#else
+
+static void term_iov_write(term_t* term, term_iov_t* iov) {
+  ic_unused(term); ic_unused(iov);
+}
+
+#endif
+
+// write a text run of formatted output
+static void term_write_run(term_t* term, term_iov_t* iov, const char* s, ssize_t n) {
+  if (!term_is_plain(s, n)) {
+    term_iov_write(term, iov);  // keep the order as `term_append_buf` may flush
+    term_append_buf(term, s, n);
+  }
+  #if !defined(_WIN32)
+  else if (term->bufmode == UNBUFFERED) {
+    term_iov_add_text(term, iov, s, n);
+  }
+  #endif
+  else {
+    sbuf_append_n(term->buf, s, n);
+    term_check_flush(term, false);
+  }
+}
+
+ic_private void term_write_formatted( term_t* term, const char* s, attrbuf_t* attrs ) {
+  term_write_formatted_n( term, s, attrs, 0, ic_strlen(s));
+}
+
+ic_private void term_write_formatted_n( term_t* term, const char* s, attrbuf_t* attrs, ssize_t start, ssize_t len ) {
   if (attrs == NULL) {
     // write directly
-    term_write(term,s);
+    term_write_n(term, s + start, len);
   }
   else {
     // ensure raw mode from now on
@@ -228,29 +375,31 @@ ic_private void term_write_formatted_n( term_t* term, const char* s, const attr_
       term_start_raw(term);
     }
     // and output with text attributes
+    term_iov_t iov;
+    iov.count = 0;
+    iov.buf_start = 0;
     const attr_t default_attr = term_get_attr(term);
     attr_t attr = attr_none();
-    ssize_t i = 0;
-    ssize_t n = 0;
-    while( i+n < len && s[i+n] != 0 ) {
-      if (!attr_is_eq(attr,attrs[i+n])) {
-        if (n > 0) { 
-          term_write_n( term, s+i, n );
-          i += n;
-          n = 0;
-        }
-        attr = attrs[i];
+    const ssize_t end = start + len;
+    ssize_t i = start;
+    while( i < end && s[i] != 0 ) {
+      // write a run of equal attributes at once
+      ssize_t n = 0;
+      const attr_t run_attr = attrbuf_run_at(attrs, i, &n);
+      if (n <= 0 || n > end - i) { n = end - i; }
+      if (!attr_is_eq(attr,run_attr)) {
+        attr = run_attr;
         term_set_attr( term, attr_update_with(default_attr,attr) );
-      }  
-      n++;    
-    }
-    if (n > 0) {
-      term_write_n( term, s+i, n );
-      i += n;
-      n = 0;    
+      }
+      ssize_t m = 0;
+      while( m < n && s[i+m] != 0 ) { m++; }
+      term_write_run( term, &iov, s+i, m );
+      i += m;
+      if (m < n) break;
     }
-    assert(s[i] != 0 || i == len);
+    assert(i == end || s[i] == 0);
     term_set_attr(term, default_attr);
+    term_iov_write(term, &iov);  // the external text must be written before we return
   }
 }
 
@@ -293,6 +442,11 @@ ic_private void term_write_n(term_t* term, const char* s, ssize_t n) {
 
 ic_private void term_flush(term_t* term) {
   if (sbuf_len(term->buf) > 0) {
+    if (term->sync_output && term->bufmode == BUFFERED) {
+      // let the terminal render the buffered output at once (DEC mode 2026)
+      sbuf_insert_at(term->buf, IC_CSI "?2026h", 0);
+      sbuf_append(term->buf, IC_CSI "?2026l");
+    }
     //term_show_cursor(term,false);
     term_write_direct(term, sbuf_string(term->buf), sbuf_len(term->buf));
     //term_show_cursor(term,true);
@@ -422,6 +576,12 @@ ic_private bool term_enable_beep(term_t* term, bool enable) {
   return prev;
 }
 
+ic_private bool term_enable_kitty_keys(term_t* term, bool enable) {
+  bool prev = term->kitty_keys;
+  term->kitty_keys = enable;
+  return prev;
+}
+
 ic_private bool term_enable_color(term_t* term, bool enable) {
   bool prev = !term->nocolor;
   term->nocolor = !enable;
@@ -433,6 +593,7 @@ ic_private void term_free(term_t* term) {
   term_flush(term);
   term_end_raw(term, true);
   sbuf_free(term->buf); term->buf = NULL;
+  mem_free(term->mem, term->cache_fname);
   mem_free(term->mem, term);
 }
 
@@ -480,17 +641,13 @@ static void term_append_buf( term_t* term, const char* s, ssize_t len ) {
   bool newline = false;
   while (pos < len) {
     // handle ascii sequences in bulk
-    ssize_t ascii = 0;
-    ssize_t next;
-    while ((next = str_next_ofs(s, len, pos+ascii, NULL)) > 0 && 
-            (uint8_t)s[pos + ascii] > '\x1B' && (uint8_t)s[pos + ascii] <= 0x7F ) 
-    {
-      ascii += next;      
-    }
+    const ssize_t ascii = str_ascii_run(s+pos, len-pos);
     if (ascii > 0) {
       sbuf_append_n(term->buf, s+pos, ascii);
       pos += ascii;
     }
+    if (pos >= len) break;
+    const ssize_t next = str_next_ofs(s, len, pos, NULL);
     if (next <= 0) break;
 
     const uint8_t c = (uint8_t)s[pos];
@@ -878,9 +1035,10 @@ static bool term_esc_query_raw( term_t* term, const char* query, char* buf, ssiz
 
 static bool term_esc_query( term_t* term, const char* query, char* buf, ssize_t buflen ) 
 {
+  const bool was_raw = tty_is_raw(term->tty);
   if (!tty_start_raw(term->tty)) return false;  
   bool ok = term_esc_query_raw(term,query,buf,buflen);  
-  tty_end_raw(term->tty);
+  if (!was_raw) { tty_end_raw(term->tty); }
   return ok;
 }
 
@@ -894,10 +1052,6 @@ static bool term_get_cursor_pos( term_t* term, ssize_t* row, ssize_t* col)
   return true;
 }
 
-static void term_set_cursor_pos( term_t* term, ssize_t row, ssize_t col ) {
-  term_writef( term, IC_CSI "%zd;%zdH", row, col );
-}
-
 ic_private bool term_update_dim(term_t* term) {  
   ssize_t cols = 0;
   ssize_t rows = 0;
@@ -908,19 +1062,19 @@ ic_private bool term_update_dim(term_t* term) {
     rows = ws.ws_row;
   }
   else {
-    // determine width by querying the cursor position
+    // determine width by querying the cursor position at the bottom-right;
+    // we save and restore the cursor (ESC 7, ESC 8) so this takes a single round trip.
     debug_msg("term: ioctl term-size failed: %d,%d\n", ws.ws_row, ws.ws_col);
-    ssize_t col0 = 0;
-    ssize_t row0 = 0;
-    if (term_get_cursor_pos(term,&row0,&col0)) {
-      term_set_cursor_pos(term,999,999);
+    if (term->tty != NULL && isatty(term->fd_out)) {  // (never write the query to a pipe)
+      term_flush(term);
+      term_write_direct(term, "\x1B" "7" IC_CSI "999;999H", 12);
       ssize_t col1 = 0;
       ssize_t row1 = 0;
       if (term_get_cursor_pos(term,&row1,&col1)) {
         cols = col1;
         rows = row1;
       }
-      term_set_cursor_pos(term,row0,col0);
+      term_write_direct(term, "\x1B" "8", 2);
     }
     else {
       // cannot query position
@@ -969,9 +1123,26 @@ ic_private bool term_update_dim(term_t* term) {
 #if !defined(_WIN32)
 
 // On non-windows, the terminal is set in raw mode by the tty.
+// When reading keys (the tty is raw) we may also push the kitty keyboard protocol 
+// "disambiguate" flag (`CSI > 1 u`) so the ESC key and alt/ctrl keys are reported
+// as unambiguous `CSI .. u` sequences (if the probe found it is supported).
+
+static void term_probe(term_t* term);
+static bool term_probe_colors(term_t* term);
 
 ic_private void term_start_raw(term_t* term) {
   term->raw_enabled++;
+  if (!term->probed && term_probe_colors(term)) {
+    // probe lazily so a capability cache (`term_set_cache`) can avoid it
+    term_probe(term);
+  }
+  if (term->kitty_keys && term->kitty_level == 0 && tty_is_raw(term->tty) && isatty(term->fd_out)) {
+    term_probe(term);
+    if (term->kitty_supported && term_write_direct(term, IC_CSI ">1u", 5)) {
+      term->kitty_level = term->raw_enabled;
+      tty_set_kitty_keys(term->tty, true);
+    }
+  }
 }
 
 ic_private void term_end_raw(term_t* term, bool force) {
@@ -982,16 +1153,25 @@ ic_private void term_end_raw(term_t* term, bool force) {
   else {
     term->raw_enabled = 0;
   }
+  if (term->kitty_level > term->raw_enabled) {
+    // pop the kitty keyboard flags
+    term_write_direct(term, IC_CSI "<u", 4);
+    term->kitty_level = 0;
+    tty_set_kitty_keys(term->tty, false);
+  }
 }
 
-static bool term_esc_query_color_raw(term_t* term, int color_idx, uint32_t* color ) {
-  char buf[128+1];
-  snprintf(buf,128,"\x1B]4;%d;?\x1B\\", color_idx);
-  if (!term_esc_query_raw( term, buf, buf, 128 )) {
-    debug_msg("esc query response not received\n");
-    return false;
-  }
-  if (buf[0] != '4') return false;
+//-------------------------------------------------------------
+// Probe terminal capabilities: instead of a round trip per query, 
+// all queries are written at once followed by a DA1 (`ESC [ c`) 
+// sentinel that every terminal answers. Responses are parsed as they 
+// arrive until the DA1 response; unsupported queries are just not answered.
+//-------------------------------------------------------------
+
+// parse an OSC 4 color response: `4;<idx>;rgb:<r>/<g>/<b>`
+static bool term_parse_color_reply(const char* buf, ssize_t* color_idx, uint32_t* color ) {
+  if (buf[0] != '4' || buf[1] != ';') return false;
+  if (!ic_atoz(buf+2, color_idx)) return false;
   const char* rgb = strchr(buf,':');
   if (rgb==NULL) return false;
   rgb++; // skip ':'
@@ -1003,10 +1183,101 @@ static bool term_esc_query_color_raw(term_t* term, int color_idx, uint32_t* colo
     b = (b+0x7F)/0x100; 
   }
   *color = (ic_cap8(r)<<16) | (ic_cap8(g)<<8) | ic_cap8(b);
-  debug_msg("color query: %02x,%02x,%02x: %06x\n", r, g, b, *color);  
+  debug_msg("color query: %zd: %02x,%02x,%02x: %06x\n", *color_idx, r, g, b, *color);  
   return true;
 }
 
+// query the ansi colors? 
+static bool term_probe_colors(term_t* term) {
+  // this seems to be unreliable on some systems (Ubuntu+Gnome terminal) so only enable when known ok.
+  #if __APPLE__
+  return (term->palette < ANSIRGB);
+  #else
+  ic_unused(term);
+  return false;
+  #endif
+}
+
+// use the probed ansi colors for better color approximation
+static void term_probe_apply(term_t* term) {
+  if (!term_probe_colors(term)) return;
+  for(ssize_t i = 0; i < 16; i++) {
+    if ((term->ansi16_valid & (1U << i)) == 0) continue;
+    debug_msg("term ansi color %zd: 0x%06x\n", i, term->ansi16[i]);
+  }
+  rgb_palette16_update(term->mem, term->ansi16, term->ansi16_valid);
+}
+
+static void term_probe(term_t* term) {
+  if (term->probed) return;
+  term->probed = true;
+  if (term->tty == NULL || !isatty(term->fd_out)) return;
+  stringbuf_t* query = sbuf_new(term->mem);
+  if (query == NULL) return;
+  const bool was_raw = tty_is_raw(term->tty);
+  if (!tty_start_raw(term->tty)) { 
+    sbuf_free(query);
+    return;
+  }
+  
+  // write all queries at once
+  if (term_probe_colors(term)) {
+    for (int i = 0; i < 16; i++) {
+      sbuf_appendf(query, "\x1B]4;%d;?\x1B\\", i);   // OSC 4 color
+    }
+  }
+  sbuf_append(query, IC_CSI "?u");                    // kitty keyboard flags
+  sbuf_append(query, IC_CSI "?2026$p");               // synchronized output mode (DECRQM)
+  sbuf_append(query, IC_CSI "c");                     // DA1 sentinel
+  debug_msg("term: probe terminal capabilities\n");
+  
+  // and parse the responses 
+  stringbuf_t* skipped = sbuf_new(term->mem);  // other input that arrives before the replies
+  if (skipped != NULL && term_write_direct(term, sbuf_string(query), sbuf_len(query))) {
+    char buf[128+1];
+    char esc_start;
+    while (tty_read_esc_reply(term->tty, &esc_start, buf, 128, skipped)) {
+      const ssize_t len = ic_strlen(buf);
+      if (esc_start == '[' && buf[0] == '?' && len > 0 && buf[len-1] == 'c') {
+        term->probe_answered = true;
+        break;  // DA1: done
+      }
+      else if (esc_start == '[' && strncmp(buf, "?2026;", 6) == 0) {
+        // mode is set (1) or reset (2)  (0 = unknown, 4 = permanently reset)
+        term->sync_output = (buf[6] == '1' || buf[6] == '2');
+      }
+      else if (esc_start == '[' && buf[0] == '?' && len > 0 && buf[len-1] == 'u') {
+        term->kitty_supported = true;
+      }
+      else if (esc_start == ']') {
+        ssize_t idx;
+        uint32_t color;
+        if (term_parse_color_reply(buf, &idx, &color) && idx >= 0 && idx < 16) {
+          term->ansi16[idx] = color;
+          term->ansi16_valid |= (1U << idx);
+        }
+      }
+      else if (esc_start == '[') {
+        // not a reply but a key sequence
+        sbuf_append(skipped, "\x1B[");
+        sbuf_append(skipped, buf);
+      }
+    }
+  }
+  sbuf_free(query);
+  if (skipped != NULL && !was_raw) {
+    // keep any further buffered input as ending raw mode discards it
+    uint8_t c;
+    while (tty_readc_noblock(term->tty, &c, 0)) { sbuf_append_char(skipped, (char)c); }
+  }
+  if (!was_raw) { tty_end_raw(term->tty); }
+  if (skipped != NULL) {
+    tty_unread(term->tty, sbuf_string(skipped), sbuf_len(skipped));
+    sbuf_free(skipped);
+  }
+  term_probe_apply(term);
+}
+
 // update ansi 16 color palette for better color approximation
 static void term_update_ansi16(term_t* term) {
   debug_msg("update ansi colors\n");
@@ -1016,30 +1287,22 @@ static void term_update_ansi16(term_t* term) {
   memset(cmap,0,48);
   if (ioctl(term->fd_out,GIO_CMAP,&cmap) >= 0) {
     // success
-    for(ssize_t i = 0; i < 48; i+=3) {
-      uint32_t color = ((uint32_t)(cmap[i]) << 16) | ((uint32_t)(cmap[i+1]) << 8) | cmap[i+2];
-      debug_msg("term (ioctl) ansi color %d: 0x%06x\n", i, color);
-      ansi256[i] = color;
+    uint32_t colors[16];
+    for(ssize_t i = 0; i < 16; i++) {
+      uint32_t color = ((uint32_t)(cmap[3*i]) << 16) | ((uint32_t)(cmap[3*i+1]) << 8) | cmap[3*i+2];
+      debug_msg("term (ioctl) ansi color %zd: 0x%06x\n", i, color);
+      colors[i] = color;
     }
+    rgb_palette16_update(term->mem, colors, 0xFFFF);
     return;
   }
   else {
     debug_msg("ioctl GIO_CMAP failed: entry 1: 0x%02x%02x%02x\n", cmap[3], cmap[4], cmap[5]);
   }
+  #else
+  ic_unused(term);
   #endif
-  // this seems to be unreliable on some systems (Ubuntu+Gnome terminal) so only enable when known ok.
-  #if __APPLE__
-  // otherwise use OSC 4 escape sequence query
-  if (tty_start_raw(term->tty)) {
-    for(ssize_t i = 0; i < 16; i++) {
-      uint32_t color;
-      if (!term_esc_query_color_raw(term, i, &color)) break;
-      debug_msg("term ansi color %d: 0x%06x\n", i, color);
-      ansi256[i] = color;
-    }  
-    tty_end_raw(term->tty);  
-  }
-  #endif
+  // otherwise we use the OSC 4 responses of the probe (see `term_probe_apply`)
 }
 
 static void term_init_raw(term_t* term) {
@@ -1104,14 +1367,16 @@ static void term_init_raw(term_t* term) {
     // store default attributes
     term->hcon_default_attr = info.wAttributes;
     // update our color table with the actual colors used.    
+    uint32_t colors[16];
     for (unsigned i = 0; i < 16; i++) {
       COLORREF cr = info.ColorTable[i];
       uint32_t color = (ic_cap8(GetRValue(cr))<<16) | (ic_cap8(GetGValue(cr))<<8) | ic_cap8(GetBValue(cr)); // COLORREF = BGR
       // index is also in reverse in the bits 0 and 2 
       unsigned j = (i&0x08) | ((i&0x04)>>2) | (i&0x02) | (i&0x01)<<2;
       debug_msg("term: ansi color %d is 0x%06x\n", j, color);
-      ansi256[j] = color;
+      colors[j] = color;
     }    
+    rgb_palette16_update(term->mem, colors, 0xFFFF);
   }
   else {
     DWORD err = GetLastError();
@@ -1122,3 +1387,140 @@ static void term_init_raw(term_t* term) {
 }
 
 #endif
+
+
+//-------------------------------------------------------------
+// Capability cache: the probed capabilities are saved to a file 
+// with one line per terminal identity: 
+// `<key> TAB <palette> <utf8> <kitty> <sync> <colors-mask> <color>*16`.
+// When found, we skip probing the terminal at startup.
+//-------------------------------------------------------------
+
+#define IC_TERM_CACHE_MAX   (64)   // maximal number of cached terminal identities
+
+#if !defined(_WIN32)
+
+// the terminal identity (from the environment) that the cache is keyed by
+static void term_cache_key(stringbuf_t* key) {
+  static const char* vars[] = { "TERM", "TERM_PROGRAM", "TERM_PROGRAM_VERSION", "COLORTERM", "VTE_VERSION", "LC_ALL", "LC_CTYPE", "LANG" };
+  sbuf_append(key, "v1");  // format version
+  for (size_t i = 0; i < sizeof(vars)/sizeof(vars[0]); i++) {
+    const char* val = getenv(vars[i]);
+    sbuf_append_char(key, ';');
+    for (; val != NULL && *val != 0; val++) {
+      sbuf_append_char(key, ((uint8_t)*val < ' ' ? '?' : *val));  // no tabs or newlines
+    }
+  }
+}
+
+static bool term_cache_parse(term_t* term, const char* s) {
+  unsigned long vals[21];
+  char* end = NULL;
+  for (int i = 0; i < 21; i++) {
+    vals[i] = strtoul(s, &end, (i < 4 ? 10 : 16));
+    if (end == s) return false;
+    s = end;
+  }
+  if (vals[0] > ANSIRGB) return false;
+  term->palette = (palette_t)vals[0];
+  term->is_utf8 = (vals[1] != 0);
+  term->kitty_supported = (vals[2] != 0);
+  term->sync_output = (vals[3] != 0);
+  term->ansi16_valid = (uint32_t)(vals[4] & 0xFFFF);
+  for (int i = 0; i < 16; i++) {
+    term->ansi16[i] = (uint32_t)(vals[5+i] & 0xFFFFFF);
+  }
+  return true;
+}
+
+static bool term_cache_load(term_t* term, const char* key) {
+  FILE* f = fopen(term->cache_fname, "r");
+  if (f == NULL) return false;
+  const ssize_t keylen = ic_strlen(key);
+  char line[1024];
+  bool found = false;
+  while (!found && fgets(line, 1024, f) != NULL) {
+    if (strncmp(line, key, to_size_t(keylen)) == 0 && line[keylen] == '\t') {
+      found = term_cache_parse(term, line + keylen + 1);
+    }
+  }
+  fclose(f);
+  debug_msg("term: capability cache %s\n", found ? "found" : "not found");
+  return found;
+}
+
+static void term_cache_save(term_t* term, const char* key) {
+  stringbuf_t* sb = sbuf_new(term->mem);
+  if (sb == NULL) return;
+  // our entry first, followed by the other entries
+  sbuf_appendf(sb, "%s\t%d %d %d %d %x", key, (int)term->palette, (term->is_utf8 ? 1 : 0), 
+                   (term->kitty_supported ? 1 : 0), (term->sync_output ? 1 : 0), term->ansi16_valid);
+  for (int i = 0; i < 16; i++) {
+    sbuf_appendf(sb, " %x", term->ansi16[i]);
+  }
+  sbuf_append_char(sb, '\n');
+  FILE* f = fopen(term->cache_fname, "r");
+  if (f != NULL) {
+    const ssize_t keylen = ic_strlen(key);
+    char line[1024];
+    int count = 1;
+    while (count < IC_TERM_CACHE_MAX && fgets(line, 1024, f) != NULL) {
+      const ssize_t len = ic_strlen(line);
+      if (len == 0 || line[len-1] != '\n') continue;  // too long or truncated
+      if (strncmp(line, key, to_size_t(keylen)) == 0 && line[keylen] == '\t') continue;
+      sbuf_append(sb, line);
+      count++;
+    }
+    fclose(f);
+  }
+  // write to a temporary file next to the cache and rename it over the cache so
+  // concurrent readers (and writers) never see a truncated or interleaved file
+  stringbuf_t* tmp = sbuf_new(term->mem);
+  if (tmp != NULL) {
+    sbuf_appendf(tmp, "%s.tmp%ld", term->cache_fname, (long)getpid());
+    const char* tmpname = sbuf_string(tmp);
+    f = fopen(tmpname, "w");
+    if (f != NULL) {
+      const bool ok = (fputs(sbuf_string(sb), f) >= 0);
+      if (fclose(f) == 0 && ok) {
+        if (rename(tmpname, term->cache_fname) != 0) remove(tmpname);
+      }
+      else {
+        remove(tmpname);
+      }
+    }
+    sbuf_free(tmp);
+  }
+  sbuf_free(sb);
+}
+
+ic_private void term_set_cache(term_t* term, const char* fname) {
+  mem_free(term->mem, term->cache_fname);
+  term->cache_fname = NULL;
+  if (fname == NULL) return;
+  term->cache_fname = mem_strdup(term->mem, fname);
+  if (term->cache_fname == NULL) return;
+  stringbuf_t* key = sbuf_new(term->mem);
+  if (key == NULL) return;
+  term_cache_key(key);
+  if (term_cache_load(term, sbuf_string(key))) {
+    term->probed = true;
+    term_probe_apply(term);
+  }
+  else {
+    term_probe(term);
+    if (term->probe_answered) {
+      term_cache_save(term, sbuf_string(key));
+    }
+  }
+  sbuf_free(key);
+}
+
+#else
+
+ic_private void term_set_cache(term_t* term, const char* fname) {
+  // we do not probe the console on Windows
+  ic_unused(term); ic_unused(fname);
+}
+
+#endif
@@ -32,6 +32,8 @@ ic_private void term_end_raw(term_t* term, bool force);
 
 ic_private bool term_enable_beep(term_t* term, bool enable);
 ic_private bool term_enable_color(term_t* term, bool enable);
+ic_private bool term_enable_kitty_keys(term_t* term, bool enable);
+ic_private void term_set_cache(term_t* term, const char* fname);
 
 ic_private void term_flush(term_t* term);
 ic_private buffer_mode_t term_set_buffer_mode(term_t* term, buffer_mode_t mode);
@@ -77,8 +79,8 @@ ic_private void term_bgcolor(term_t* term, ic_color_t color);
 
 ic_private attr_t term_get_attr( const term_t* term );
 ic_private void   term_set_attr( term_t* term, attr_t attr );
-ic_private void   term_write_formatted( term_t* term, const char* s, const attr_t* attrs );
-ic_private void   term_write_formatted_n( term_t* term, const char* s, const attr_t* attrs, ssize_t n );
+ic_private void   term_write_formatted( term_t* term, const char* s, attrbuf_t* attrs );
+ic_private void   term_write_formatted_n( term_t* term, const char* s, attrbuf_t* attrs, ssize_t start, ssize_t n );  // writes `s[start,start+n)`
 
 ic_private ic_color_t color_from_ansi256(ssize_t i);
 
@@ -11,14 +11,18 @@
 // Standard ANSI palette for 256 colors
 //-------------------------------------------------------------
 
-static uint32_t ansi256[256] = {   
-  // not const as on some platforms (e.g. Windows, xterm) we update the first 16 entries with the actual used colors.
-  // 0, standard ANSI
-  0x000000, 0x800000, 0x008000, 0x808000, 0x000080, 0x800080, 
-  0x008080, 0xc0c0c0,
-  // 8, bright ANSI
-  0x808080, 0xff0000, 0x00ff00, 0xffff00, 0x0000ff, 0xff00ff, 
-  0x00ffff, 0xffffff,
+#define ANSI16_DEFAULT_COLORS \
+  /* 0, standard ANSI */ \
+  0x000000, 0x800000, 0x008000, 0x808000, 0x000080, 0x800080, \
+  0x008080, 0xc0c0c0, \
+  /* 8, bright ANSI */ \
+  0x808080, 0xff0000, 0x00ff00, 0xffff00, 0x0000ff, 0xff00ff, \
+  0x00ffff, 0xffffff
+
+static const uint32_t ansi256[256] = {   
+  // the first 16 entries are the defaults; on some platforms (e.g. Windows, xterm) 
+  // we use the actual colors instead (see `rgb_palette16_update`).
+  ANSI16_DEFAULT_COLORS,
   // 6x6x6 RGB colors
   // 16
   0x000000, 0x00005f, 0x000087, 0x0000af, 0x0000d7, 0x0000ff,
@@ -170,47 +174,66 @@ static int_least32_t rgb_distance_rbmean( uint32_t color, int r2, int g2, int b2
 }
 
 
-// Maintain a small cache of recently used colors. Should be short enough to be effectively constant time.
-// If we ever use a more expensive color distance method, we may increase the size a bit (64?) 
-// (Initial zero initialized cache is valid.)
-#define RGB_CACHE_LEN (16)
-typedef struct rgb_cache_s {
-  int        last;
-  int        indices[RGB_CACHE_LEN];
-  ic_color_t colors[RGB_CACHE_LEN];
-} rgb_cache_t;
-
-// remember a color in the LRU cache
-void rgb_remember( rgb_cache_t* cache, ic_color_t color, int idx ) {
-  if (cache == NULL) return;
-  cache->colors[cache->last] = color;
-  cache->indices[cache->last] = idx;
-  cache->last++;
-  if (cache->last >= RGB_CACHE_LEN) { cache->last = 0; }
+// Palette matches are memoized in a quantized grid over the RGB cube that
+// uses the top 5 bits of each component (32x32x32 cells). A cell is computed
+// on first use: if all its corners match the same palette entry, the cell holds
+// `index - start + 1` and any color in it maps to that entry in constant time.
+// Otherwise the cell straddles a boundary and is marked as mixed; colors in
+// such cells are matched exactly and kept in a small direct mapped cache.
+#define RGB_GRID_BITS   (5)
+#define RGB_GRID_SHIFT  (8 - RGB_GRID_BITS)
+#define RGB_GRID_LEN    (1 << (3*RGB_GRID_BITS))
+#define RGB_GRID_MIXED  (255)
+#define RGB_GRID_CACHE_LEN  (1024)
+
+// The grids are shared between threads without locks: every cell and cache entry
+// is a single word that is self-contained and only accessed with relaxed atomics.
+// Racing threads compute the same cell value, and a torn cache entry cannot occur.
+typedef struct rgb_grid_s {
+  uint8_t  volatile cells[RGB_GRID_LEN];
+  uint32_t volatile cache[RGB_GRID_CACHE_LEN];  // exact matches of colors in mixed cells
+} rgb_grid_t;
+
+static rgb_grid_t ansi256_grid;   // for the fixed entries 16 to 255
+
+// The first 16 entries can be updated with the actual colors of the terminal (when it
+// is initialized, or probed on the first readline). A palette is never changed in place:
+// an update publishes a new palette with its own empty grids through a single pointer 
+// swap, so a thread that converts colors at the same time uses either the old palette and 
+// its grids, or the new ones. A replaced palette is never freed as other threads may still 
+// use it; there are only a few updates per process.
+typedef struct rgb_palette16_s {
+  uint32_t   colors[16];
+  rgb_grid_t ansi16_grid;
+  rgb_grid_t ansi8_grid;
+} rgb_palette16_t;
+
+static rgb_palette16_t rgb_palette16_default = { { ANSI16_DEFAULT_COLORS } };
+static void* volatile  rgb_palette16 = &rgb_palette16_default;
+
+static rgb_palette16_t* rgb_palette16_get(void) {
+  return (rgb_palette16_t*)ic_atomic_load_ptr(&rgb_palette16);
 }
 
-// quick lookup in cache; -1 on failure
-int rgb_lookup( const rgb_cache_t* cache, ic_color_t color ) {
-  if (cache != NULL) {
-    for(int i = 0; i < RGB_CACHE_LEN; i++) {
-      if (cache->colors[i] == color) return cache->indices[i];
-    }
+// publish a palette where the entries with a bit set in `valid` are replaced by `colors`
+static void rgb_palette16_update(alloc_t* mem, const uint32_t* colors, uint32_t valid) {
+  const rgb_palette16_t* cur = rgb_palette16_get();
+  bool changed = false;
+  for (ssize_t i = 0; i < 16; i++) {
+    if ((valid & (1U << i)) != 0 && colors[i] != cur->colors[i]) { changed = true; }
+  }
+  if (!changed) return;
+  rgb_palette16_t* pal = mem_zalloc_tp(mem, rgb_palette16_t);
+  if (pal == NULL) return;
+  for (ssize_t i = 0; i < 16; i++) {
+    pal->colors[i] = ((valid & (1U << i)) != 0 ? colors[i] : cur->colors[i]);
   }
-  return -1;
+  ic_atomic_exchange_ptr(&rgb_palette16, pal);
 }
 
 // return the index of the closest matching color
-static int rgb_match( uint32_t* palette, int start, int len, rgb_cache_t* cache, ic_color_t color ) {
-  assert(color_is_rgb(color));
-  // in cache?
-  int min = rgb_lookup(cache,color);
-  if (min >= 0) {
-    return min;
-  }
-  // otherwise find closest color match in the palette
-  int r, g, b;
-  color_to_rgb(color,&r,&g,&b);
-  min = start;
+static int rgb_nearest( const uint32_t* palette, int start, int len, int r, int g, int b ) {
+  int min = start;
   int_least32_t mindist = (INT_LEAST32_MAX)/4;
   for(int i = start; i < len; i++) {
     //int_least32_t dist = rgb_distance_rbmean(palette[i],r,g,b);
@@ -229,15 +252,52 @@ static int rgb_match( uint32_t* palette, int start, int len, rgb_cache_t* cache,
       mindist = dist;
     }
   }
-  rgb_remember(cache,color,min);
   return min;
 }
 
+// return the index of the closest matching color through the grid
+static int rgb_match( const uint32_t* palette, int start, int len, rgb_grid_t* grid, ic_color_t color ) {
+  assert(color_is_rgb(color));
+  assert(len - start < RGB_GRID_MIXED);
+  int r, g, b;
+  color_to_rgb(color,&r,&g,&b);
+  const int cell = ((r >> RGB_GRID_SHIFT) << (2*RGB_GRID_BITS)) | ((g >> RGB_GRID_SHIFT) << RGB_GRID_BITS) | (b >> RGB_GRID_SHIFT);
+  int idx = ic_atomic_load_relaxed_u8(&grid->cells[cell]);
+  if (idx == 0) {
+    // match the corners of the cell
+    const int r0 = (r >> RGB_GRID_SHIFT) << RGB_GRID_SHIFT;
+    const int g0 = (g >> RGB_GRID_SHIFT) << RGB_GRID_SHIFT;
+    const int b0 = (b >> RGB_GRID_SHIFT) << RGB_GRID_SHIFT;
+    const int d  = (1 << RGB_GRID_SHIFT) - 1;
+    const int min = rgb_nearest(palette, start, len, r0, g0, b0);
+    idx = min - start + 1;
+    for(int corner = 1; corner < 8; corner++) {
+      if (rgb_nearest(palette, start, len, r0 + ((corner&4) ? d : 0), g0 + ((corner&2) ? d : 0), b0 + ((corner&1) ? d : 0)) != min) {
+        idx = RGB_GRID_MIXED;
+        break;
+      }
+    }
+    ic_atomic_store_relaxed_u8(&grid->cells[cell], (uint8_t)idx);
+  }
+  if (idx == RGB_GRID_MIXED) {
+    // direct mapped cache of `rgb << 8 | (index - start + 1)` entries
+    const uint32_t rgb = (color & 0xFFFFFF);
+    const uint32_t slot = ((rgb * 2654435761U) >> 16) % RGB_GRID_CACHE_LEN;
+    const uint32_t entry = ic_atomic_load_relaxed_u32(&grid->cache[slot]);
+    if (entry != 0 && (entry >> 8) == rgb) {
+      return (start + (int)(entry & 0xFF) - 1);
+    }
+    const int min = rgb_nearest(palette, start, len, r, g, b);
+    ic_atomic_store_relaxed_u32(&grid->cache[slot], (rgb << 8) | (uint32_t)(min - start + 1));
+    return min;
+  }
+  return (start + idx - 1);
+}
+
 
 // Match RGB to an index in the ANSI 256 color table
 static int rgb_to_ansi256(ic_color_t color) {
-  static rgb_cache_t ansi256_cache;
-  int c = rgb_match(ansi256, 16, 256, &ansi256_cache, color); // not the first 16 ANSI colors as those may be different 
+  int c = rgb_match(ansi256, 16, 256, &ansi256_grid, color); // not the first 16 ANSI colors as those may be different 
   //debug_msg("term: rgb %x -> ansi 256: %d\n", color, c );
   return c;
 }
@@ -248,8 +308,8 @@ static int color_to_ansi16(ic_color_t color) {
     return (int)color;
   }
   else {
-    static rgb_cache_t ansi16_cache;
-    int c = rgb_match(ansi256, 0, 16, &ansi16_cache, color);
+    rgb_palette16_t* pal = rgb_palette16_get();
+    int c = rgb_match(pal->colors, 0, 16, &pal->ansi16_grid, color);
     //debug_msg("term: rgb %x -> ansi 16: %d\n", color, c );
     return (c < 8 ? 30 + c : 90 + c - 8); 
   }
@@ -263,8 +323,8 @@ static int color_to_ansi8(ic_color_t color) {
   }
   else {
     // match to basic 8 colors first
-    static rgb_cache_t ansi8_cache;
-    int c = 30 + rgb_match(ansi256, 0, 8, &ansi8_cache, color);
+    rgb_palette16_t* pal = rgb_palette16_get();
+    int c = 30 + rgb_match(pal->colors, 0, 8, &pal->ansi8_grid, color);
     // and then adjust for brightness
     int r, g, b;
     color_to_rgb(color,&r,&g,&b);
@@ -349,12 +409,14 @@ ic_private void term_bgcolor(term_t* term, ic_color_t color) {
 
 ic_private void term_append_color(term_t* term, stringbuf_t* sbuf, ic_color_t color) {
   char buf[128+1];
+  buf[0] = 0;
   fmt_color_ex(buf,128,term->palette,color,false);
   sbuf_append(sbuf,buf);
 }
 
 ic_private void term_append_bgcolor(term_t* term, stringbuf_t* sbuf, ic_color_t color) {
   char buf[128+1];
+  buf[0] = 0;
   fmt_color_ex(buf, 128, term->palette, color, true);
   sbuf_append(sbuf, buf);
 }
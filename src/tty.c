@@ -26,14 +26,14 @@ WINBASEAPI ULONGLONG WINAPI GetTickCount64(VOID);
 #include <errno.h>
 #include <unistd.h>
 #include <termios.h>
-#include <sys/ioctl.h>
-#include <sys/select.h>
-#if !defined(FIONREAD)
 #include <fcntl.h>
-#endif
+#include <poll.h>
+#include <sys/ioctl.h>
 #endif
 
-#define TTY_PUSH_MAX (32)
+#define TTY_PUSH_MAX  (32)
+#define TTY_INBUF_MAX (4096)
+#define TTY_RESIZE_DELAY (50)  // ms without further resizes before we post a resize event
 
 struct tty_s {
   int       fd_in;                  // input handle
@@ -48,12 +48,16 @@ struct tty_s {
   ssize_t   cpush_count;
   long      esc_initial_timeout;    // initial ms wait to see if ESC starts an escape sequence
   long      esc_timeout;            // follow up delay for characters in an escape sequence
+  bool      kitty_keys;             // is the kitty keyboard protocol active? (then a lone ESC key is never sent)
   #if defined(_WIN32)               
   HANDLE    hcon;                   // console input handle
   DWORD     hcon_orig_mode;         // original console mode
   #else
   struct termios  orig_ios;         // original terminal settings
   struct termios  raw_ios;          // raw terminal settings
+  ssize_t   in_pos;                 // next byte to return from `inbuf`
+  ssize_t   in_len;                 // number of bytes read into `inbuf`
+  uint8_t   inbuf[TTY_INBUF_MAX];   // input buffer: we read as many bytes as are available at once
   #endif
 };
 
@@ -154,11 +158,15 @@ ic_private bool tty_read_timeout(tty_t* tty, long timeout_ms, code_t* code)
 
   // read a single char/byte from a character stream
   uint8_t c;
-  if (!tty_readc_noblock(tty, &c, timeout_ms)) return false;
+  if (!tty_readc_noblock(tty, &c, timeout_ms)) {
+    // woken up by an asynchronous event?
+    return tty_code_pop(tty, code);
+  }
   
   if (c == KEY_ESC) {
     // escape sequence?
-    *code = tty_read_esc(tty, tty->esc_initial_timeout, tty->esc_timeout);
+    // with the kitty protocol the ESC key is sent as `ESC [ 27 u` and a lone ESC needs no initial wait
+    *code = tty_read_esc(tty, (tty->kitty_keys ? tty->esc_timeout : tty->esc_initial_timeout), tty->esc_timeout);
   }
   else if (c <= 0x7F) {
     // ascii
@@ -231,16 +239,11 @@ ic_private code_t tty_read(tty_t* tty)
 // Read back an ANSI query response
 //-------------------------------------------------------------
 
-ic_private bool tty_read_esc_response(tty_t* tty, char esc_start, bool final_st, char* buf, ssize_t buflen ) 
+// read the body of a response after the `ESC [` or `ESC ]`
+static bool tty_read_esc_body(tty_t* tty, bool final_st, char* buf, ssize_t buflen) 
 {
-  buf[0] = 0;
   ssize_t len = 0;
   uint8_t c = 0;
-  if (!tty_readc_noblock(tty, &c, 2*tty->esc_initial_timeout) || c != '\x1B') {
-    debug_msg("initial esc response failed: 0x%02x\n", c);
-    return false;
-  }
-  if (!tty_readc_noblock(tty, &c, tty->esc_timeout) || (c != esc_start)) return false;
   while( len < buflen ) {
     if (!tty_readc_noblock(tty, &c, tty->esc_timeout)) return false;
     if (final_st) {
@@ -259,7 +262,7 @@ ic_private bool tty_read_esc_response(tty_t* tty, char esc_start, bool final_st,
       if (c == '\x02') { // STX
         break;
       }
-      else if (!((c >= '0' && c <= '9') || strchr("<=>?;:",c) != NULL)) {
+      else if (!((c >= '0' && c <= '9') || strchr("<=>?;:$",c) != NULL)) {
         buf[len++] = (char)c; // for non-OSC save the terminating character
         break;
       }
@@ -271,6 +274,45 @@ ic_private bool tty_read_esc_response(tty_t* tty, char esc_start, bool final_st,
   return true;
 }
 
+ic_private bool tty_read_esc_response(tty_t* tty, char esc_start, bool final_st, char* buf, ssize_t buflen ) 
+{
+  buf[0] = 0;
+  uint8_t c = 0;
+  if (!tty_readc_noblock(tty, &c, 2*tty->esc_initial_timeout) || c != '\x1B') {
+    debug_msg("initial esc response failed: 0x%02x\n", c);
+    return false;
+  }
+  if (!tty_readc_noblock(tty, &c, tty->esc_timeout) || (c != esc_start)) return false;
+  return tty_read_esc_body(tty, final_st, buf, buflen);
+}
+
+// Read back the next CSI or OSC response; `*esc_start` is set to `[` or `]`.
+// Any other input before the response (like typed keys) is appended to `skipped`
+// so it can be restored afterwards with `tty_unread`.
+ic_private bool tty_read_esc_reply(tty_t* tty, char* esc_start, char* buf, ssize_t buflen, stringbuf_t* skipped) 
+{
+  buf[0] = 0;
+  *esc_start = 0;
+  uint8_t c = 0;
+  while (true) {
+    if (!tty_readc_noblock(tty, &c, 2*tty->esc_initial_timeout)) return false;
+    if (c != '\x1B') {
+      sbuf_append_char(skipped, (char)c);
+      continue;
+    }
+    if (!tty_readc_noblock(tty, &c, tty->esc_timeout)) {
+      sbuf_append_char(skipped, '\x1B');
+      return false;
+    }
+    if (c == '[' || c == ']') break;
+    sbuf_append_char(skipped, '\x1B');
+    if (c == '\x1B') { tty_cpush_char(tty, c); }  // may start the response
+                 else { sbuf_append_char(skipped, (char)c); }
+  }
+  *esc_start = (char)c;
+  return tty_read_esc_body(tty, (c == ']'), buf, buflen);
+}
+
 //-------------------------------------------------------------
 // High level code pushback
 //-------------------------------------------------------------
@@ -431,6 +473,14 @@ ic_private bool tty_term_resize_event(tty_t* tty) {
   return true;  // always return true on systems without a resize event (more expensive but still ok)
 }
 
+ic_private bool tty_is_raw(tty_t* tty) {
+  return (tty != NULL && tty->raw_enabled);
+}
+
+ic_private void tty_set_kitty_keys(tty_t* tty, bool active) {
+  tty->kitty_keys = active;
+}
+
 ic_private void tty_set_esc_delay(tty_t* tty, long initial_delay_ms, long followup_delay_ms) {
   tty->esc_initial_timeout = (initial_delay_ms < 0 ? 0 : (initial_delay_ms > 1000 ? 1000 : initial_delay_ms));
   tty->esc_timeout = (followup_delay_ms < 0 ? 0 : (followup_delay_ms > 1000 ? 1000 : followup_delay_ms));
@@ -441,105 +491,172 @@ ic_private void tty_set_esc_delay(tty_t* tty, long initial_delay_ms, long follow
 //-------------------------------------------------------------
 #if !defined(_WIN32)
 
+// A self-pipe to wake up a blocked read from another thread; we post the code of the
+// event (like `KEY_EVENT_STOP`) on the pipe. It is created once and stays open for the
+// lifetime of the process: other threads may post at any time (see `ic_print_async`),
+// even while the tty is freed, and must never write to a closed (and reused) descriptor.
+static int tty_wake_in  = -1;
+static int tty_wake_out = -1;
+
+// pop a byte from the input buffer
+static bool tty_inbuf_pop(tty_t* tty, uint8_t* c) {
+  if (tty->in_pos >= tty->in_len) return false;
+  *c = tty->inbuf[tty->in_pos++];
+  return true;
+}
+
+// read all available input (at least 1 byte; in raw mode `VMIN` is 1) into the input buffer
+static bool tty_inbuf_fill(tty_t* tty) {
+  assert(tty->in_pos >= tty->in_len);
+  tty->in_pos = tty->in_len = 0;
+  ssize_t nread = read(tty->fd_in, tty->inbuf, TTY_INBUF_MAX);
+  if (nread <= 0) return false;
+  tty->in_len = nread;
+  return true;
+}
+
+ic_private int tty_get_fd(const tty_t* tty) {
+  return tty->fd_in;
+}
+
+ic_private int tty_get_wake_fd(const tty_t* tty) {
+  ic_unused(tty);
+  return tty_wake_in;
+}
+
+// append input bytes read externally to the input buffer
+ic_private ssize_t tty_feed(tty_t* tty, const uint8_t* bytes, ssize_t len) {
+  if (tty->in_pos > 0) {
+    tty->in_len -= tty->in_pos;
+    memmove(tty->inbuf, tty->inbuf + tty->in_pos, to_size_t(tty->in_len));
+    tty->in_pos = 0;
+  }
+  ssize_t n = TTY_INBUF_MAX - tty->in_len;
+  if (n > len) { n = len; }
+  ic_memcpy(tty->inbuf + tty->in_len, bytes, n);
+  tty->in_len += n;
+  return n;
+}
+
+// put input back in front of the pushed back bytes and the input buffer
+ic_private void tty_unread(tty_t* tty, const char* s, ssize_t len) {
+  if (len <= 0) return;
+  uint8_t rest[TTY_INBUF_MAX];
+  ssize_t n = 0;
+  uint8_t c;
+  while (n < TTY_INBUF_MAX && tty_cpop(tty, &c)) { rest[n++] = c; }
+  ssize_t m = tty->in_len - tty->in_pos;
+  if (m > TTY_INBUF_MAX - n) { m = TTY_INBUF_MAX - n; }
+  ic_memcpy(rest + n, tty->inbuf + tty->in_pos, m);
+  n += m;
+  // if it does not all fit, the most recent input is dropped
+  if (len > TTY_INBUF_MAX) { len = TTY_INBUF_MAX; }
+  if (n > TTY_INBUF_MAX - len) { n = TTY_INBUF_MAX - len; }
+  ic_memcpy(tty->inbuf, s, len);
+  ic_memcpy(tty->inbuf + len, rest, n);
+  tty->in_pos = 0;
+  tty->in_len = len + n;
+}
+
+// take out input that was already read (or fed) but not yet processed
+ic_private ssize_t tty_take_input(tty_t* tty, uint8_t* buf, ssize_t buflen) {
+  ssize_t n = 0;
+  while (n < buflen && (tty_cpop(tty, &buf[n]) || tty_inbuf_pop(tty, &buf[n]))) { n++; }
+  return n;
+}
+
+// move events posted on the wakeup pipe to the code pushback buffer (in order).
+// We only read as many events as fit: the rest stays on the pipe for a later read, as a
+// dropped `KEY_EVENT_OUTPUT` would never be posted again (see `ic_print_async`).
+// A `KEY_EVENT_RESIZE` on the pipe only wakes up a poll (see `sig_handler`) and is skipped;
+// the resize itself is pushed once the size settles (see `tty_wait_resized`).
+// Returns `true` if there are codes in the pushback buffer.
+static bool tty_async_drain(tty_t* tty) {
+  code_t events[TTY_PUSH_MAX];
+  const ssize_t avail = TTY_PUSH_MAX - tty->push_count;
+  ssize_t count = 0;
+  ssize_t nread;
+  while (count < avail &&
+         (nread = read(tty_wake_in, events + count, to_size_t(avail - count) * sizeof(code_t))) > 0) {
+    // writes of a single code are atomic so we never read partial codes
+    count += nread / ssizeof(code_t);
+  }
+  // push in reverse so the first posted event is popped first
+  for (ssize_t i = count - 1; i >= 0; i--) {
+    if (events[i] != KEY_EVENT_RESIZE) { tty_code_pushback(tty, events[i]); }
+  }
+  return (tty->push_count > 0);
+}
+
+// After a terminal resize, wait until no further resizes happen for `TTY_RESIZE_DELAY` ms. 
+// Dragging a window edge generates a burst of SIGWINCH signals and we only want to
+// process the final size. Returns `true` if the size settled (and a resize event is posted),
+// or `false` if there is input first.
+static bool tty_wait_resized(tty_t* tty, struct pollfd* fds, nfds_t nfds) {
+  int res;
+  do {
+    res = poll(fds, nfds, TTY_RESIZE_DELAY);
+  } while (res < 0 && errno == EINTR);  // restart the delay on each further resize
+  if (res != 0) return false;
+  tty_code_pushback(tty, KEY_EVENT_RESIZE);
+  return true;
+}
+
+// wait at most `timeout_ms` (or forever if negative) for input on `fd_in`. 
+// Returns `false` on a timeout, or if woken up by an asynchronous event 
+// (which is then in the code pushback buffer).
+static bool tty_wait(tty_t* tty, long timeout_ms) {
+  struct pollfd fds[2];
+  fds[0].fd = tty->fd_in;   fds[0].events = POLLIN; fds[0].revents = 0;
+  fds[1].fd = tty_wake_in;  fds[1].events = POLLIN; fds[1].revents = 0;
+  const nfds_t nfds = (tty_wake_in >= 0 ? 2 : 1);
+  while (true) {
+    if (timeout_ms < 0 && tty->term_resize_event && tty_wait_resized(tty, fds, nfds)) return false;
+    const int res = poll(fds, nfds, (timeout_ms < 0 ? -1 : (int)timeout_ms));
+    if (res < 0 && errno == EINTR && timeout_ms < 0) continue;  // can happen on SIGWINCH signal for terminal resize
+    if (res <= 0) return false;
+    const bool has_input = ((fds[0].revents & (POLLIN | POLLHUP | POLLERR)) != 0);
+    if (nfds > 1 && (fds[1].revents & POLLIN) != 0) {
+      if (tty_async_drain(tty)) return false;
+      if (!has_input && timeout_ms < 0) continue;  // only woken up by a resize
+    }
+    return has_input;
+  }
+}
+
 static bool tty_readc_blocking(tty_t* tty, uint8_t* c) {
   if (tty_cpop(tty,c)) return true;
-  *c = 0;
-  ssize_t nread = read(tty->fd_in, (char*)c, 1);
-  if (nread < 0 && errno == EINTR) {
-    // can happen on SIGWINCH signal for terminal resize
-  }
-  return (nread == 1);
+  if (tty_inbuf_pop(tty,c)) return true;
+  return (tty_wait(tty, -1) && tty_inbuf_fill(tty) && tty_inbuf_pop(tty,c));
 }
 
 
 // non blocking read -- with a small timeout used for reading escape sequences.
 ic_private bool tty_readc_noblock(tty_t* tty, uint8_t* c, long timeout_ms) 
 {
-  // in our pushback buffer?
+  // in our pushback buffer, or already read?
   if (tty_cpop(tty, c)) return true;
+  if (tty_inbuf_pop(tty, c)) return true;
 
   // blocking read?
   if (timeout_ms < 0) {
     return tty_readc_blocking(tty,c);
   }
 
-  // if supported, peek first if any char is available.
-  #if defined(FIONREAD)
-  { int navail = 0;
-    if (ioctl(0, FIONREAD, &navail) == 0) {
-      if (navail >= 1) {
-        return tty_readc_blocking(tty, c);
-      }
-      else if (timeout_ms == 0) {
-        return false;  // return early if there is no input available (with a zero timeout)
-      }
-    }
-  }
-  #endif
+  // otherwise wait for at most timeout milliseconds
+  return (tty_wait(tty, timeout_ms) && tty_inbuf_fill(tty) && tty_inbuf_pop(tty, c));
+}
 
-  // otherwise block for at most timeout milliseconds
-  #if defined(FD_SET)   
-    // we can use select to detect when input becomes available
-    fd_set readset;
-    struct timeval time;
-    FD_ZERO(&readset);
-    FD_SET(tty->fd_in, &readset);
-    time.tv_sec  = (timeout_ms > 0 ? timeout_ms / 1000 : 0);
-    time.tv_usec = (timeout_ms > 0 ? 1000*(timeout_ms % 1000) : 0);      
-    if (select(tty->fd_in + 1, &readset, NULL, NULL, &time) == 1) {
-      // input available
-      return tty_readc_blocking(tty, c);
-    }    
-  #else
-    // no select, we cannot timeout; use usleeps :-(
-    // todo: this seems very rare nowadays; should be even support this?
-    do {
-      // peek ahead if possible
-      #if defined(FIONREAD)
-      int navail = 0;
-      if (ioctl(0, FIONREAD, &navail) == 0 && navail >= 1) {
-        return tty_readc_blocking(tty, c);
-      }
-      #elif defined(O_NONBLOCK)
-      // use a temporary non-blocking read mode
-      int fstatus = fcntl(tty->fd_in, F_GETFL, 0);
-      if (fstatus != -1) {
-        if (fcntl(tty->fd_in, F_SETFL, (fstatus | O_NONBLOCK)) != -1) {
-          char buf[2] = { 0, 0 };
-          ssize_t nread = read(tty->fd_in, buf, 1);
-          fcntl(tty->fd_in, F_SETFL, fstatus);
-          if (nread >= 1) {
-            *c = (uint8_t)buf[0];
-            return true;
-          }
-        }
-      }
-      #else
-      #error "define an nonblocking read for this platform"
-      #endif
-      // and sleep a bit
-      if (timeout_ms > 0) {
-        usleep(50*1000L); // sleep at most 0.05s at a time
-        timeout_ms -= 100;
-        if (timeout_ms < 0) { timeout_ms = 0; }
-      }      
-    } 
-    while (timeout_ms > 0);
-  #endif  
-  return false;
-}
-
-#if defined(TIOCSTI) 
-ic_private bool tty_async_stop(const tty_t* tty) {
-  // insert ^C in the input stream
-  char c = KEY_CTRL_C;
-  return (ioctl(tty->fd_in, TIOCSTI, &c) >= 0);
+// post an event code on the wakeup pipe (can be called from any thread)
+ic_private bool tty_async_post(const tty_t* tty, code_t event) {
+  ic_unused(tty);
+  if (tty_wake_out < 0) return false;
+  return (write(tty_wake_out, &event, sizeof(event)) == (ssize_t)sizeof(event));
 }
-#else
+
 ic_private bool tty_async_stop(const tty_t* tty) {
-  return false;
+  return tty_async_post(tty, KEY_EVENT_STOP);
 }
-#endif
 
 // We install various signal handlers to restore the terminal settings
 // in case of a terminating signal. This is also used to catch terminal window resizes.
@@ -583,6 +700,10 @@ static void sig_handler(int signum, siginfo_t* siginfo, void* uap ) {
   if (signum == SIGWINCH) {
     if (sig_tty != NULL) {
       sig_tty->term_resize_event = true;
+      // wake up an application that polls the wakeup descriptor (`write` is signal-safe)
+      const int err = errno;
+      tty_async_post(sig_tty, KEY_EVENT_RESIZE);
+      errno = err;
     }
   }
   else {
@@ -658,6 +779,7 @@ ic_private void tty_end_raw(tty_t* tty) {
   if (tty == NULL) return;
   if (!tty->raw_enabled) return;
   tty->cpush_count = 0;
+  tty->in_pos = tty->in_len = 0;  // discard buffered input (like TCSAFLUSH)
   if (tcsetattr(tty->fd_in,TCSAFLUSH,&tty->orig_ios) < 0) return;
   tty->raw_enabled = false;
 }
@@ -677,6 +799,22 @@ static bool tty_init_raw(tty_t* tty)
   tty->raw_ios.c_cc[VTIME] = 0;
   tty->raw_ios.c_cc[VMIN] = 1;
 
+  // create the (non-blocking) self-pipe to wake up a blocked read once,
+  // or discard events that were posted to a previous tty
+  int fds[2];
+  if (tty_wake_in >= 0) {
+    code_t events[TTY_PUSH_MAX];
+    while (read(tty_wake_in, events, sizeof(events)) > 0) { }
+  }
+  else if (pipe(fds) == 0) {
+    for (int i = 0; i < 2; i++) {
+      fcntl(fds[i], F_SETFL, fcntl(fds[i], F_GETFL, 0) | O_NONBLOCK);
+      fcntl(fds[i], F_SETFD, FD_CLOEXEC);
+    }
+    tty_wake_in  = fds[0];
+    tty_wake_out = fds[1];
+  }
+
   // store in global so our signal handlers can restore the terminal mode
   signals_install(tty);
   
@@ -686,6 +824,7 @@ static bool tty_init_raw(tty_t* tty)
 static void tty_done_raw(tty_t* tty) {
   ic_unused(tty);
   signals_restore();
+  // the wakeup pipe stays open (see `tty_wake_in`)
 }
 
 
@@ -699,6 +838,42 @@ static void tty_done_raw(tty_t* tty) {
 
 static void tty_waitc_console(tty_t* tty, long timeout_ms);
 
+#define TTY_ASYNC_EVENT_TAG  (0x80000000U)  // tags menu events posted by `tty_async_post`
+
+ic_private int tty_get_fd(const tty_t* tty) {
+  ic_unused(tty);
+  return -1;  // we read console events instead
+}
+
+ic_private int tty_get_wake_fd(const tty_t* tty) {
+  ic_unused(tty);
+  return -1;  // events are posted as console events
+}
+
+// push input bytes read externally (in the low-level pushback buffer)
+ic_private ssize_t tty_feed(tty_t* tty, const uint8_t* bytes, ssize_t len) {
+  ssize_t n = TTY_PUSH_MAX - tty->cpush_count;
+  if (n > len) { n = len; }
+  memmove(tty->cpushbuf + n, tty->cpushbuf, to_size_t(tty->cpush_count));
+  for (ssize_t i = 0; i < n; i++) {
+    tty->cpushbuf[n - i - 1] = bytes[i];
+  }
+  tty->cpush_count += n;
+  return n;
+}
+
+// put input back in front of the pushed back bytes
+ic_private void tty_unread(tty_t* tty, const char* s, ssize_t len) {
+  tty_feed(tty, (const uint8_t*)s, len);
+}
+
+// take out input that was already read (or fed) but not yet processed
+ic_private ssize_t tty_take_input(tty_t* tty, uint8_t* buf, ssize_t buflen) {
+  ssize_t n = 0;
+  while (n < buflen && tty_cpop(tty, &buf[n])) { n++; }
+  return n;
+}
+
 ic_private bool tty_readc_noblock(tty_t* tty, uint8_t* c, long timeout_ms) {  // don't modify `c` if there is no input
   // in our pushback buffer?
   if (tty_cpop(tty, c)) return true;
@@ -748,6 +923,15 @@ static void tty_waitc_console(tty_t* tty, long timeout_ms)
       }
     }
 
+    // a resize is pending: post a resize event once the size settles (see `TTY_RESIZE_DELAY`)
+    if (timeout_ms < 0 && tty->term_resize_event && WaitForSingleObject(tty->hcon, TTY_RESIZE_DELAY) == WAIT_TIMEOUT) {
+      tty_code_pushback(tty, KEY_EVENT_RESIZE);
+      return;
+    }
+
+    // leave further (asynchronous) events in the console input until the pushback buffer has room
+    if (tty->push_count >= TTY_PUSH_MAX) return;
+
     // (blocking) Read from the input
     if (!ReadConsoleInputW(tty->hcon, &inp, 1, &count)) return;
     if (count != 1) return;
@@ -758,6 +942,12 @@ static void tty_waitc_console(tty_t* tty, long timeout_ms)
       continue;
     }
 
+    // asynchronous event posted by `tty_async_post`?
+    if (inp.EventType == MENU_EVENT && (inp.Event.MenuEvent.dwCommandId & TTY_ASYNC_EVENT_TAG) != 0) {
+      tty_code_pushback(tty, (code_t)(inp.Event.MenuEvent.dwCommandId & ~TTY_ASYNC_EVENT_TAG));
+      return;
+    }
+
     // wait for key down events 
     if (inp.EventType != KEY_EVENT) continue;
 
@@ -841,18 +1031,19 @@ static void tty_waitc_console(tty_t* tty, long timeout_ms)
   }
 }  
 
-ic_private bool tty_async_stop(const tty_t* tty) {
-  // send ^c
-  INPUT_RECORD events[2];
-  memset(events, 0, 2*sizeof(INPUT_RECORD));
-  events[0].EventType = KEY_EVENT;
-  events[0].Event.KeyEvent.bKeyDown = TRUE;
-  events[0].Event.KeyEvent.uChar.AsciiChar = KEY_CTRL_C;
-  events[1] = events[0];
-  events[1].Event.KeyEvent.bKeyDown = FALSE;
+// post an event code as a (tagged) menu event in the console input (can be called from any thread)
+ic_private bool tty_async_post(const tty_t* tty, code_t event) {
+  INPUT_RECORD inp;
+  memset(&inp, 0, sizeof(inp));
+  inp.EventType = MENU_EVENT;
+  inp.Event.MenuEvent.dwCommandId = (UINT)(event | TTY_ASYNC_EVENT_TAG);
   DWORD nwritten = 0;
-  WriteConsoleInput(tty->hcon, events, 2, &nwritten);
-  return (nwritten == 2);
+  WriteConsoleInput(tty->hcon, &inp, 1, &nwritten);
+  return (nwritten == 1);
+}
+
+ic_private bool tty_async_stop(const tty_t* tty) {
+  return tty_async_post(tty, KEY_EVENT_STOP);
 }
 
 ic_private bool tty_start_raw(tty_t* tty) {
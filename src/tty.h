@@ -9,6 +9,7 @@
 #define IC_TTY_H
 
 #include "common.h"
+#include "stringbuf.h"
 
 //-------------------------------------------------------------
 // TTY/Keyboard input 
@@ -28,6 +29,7 @@ ic_private void   tty_free(tty_t* tty);
 ic_private bool   tty_is_utf8(const tty_t* tty);
 ic_private bool   tty_start_raw(tty_t* tty);
 ic_private void   tty_end_raw(tty_t* tty);
+ic_private bool   tty_is_raw(tty_t* tty);
 ic_private code_t tty_read(tty_t* tty);
 ic_private bool   tty_read_timeout(tty_t* tty, long timeout_ms, code_t* c );
 
@@ -36,18 +38,27 @@ ic_private bool   code_is_ascii_char(code_t c, char* chr );
 ic_private bool   code_is_unicode(code_t c, unicode_t* uchr);
 ic_private bool   code_is_virt_key(code_t c );
 
+ic_private int    tty_get_fd(const tty_t* tty);      // the input file descriptor (or -1)
+ic_private int    tty_get_wake_fd(const tty_t* tty); // the descriptor that is readable on asynchronous events (or -1)
+ic_private ssize_t tty_feed(tty_t* tty, const uint8_t* bytes, ssize_t len); // add external input; returns the number of bytes accepted
+ic_private ssize_t tty_take_input(tty_t* tty, uint8_t* buf, ssize_t buflen); // take out buffered input that is not yet processed
 ic_private bool   tty_term_resize_event(tty_t* tty); // did the terminal resize?
 ic_private bool   tty_async_stop(const tty_t* tty);  // unblock the read asynchronously
+ic_private bool   tty_async_post(const tty_t* tty, code_t event); // wake up the read with an event code (from any thread)
 ic_private void   tty_set_esc_delay(tty_t* tty, long initial_delay_ms, long followup_delay_ms);
+ic_private void   tty_set_kitty_keys(tty_t* tty, bool active);
 
 // shared between tty.c and tty_esc.c: low level character push
 ic_private void   tty_cpush_char(tty_t* tty, uint8_t c);
 ic_private bool   tty_cpop(tty_t* tty, uint8_t* c);
 ic_private bool   tty_readc_noblock(tty_t* tty, uint8_t* c, long timeout_ms);
 ic_private code_t tty_read_esc(tty_t* tty, long esc_initial_timeout, long esc_timeout); // in tty_esc.c
+ic_private ssize_t tty_esc_decode(const uint8_t* s, ssize_t len, bool at_end, code_t* code); // pure decoder (in tty_esc.c)
 
 // used by term.c to read back ANSI escape responses
 ic_private bool   tty_read_esc_response(tty_t* tty, char esc_start, bool final_st, char* buf, ssize_t buflen ); 
+ic_private bool   tty_read_esc_reply(tty_t* tty, char* esc_start, char* buf, ssize_t buflen, stringbuf_t* skipped); // other input is appended to `skipped`
+ic_private void   tty_unread(tty_t* tty, const char* s, ssize_t len);  // put input back in front of any buffered input
 
 
 //-------------------------------------------------------------
@@ -142,6 +153,7 @@ static inline code_t key_unicode( unicode_t u ) {
 #define KEY_EVENT_RESIZE  (KEY_EVENT_BASE+1)
 #define KEY_EVENT_AUTOTAB (KEY_EVENT_BASE+2)
 #define KEY_EVENT_STOP    (KEY_EVENT_BASE+3)
+#define KEY_EVENT_OUTPUT  (KEY_EVENT_BASE+4)   // asynchronous output is pending
 
 // Convenience
 #define KEY_CTRL_UP       (WITH_CTRL(KEY_UP))
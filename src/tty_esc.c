@@ -43,7 +43,12 @@ We then accept the following key sequences:
        |  ESC '[' special? vtcode  ';' modifiers '~'       # vt100 codes
        |  ESC '[' special? '1'     ';' modifiers [A-Z]     # xterm codes
        |  ESC 'O' special? '1'     ';' modifiers [A-Za-z]  # SS3 codes
-       |  ESC '[' special? unicode ';' modifiers 'u'       # direct unicode code
+       |  ESC '[' special? unicode ';' modifiers 'u'       # direct unicode code (and kitty)
+       |  ESC '[' '27' ';' modifiers ';' unicode '~'       # xterm modifyOtherKeys
+
+Parameters can have sub-parameters separated by ':' (as used by the kitty keyboard 
+protocol); these are ignored except for the kitty event type of the modifiers 
+(where key release events (3) are ignored).
 
 Moreover, we translate the following special cases that do not fit into the above grammar.
 First we translate away special starter sequences:
@@ -119,158 +124,159 @@ SS3:   ESC 'O' 1 ';' modifiers [A-Za-z]
 -------------------------------------------------------------*/
 
 //-------------------------------------------------------------
-// Decode escape sequences
+// Key tables
 //-------------------------------------------------------------
 
-static code_t esc_decode_vt(uint32_t vt_code ) {
-  switch(vt_code) {
-    case 1: return KEY_HOME; 
-    case 2: return KEY_INS;
-    case 3: return KEY_DEL;
-    case 4: return KEY_END;          
-    case 5: return KEY_PAGEUP;
-    case 6: return KEY_PAGEDOWN;
-    case 7: return KEY_HOME;
-    case 8: return KEY_END;          
-    default: 
-      if (vt_code >= 10 && vt_code <= 15) return KEY_F(1  + (vt_code - 10));
-      if (vt_code == 16) return KEY_F5; // minicom
-      if (vt_code >= 17 && vt_code <= 21) return KEY_F(6  + (vt_code - 17));
-      if (vt_code >= 23 && vt_code <= 26) return KEY_F(11 + (vt_code - 23));
-      if (vt_code >= 28 && vt_code <= 29) return KEY_F(15 + (vt_code - 28));
-      if (vt_code >= 31 && vt_code <= 34) return KEY_F(17 + (vt_code - 31));
+// ESC [ vtcode ~   (indexed by the vtcode)
+static const code_t esc_vt_keys[35] = {
+  KEY_NONE, KEY_HOME, KEY_INS, KEY_DEL, KEY_END, KEY_PAGEUP, KEY_PAGEDOWN, KEY_HOME, KEY_END, KEY_NONE,      //  0-9
+  KEY_F(1), KEY_F(2), KEY_F(3), KEY_F(4), KEY_F(5), KEY_F(6), KEY_F(5) /* minicom */, KEY_F(6), KEY_F(7),    // 10-18
+  KEY_F(8), KEY_F(9), KEY_F(10), KEY_NONE, KEY_F(11), KEY_F(12), KEY_F(13), KEY_F(14), KEY_NONE,            // 19-27
+  KEY_F(15), KEY_F(16), KEY_NONE, KEY_F(17), KEY_F(18), KEY_F(19), KEY_F(20)                                // 28-34
+};
+
+// ESC [ 1 ; mods [A-Z]   (indexed by final - 'A')
+static const code_t esc_xterm_keys[26] = {
+  KEY_UP, KEY_DOWN, KEY_RIGHT, KEY_LEFT, '5' /* numpad 5 */, KEY_END, KEY_NONE, KEY_HOME,                   // A-H
+  KEY_PAGEUP /* FreeBSD */, KEY_NONE, KEY_NONE, KEY_INS, KEY_F1, KEY_F2, KEY_F3, KEY_F4, KEY_F5, KEY_F6,     // I-R 
+  KEY_F7, KEY_F8, KEY_PAGEDOWN /* Mach */, KEY_PAGEUP /* Mach */, KEY_F11, KEY_F12, KEY_END /* Mach */,     // S-Y
+  KEY_TAB | KEY_MOD_SHIFT                                                                                   // Z 
+};
+
+// ESC O 1 ; mods [A-Z]   (indexed by final - 'A')
+static const code_t esc_ss3_keys[26] = {
+  KEY_UP, KEY_DOWN, KEY_RIGHT, KEY_LEFT, '5' /* numpad 5 */, KEY_END, KEY_NONE, KEY_HOME, KEY_TAB,         // A-I
+  KEY_NONE, KEY_NONE, KEY_NONE, KEY_LINEFEED, KEY_NONE, KEY_NONE, KEY_F1, KEY_F2, KEY_F3, KEY_F4,          // J-S
+  KEY_F5, KEY_F6, KEY_F7, KEY_F8, KEY_F9, KEY_F10 /* Mach */,                                              // T-Y 
+  KEY_TAB | KEY_MOD_SHIFT                                                                                  // Z
+};
+
+// ESC O 1 ; mods [a-z]   (numpad, indexed by final - 'a')
+static const code_t esc_ss3_numpad_keys[26] = {
+  KEY_UP, KEY_DOWN, KEY_RIGHT, KEY_LEFT, KEY_NONE, KEY_NONE, KEY_NONE, KEY_NONE, KEY_NONE,                 // a-i
+  '*', '+', ',', '-', KEY_DEL /* '.' */, '/', KEY_INS, KEY_END, KEY_DOWN, KEY_PAGEDOWN, KEY_LEFT, '5',     // j-u
+  KEY_RIGHT, KEY_HOME, KEY_UP, KEY_PAGEUP, KEY_NONE                                                        // v-z
+};
+
+// ESC [ code ; mods u  with a functional key code of the kitty keyboard protocol
+// (indexed by code - 57399, the numpad keys).
+// See <https://sw.kovidgoyal.net/kitty/keyboard-protocol/#functional-key-definitions>
+#define ESC_KITTY_KP_FIRST  (57399)
+static const code_t esc_kitty_kp_keys[29] = {
+  '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', '.', '/', '*', '-', '+', KEY_ENTER, '=', ',',
+  KEY_LEFT, KEY_RIGHT, KEY_UP, KEY_DOWN, KEY_PAGEUP, KEY_PAGEDOWN, KEY_HOME, KEY_END, KEY_INS, KEY_DEL, '5'
+};
+
+static code_t esc_decode_kitty(uint32_t kcode) {
+  if (kcode >= ESC_KITTY_KP_FIRST && kcode < ESC_KITTY_KP_FIRST + 29) {
+    return esc_kitty_kp_keys[kcode - ESC_KITTY_KP_FIRST];
   }
-  return KEY_NONE;
-}
-
-static code_t esc_decode_xterm( uint8_t xcode ) {
-  // ESC [
-  switch(xcode) {
-    case 'A': return KEY_UP;
-    case 'B': return KEY_DOWN;
-    case 'C': return KEY_RIGHT;
-    case 'D': return KEY_LEFT;
-    case 'E': return '5';          // numpad 5
-    case 'F': return KEY_END;
-    case 'H': return KEY_HOME;
-    case 'Z': return KEY_TAB | KEY_MOD_SHIFT;
-    // Freebsd:
-    case 'I': return KEY_PAGEUP;  
-    case 'L': return KEY_INS;   
-    case 'M': return KEY_F1;
-    case 'N': return KEY_F2;
-    case 'O': return KEY_F3;
-    case 'P': return KEY_F4;       // note: differs from <https://en.wikipedia.org/wiki/ANSI_escape_code#CSI_(Control_Sequence_Introducer)_sequences>
-    case 'Q': return KEY_F5;
-    case 'R': return KEY_F6;
-    case 'S': return KEY_F7;
-    case 'T': return KEY_F8;
-    case 'U': return KEY_PAGEDOWN; // Mach
-    case 'V': return KEY_PAGEUP;   // Mach
-    case 'W': return KEY_F11;
-    case 'X': return KEY_F12;    
-    case 'Y': return KEY_END;      // Mach       
+  if (kcode >= 57376 && kcode <= 57383) {  // F13 - F20
+    return KEY_F(13 + (kcode - 57376));
   }
-  return KEY_NONE;
+  return KEY_NONE;  // other private use codes are modifier or media keys that we ignore
 }
 
-static code_t esc_decode_ss3( uint8_t ss3_code ) {
-  // ESC O 
-  switch(ss3_code) {
-    case 'A': return KEY_UP;
-    case 'B': return KEY_DOWN;
-    case 'C': return KEY_RIGHT;
-    case 'D': return KEY_LEFT;
-    case 'E': return '5';           // numpad 5
-    case 'F': return KEY_END;
-    case 'H': return KEY_HOME;
-    case 'I': return KEY_TAB;
-    case 'Z': return KEY_TAB | KEY_MOD_SHIFT;
-    case 'M': return KEY_LINEFEED; 
-    case 'P': return KEY_F1;
-    case 'Q': return KEY_F2;
-    case 'R': return KEY_F3;
-    case 'S': return KEY_F4;
-    // on Mach
-    case 'T': return KEY_F5;
-    case 'U': return KEY_F6;
-    case 'V': return KEY_F7;
-    case 'W': return KEY_F8;
-    case 'X': return KEY_F9;  // '=' on vt220
-    case 'Y': return KEY_F10;
-    // numpad
-    case 'a': return KEY_UP;
-    case 'b': return KEY_DOWN;
-    case 'c': return KEY_RIGHT;
-    case 'd': return KEY_LEFT;
-    case 'j': return '*';
-    case 'k': return '+';
-    case 'l': return ',';
-    case 'm': return '-'; 
-    case 'n': return KEY_DEL; // '.'
-    case 'o': return '/'; 
-    case 'p': return KEY_INS;
-    case 'q': return KEY_END;  
-    case 'r': return KEY_DOWN; 
-    case 's': return KEY_PAGEDOWN; 
-    case 't': return KEY_LEFT; 
-    case 'u': return '5';
-    case 'v': return KEY_RIGHT;
-    case 'w': return KEY_HOME;  
-    case 'x': return KEY_UP; 
-    case 'y': return KEY_PAGEUP;   
-  }
-  return KEY_NONE;
+
+//-------------------------------------------------------------
+// Decode escape sequences
+// 
+// This is a pure function over a byte buffer `s` that starts 
+// with ESC: it returns the number of bytes used for the key
+// `code`, or 0 if more bytes are needed. If `at_end` is true,
+// no more bytes will follow (because of a timeout) and a key
+// is always returned.
+//-------------------------------------------------------------
+
+static bool esc_is_digit(uint8_t c) {
+  return (c >= '0' && c <= '9');
 }
 
-static void tty_read_csi_num(tty_t* tty, uint8_t* ppeek, uint32_t* num, long esc_timeout) {
-  *num = 1; // default
+// read a number (saturating); returns the number of digits
+static ssize_t esc_decode_num(const uint8_t* s, ssize_t len, ssize_t i, uint32_t* num) {
   ssize_t count = 0;
-  uint32_t i = 0;
-  while (*ppeek >= '0' && *ppeek <= '9' && count < 16) {    
-    uint8_t digit = *ppeek - '0';
-    if (!tty_readc_noblock(tty,ppeek,esc_timeout)) break;  // peek is not modified in this case 
+  uint32_t n = 0;
+  while (i + count < len && esc_is_digit(s[i + count])) {
+    if (n < 0x00FFFFFFU) { n = 10*n + (uint32_t)(s[i + count] - '0'); }
     count++;
-    i = 10*i + digit; 
   }
-  if (count > 0) *num = i;
+  if (count > 0) { *num = n; }
+  return count;
 }
 
-static code_t tty_read_csi(tty_t* tty, uint8_t c1, uint8_t peek, code_t mods0, long esc_timeout) {
-  // CSI starts with 0x9b (c1=='[') | ESC [ (c1=='[') | ESC [Oo?] (c1 == 'O')  /* = SS3 */
-  
+// kitty and modifyOtherKeys report ctrl+<letter> as the letter with a ctrl modifier;
+// translate it to the legacy C0 control code (without ctrl) that the editor binds to.
+static code_t esc_ctrl_letter(code_t key, code_t* modifiers) {
+  if ((*modifiers & KEY_MOD_CTRL) == 0) return key;
+  if (key >= 'a' && key <= 'z') { key = key - 'a' + 1; }
+  else if (key >= 'A' && key <= 'Z') { key = key - 'A' + 1; }
+  else return key;
+  *modifiers &= ~KEY_MOD_CTRL;
+  return key;
+}
+
+// ESC [ ..  or  ESC O .. at position `i` (just after the starter `c1`)
+static ssize_t esc_decode_csi(const uint8_t* s, ssize_t len, ssize_t i, uint8_t c1, code_t mods, bool at_end, code_t* code) 
+{
   // check for extra starter '[' (Linux sends ESC [ [ 15 ~  for F5 for example)
-  if (c1 == '[' && strchr("[Oo", (char)peek) != NULL) {
-    uint8_t cx = peek;
-    if (tty_readc_noblock(tty,&peek,esc_timeout)) {
-      c1 = cx;
-    }
+  if (c1 == '[' && (s[i] == '[' || s[i] == 'O' || s[i] == 'o')) {
+    if (i + 1 < len) { c1 = s[i]; i++; }
+    else if (!at_end) return 0;
   }
 
   // "special" characters ('?' is used for private sequences)
   uint8_t special = 0;
-  if (strchr(":<=>?",(char)peek) != NULL) { 
-    special = peek;
-    if (!tty_readc_noblock(tty,&peek,esc_timeout)) {  
-      tty_cpush_char(tty,special); // recover
-      return (key_unicode(c1) | KEY_MOD_ALT);       // Alt+<anychar>
+  if (s[i] != 0 && strchr(":<=>?", (char)s[i]) != NULL) {
+    if (i + 1 >= len) {
+      if (!at_end) return 0;
+      *code = (key_unicode(c1) | KEY_MOD_ALT);  // Alt+<anychar> (and the special character is pushed back)
+      return i;
     }
+    special = s[i];
+    i++;
   }
 
-  // up to 2 parameters that default to 1
-  uint32_t num1 = 1;
-  uint32_t num2 = 1;
-  tty_read_csi_num(tty,&peek,&num1,esc_timeout);
-  if (peek == ';') {
-    if (!tty_readc_noblock(tty,&peek,esc_timeout)) return KEY_NONE;
-    tty_read_csi_num(tty,&peek,&num2,esc_timeout);
+  // up to 3 parameters that default to 1; each parameter can have sub-parameters separated by ':'
+  // (kitty uses ESC [ code ; mods:event u, and xterm modifyOtherKeys ESC [ 27 ; mods ; code ~)
+  uint32_t nums[3] = { 1, 1, 1 };
+  uint32_t event = 1;  // kitty event type: 1 = press, 2 = repeat, 3 = release
+  ssize_t  param = 0;
+  while (true) {
+    uint32_t num = 1;
+    i += esc_decode_num(s, len, i, &num);
+    if (param < 3) { nums[param] = num; }
+    ssize_t sub = 0;
+    while (i < len && s[i] == ':') {
+      i++;
+      uint32_t subnum = 1;
+      i += esc_decode_num(s, len, i, &subnum);
+      if (param == 1 && sub == 0) { event = subnum; }
+      sub++;
+    }
+    if (i >= len) {
+      if (!at_end) return 0;
+      *code = KEY_NONE;   // incomplete sequence: ignore
+      return len;
+    }
+    if (s[i] != ';') break;
+    param++;
+    i++;
   }
 
-  // the final character (we do not allow 'intermediate characters')
-  uint8_t final = peek;
-  code_t  modifiers = mods0;
-
-  debug_msg("tty: escape sequence: ESC %c %c %d;%d %c\n", c1, (special == 0 ? '_' : special), num1, num2, final);
+  // the final character (we only allow 'intermediate characters' in private responses, like `$` in DECRQM)
+  if (special == '?') {
+    while (i < len && s[i] >= 0x20 && s[i] <= 0x2F) { i++; }
+    if (i >= len) {
+      if (!at_end) return 0;
+      *code = KEY_NONE;
+      return len;
+    }
+  }
+  uint8_t  final = s[i++];
+  uint32_t num1  = nums[0];
+  uint32_t num2  = nums[1];
+  code_t   modifiers = mods;
+  debug_msg("tty: escape sequence: ESC %c %c %d;%d;%d %c\n", c1, (special == 0 ? '_' : special), num1, num2, nums[2], final);
   
   // Adjust special cases into standard ones.
   if ((final == '@' || final == '9') && c1 == '[' && num1 == 1) {
@@ -289,7 +295,7 @@ static code_t tty_read_csi(tty_t* tty, uint8_t c1, uint8_t peek, code_t mods0, l
   else if (c1 == '[' && final >= 'a' && final <= 'd') {  // note: do not catch ESC [ .. u  (for unicode)
     // ESC [ [a-d]  : on Eterm for shift+ cursor
     modifiers |= KEY_MOD_SHIFT;
-    final = 'A' + (final - 'a');
+    final = (uint8_t)('A' + (final - 'a'));
   }
   
   if (((c1 == 'O') || (c1=='[' && final != '~' && final != 'u')) &&
@@ -300,8 +306,8 @@ static code_t tty_read_csi(tty_t* tty, uint8_t c1, uint8_t peek, code_t mods0, l
     num1 = 1;
   }
 
-  // parameter 2 determines the modifiers
-  if (num2 > 1 && num2 <= 9) {
+  // parameter 2 determines the modifiers (kitty also uses higher bits for super, caps-lock etc. which we ignore)
+  if (num2 > 1 && num2 <= 256) {
     if (num2 == 9) num2 = 3; // iTerm2 in xterm mode
     num2--;
     if (num2 & 0x1) modifiers |= KEY_MOD_SHIFT;
@@ -310,92 +316,139 @@ static code_t tty_read_csi(tty_t* tty, uint8_t c1, uint8_t peek, code_t mods0, l
   }
 
   // and translate
-  code_t code = KEY_NONE;
-  if (final == '~') {
+  code_t key = KEY_NONE;
+  if (event == 3) {
+    // kitty key release
+    key = KEY_NONE;
+  }
+  else if (special == '?') {
+    // a (late) private query response, like DA1 or the kitty keyboard flags
+    key = KEY_NONE;
+  }
+  else if (final == '~' && num1 == 27 && param >= 2) {
+    // xterm modifyOtherKeys
+    key = esc_ctrl_letter(key_unicode(nums[2]), &modifiers);
+  }
+  else if (final == '~') {
     // vt codes
-    code = esc_decode_vt(num1);
+    if (num1 < 35) { key = esc_vt_keys[num1]; }
   }
   else if (c1 == '[' && final == 'u') {
-    // unicode
-    code = key_unicode(num1);
+    // unicode (or a kitty functional key)
+    key = (num1 <= KEY_UNICODE_MAX && !(num1 >= 0xE000 && num1 <= 0xF8FF) ? esc_ctrl_letter(key_unicode(num1), &modifiers) : esc_decode_kitty(num1));
   }
-  else if (c1 == 'O' && ((final >= 'A' && final <= 'Z') || (final >= 'a' && final <= 'z'))) {
+  else if (c1 == 'O' && final >= 'A' && final <= 'Z') {
     // ss3
-    code = esc_decode_ss3(final);
+    key = esc_ss3_keys[final - 'A'];
+  }
+  else if (c1 == 'O' && final >= 'a' && final <= 'z') {
+    // ss3 numpad
+    key = esc_ss3_numpad_keys[final - 'a'];
   }
   else if (num1 == 1 && final >= 'A' && final <= 'Z') {
     // xterm 
-    code = esc_decode_xterm(final);
+    key = esc_xterm_keys[final - 'A'];
   }
-  else if (c1 == '[' && final == 'R') {
-    // cursor position
-    code = KEY_NONE;
-  }  
-
-  if (code == KEY_NONE && final != 'R') { 
-    debug_msg("tty: ignore escape sequence: ESC %c %zu;%zu %c\n", c1, num1, num2, final); 
+  
+  if (key == KEY_NONE && final != 'R' /* cursor position */ && event != 3 && special != '?') { 
+    debug_msg("tty: ignore escape sequence: ESC %c %u;%u %c\n", c1, num1, num2, final); 
   }
-  return (code != KEY_NONE ? (code | modifiers) : KEY_NONE);
+  *code = (key != KEY_NONE ? (key | modifiers) : KEY_NONE);
+  return i;
 }
 
-static code_t tty_read_osc( tty_t* tty, uint8_t* ppeek, long esc_timeout ) {
-  debug_msg("discard OSC response..\n");
-  // keep reading until termination: OSC is terminated by BELL, or ESC \ (ST)  (and STX)
-  while (true) {
-    uint8_t c = *ppeek;
-    if (c <= '\x07') {  // BELL and anything below (STX, ^C, ^D)
-      if (c != '\x07') { tty_cpush_char( tty, c ); }
-      break;
+// OSC: we may get a delayed query response; ensure it is ignored
+static ssize_t esc_decode_osc(const uint8_t* s, ssize_t len, ssize_t i, bool at_end, code_t* code) {
+  *code = KEY_NONE;
+  // OSC is terminated by BELL, or ESC \ (ST)  (and STX)
+  while (i < len) {
+    const uint8_t c = s[i];
+    if (c == '\x07') return i+1;
+    if (c < '\x07') return i;   // anything below BELL (STX, ^C, ^D) terminates and is not consumed
+    if (c == '\x1B') {
+      if (i + 1 >= len) break;
+      if (s[i+1] == '\\') return i+2;
+      // ignore the ESC
     }
-    else if (c=='\x1B') {
-      uint8_t c1;
-      if (!tty_readc_noblock(tty, &c1, esc_timeout)) break;
-      if (c1=='\\') break;
-      tty_cpush_char(tty,c1);
-    }
-    if (!tty_readc_noblock(tty, ppeek, esc_timeout)) break;
+    i++;
   }
-  return KEY_NONE;
+  return (at_end ? len : 0);
 }
 
-ic_private code_t tty_read_esc(tty_t* tty, long esc_initial_timeout, long esc_timeout) {
-  code_t  mods = 0;
-  uint8_t peek = 0;
+ic_private ssize_t tty_esc_decode(const uint8_t* s, ssize_t len, bool at_end, code_t* code) {
+  assert(len >= 1 && s[0] == KEY_ESC);
+  *code = KEY_NONE;
   
   // lone ESC?
-  if (!tty_readc_noblock(tty, &peek, esc_initial_timeout)) return KEY_ESC;
+  if (len < 2) {
+    if (!at_end) return 0;
+    *code = KEY_ESC;
+    return 1;
+  }
 
   // treat ESC ESC as Alt modifier (macOS sends ESC ESC [ [A-D] for alt-<cursor>)
-  if (peek == KEY_ESC) {
-    if (!tty_readc_noblock(tty, &peek, esc_timeout)) goto alt;
+  ssize_t i = 1;
+  code_t mods = 0;
+  if (s[i] == KEY_ESC) {
+    if (len < 3) {
+      if (!at_end) return 0;
+      *code = (key_unicode(KEY_ESC) | KEY_MOD_ALT);
+      return 2;
+    }
     mods |= KEY_MOD_ALT;
+    i++;
   }
 
-  // CSI ?
-  if (peek == '[') {
-    if (!tty_readc_noblock(tty, &peek, esc_timeout)) goto alt;
-    return tty_read_csi(tty, '[', peek, mods, esc_timeout);  // ESC [ ...
+  const uint8_t c = s[i];
+  if (c == '[' || c == 'O' || c == 'o' || c == '?' /*vt52*/ || c == ']') {
+    if (i + 1 >= len) {
+      if (!at_end) return 0;
+      *code = (key_unicode(c) | KEY_MOD_ALT);  // Alt+<char>
+      return i+1;
+    }
+    if (c == '[') {
+      return esc_decode_csi(s, len, i+1, '[', mods, at_end, code);  // ESC [ ...
+    }
+    else if (c == ']') {
+      return esc_decode_osc(s, len, i+1, at_end, code);             // ESC ] ...
+    }
+    else {
+      if (c == 'o') { mods |= KEY_MOD_CTRL; }  // ETerm uses this for ctrl+<cursor>
+      return esc_decode_csi(s, len, i+1, 'O', mods, at_end, code);  // ESC [Oo?] ...: treat all as standard SS3 'O'
+    }
   }
 
-  // SS3?
-  if (peek == 'O' || peek == 'o' || peek == '?' /*vt52*/) {
-    uint8_t c1 = peek;
-    if (!tty_readc_noblock(tty, &peek, esc_timeout)) goto alt;
-    if (c1 == 'o') { 
-      // ETerm uses this for ctrl+<cursor>
-      mods |= KEY_MOD_CTRL;
+  // Alt+<char>
+  *code = (key_unicode(c) | KEY_MOD_ALT);  // ESC <anychar>
+  return i+1;
+}
+
+
+//-------------------------------------------------------------
+// Read escape sequences
+//-------------------------------------------------------------
+
+#define TTY_ESC_MAX  (256)
+
+ic_private code_t tty_read_esc(tty_t* tty, long esc_initial_timeout, long esc_timeout) {
+  uint8_t buf[TTY_ESC_MAX];
+  buf[0] = KEY_ESC;
+  ssize_t len = 1;
+  code_t  code = KEY_NONE;
+  ssize_t used;
+  while ((used = tty_esc_decode(buf, len, false, &code)) == 0) {
+    // read the next byte; this does not wait if it was already read into the input buffer
+    if (len >= TTY_ESC_MAX || !tty_readc_noblock(tty, &buf[len], (len == 1 ? esc_initial_timeout : esc_timeout))) {
+      used = tty_esc_decode(buf, len, true, &code);
+      break;
     }
-    // treat all as standard SS3 'O'
-    return tty_read_csi(tty,'O',peek,mods, esc_timeout);  // ESC [Oo?] ...
+    len++;
   }
-
-  // OSC: we may get a delayed query response; ensure it is ignored
-  if (peek == ']') {
-    if (!tty_readc_noblock(tty, &peek, esc_timeout)) goto alt;
-    return tty_read_osc(tty, &peek, esc_timeout);  // ESC ] ...
+  assert(used > 0 && used <= len);
+  // push back unused bytes
+  while (len > used) {
+    len--;
+    tty_cpush_char(tty, buf[len]);
   }
-
-alt:  
-  // Alt+<char>
-  return (key_unicode(peek) | KEY_MOD_ALT);  // ESC <anychar>
+  return code;
 }
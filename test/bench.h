@@ -0,0 +1,47 @@
+/* ----------------------------------------------------------------------------
+  Copyright (c) 2021, Daan Leijen
+  This is free software; you can redistribute it and/or modify it
+  under the terms of the MIT License. A copy of the license can be
+  found in the "LICENSE" file at the root of this distribution.
+
+  Shared helpers for the benchmarks in this directory.
+  The benchmarks include the library sources directly (`src/isocline.c`)
+  to measure internal functions; include this header after those.
+-----------------------------------------------------------------------------*/
+#pragma once
+#ifndef IC_BENCH_H
+#define IC_BENCH_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#if defined(_WIN32)
+static double bench_now(void) {
+  LARGE_INTEGER freq, t;
+  QueryPerformanceFrequency(&freq);
+  QueryPerformanceCounter(&t);
+  return ((double)t.QuadPart / (double)freq.QuadPart);
+}
+#else
+#include <time.h>
+static double bench_now(void) {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return ((double)t.tv_sec + (double)t.tv_nsec * 1e-9);
+}
+#endif
+
+// optional positive argument `argv[i]` (like the size to scale a benchmark)
+static long bench_arg(int argc, char** argv, int i, long def) {
+  if (argc <= i) return def;
+  long n = strtol(argv[i], NULL, 10);
+  return (n > 0 ? n : def);
+}
+
+// deterministic pseudo random numbers
+static uint32_t bench_random(uint32_t* seed) {
+  *seed = (*seed)*1103515245U + 12345U;
+  return ((*seed) >> 8);
+}
+
+#endif // IC_BENCH_H
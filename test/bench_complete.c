@@ -0,0 +1,81 @@
+/* ----------------------------------------------------------------------------
+  Copyright (c) 2021, Daan Leijen
+  This is free software; you can redistribute it and/or modify it
+  under the terms of the MIT License. A copy of the license can be
+  found in the "LICENSE" file at the root of this distribution.
+
+  Benchmark of fuzzy scored completion: a completer that offers N generated
+  identifiers (1M by default) through `ic_add_completion_scored`, where only
+  the best scoring completions are retained.
+
+  Usage: bench_complete [count]
+-----------------------------------------------------------------------------*/
+#include "../src/isocline.c"   // first, as it sets feature macros
+#include "bench.h"
+
+static const char* parts[] = {
+  "get", "set", "file", "name", "path", "buffer", "read", "write", "open", "close",
+  "node", "tree", "list", "map", "count", "index", "value", "key", "line", "text"
+};
+#define PARTS_COUNT  (ssize_t)(sizeof(parts)/sizeof(parts[0]))
+
+static char**  candidates;
+static ssize_t candidate_count;
+
+// generate identifiers of 2 to 4 parts joined as snake_case or camelCase
+static void candidates_generate(ssize_t count) {
+  candidates = (char**)malloc((size_t)count * sizeof(char*));
+  if (candidates == NULL) exit(1);
+  uint32_t seed = 42;
+  for (ssize_t i = 0; i < count; i++) {
+    char buf[128];
+    ssize_t len = 0;
+    const bool camel = (bench_random(&seed) % 2 == 0);
+    const uint32_t n = 2 + bench_random(&seed) % 3;
+    for (uint32_t j = 0; j < n; j++) {
+      const char* part = parts[bench_random(&seed) % PARTS_COUNT];
+      if (j > 0 && !camel) { buf[len++] = '_'; }
+      for (ssize_t k = 0; part[k] != 0; k++) {
+        buf[len++] = (j > 0 && k == 0 && camel ? (char)(part[k] - 'a' + 'A') : part[k]);
+      }
+    }
+    snprintf(buf + len, 16, "%u", (unsigned)(i % 1000));
+    candidates[i] = strdup(buf);
+    if (candidates[i] == NULL) exit(1);
+  }
+  candidate_count = count;
+}
+
+static void word_completer(ic_completion_env_t* cenv, const char* word) {
+  for (ssize_t i = 0; i < candidate_count; i++) {
+    if (!ic_add_completion_scored(cenv, word, candidates[i], NULL, NULL)) return;
+  }
+}
+
+static void completer(ic_completion_env_t* cenv, const char* input) {
+  ic_complete_word(cenv, input, &word_completer, NULL);
+}
+
+int main(int argc, char** argv) {
+  const ssize_t count = bench_arg(argc, argv, 1, 1000000);
+  candidates_generate(count);
+  ic_env_t* env = ic_get_env();
+  if (env == NULL) return 1;
+  completions_set_completer(env->completions, &completer, NULL);
+
+  const char* inputs[] = { "gfn", "rdbuf", "setNodeKey", "x", NULL };
+  for (const char** input = inputs; *input != NULL; input++) {
+    const ssize_t len = ic_strlen(*input);
+    const double start = bench_now();
+    const ssize_t n = completions_generate(env, env->completions, *input, len, IC_MAX_COMPLETIONS_TO_SHOW);
+    completions_sort(env->completions);
+    const double secs = bench_now() - start;
+    printf("%-12s %8ld candidates: %5ld completions in %7.1f ms (%6.1f M/s), best: %s\n",
+             *input, (long)count, (long)n, 1000.0*secs, (double)count/secs/1e6,
+             (n > 0 ? completions_get_display(env->completions, 0, NULL) : "-"));
+  }
+
+  for (ssize_t i = 0; i < candidate_count; i++) { free(candidates[i]); }
+  free(candidates);
+  return 0;
+}
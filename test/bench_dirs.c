@@ -0,0 +1,110 @@
+/* ----------------------------------------------------------------------------
+  Copyright (c) 2021, Daan Leijen
+  This is free software; you can redistribute it and/or modify it
+  under the terms of the MIT License. A copy of the license can be
+  found in the "LICENSE" file at the root of this distribution.
+
+  Benchmark of filename completion in large directories: creates a temporary
+  directory with N entries (50k by default; files, executables, directories,
+  and symbolic links) spread over R root directories (1 by default), and times
+  completing in these without a cached listing, with and without LS_COLORS
+  coloring, and with a cached listing. With multiple roots the directories
+  are listed concurrently (unless built with IC_USE_THREADS=OFF).
+
+  Usage: bench_dirs [count] [roots]
+-----------------------------------------------------------------------------*/
+#include "../src/isocline.c"   // first, as it sets feature macros
+#include "bench.h"
+#include <sys/stat.h>
+
+static char    root[256];
+static ssize_t root_count = 1;
+static stringbuf_t* roots;     // the roots separated by `;`
+
+static void completer(ic_completion_env_t* cenv, const char* input) {
+  ic_complete_filename(cenv, input, '/', sbuf_string(roots), NULL);
+}
+
+// create the root directories with `count` entries in total
+static bool root_create(ssize_t count) {
+  const char* tmp = getenv("TMPDIR");
+  snprintf(root, sizeof(root), "%s/ic-bench-XXXXXX", (tmp != NULL && tmp[0] != 0 ? tmp : "/tmp"));
+  if (mkdtemp(root) == NULL) return false;
+  char path[512];
+  for (ssize_t r = 0; r < root_count; r++) {
+    snprintf(path, sizeof(path), "%s/root%ld", root, (long)r);
+    if (mkdir(path, 0755) != 0) return false;
+    if (r > 0) { sbuf_append_char(roots, ';'); }
+    sbuf_append(roots, path);
+  }
+  for (ssize_t i = 0; i < count; i++) {
+    snprintf(path, sizeof(path), "%s/root%ld/file%06ld", root, (long)(i % root_count), (long)i);
+    if (i % 100 == 1) {
+      if (mkdir(path, 0755) != 0) return false;
+    }
+    else if (i % 100 == 2) {
+      if (symlink("file000000", path) != 0) return false;
+    }
+    else {
+      FILE* f = fopen(path, "w");
+      if (f == NULL) return false;
+      fclose(f);
+      if (i % 100 == 3) { chmod(path, 0755); }
+    }
+  }
+  return true;
+}
+
+static void root_remove(ssize_t count) {
+  char path[512];
+  for (ssize_t i = 0; i < count; i++) {
+    snprintf(path, sizeof(path), "%s/root%ld/file%06ld", root, (long)(i % root_count), (long)i);
+    remove(path);
+  }
+  for (ssize_t r = 0; r < root_count; r++) {
+    snprintf(path, sizeof(path), "%s/root%ld", root, (long)r);
+    rmdir(path);
+  }
+  rmdir(root);
+}
+
+static void bench(ic_env_t* env, const char* title, bool cached) {
+  if (!cached) {
+    dircache_free(env->dircache);
+    env->dircache = NULL;
+  }
+  const double start = bench_now();
+  // a prefix that matches few entries so all roots are listed completely
+  const ssize_t n = completions_generate(env, env->completions, "file0000", 8, IC_MAX_COMPLETIONS_TO_SHOW);
+  const double secs = bench_now() - start;
+  printf("%-24s %7.2f ms (%ld completions)\n", title, 1000.0*secs, (long)n);
+}
+
+int main(int argc, char** argv) {
+  const ssize_t count = bench_arg(argc, argv, 1, 50000);
+  root_count = bench_arg(argc, argv, 2, 1);
+  ic_env_t* env = ic_get_env();
+  if (env == NULL) return 1;
+  roots = sbuf_new(env->mem);
+  if (roots == NULL) return 1;
+  if (!root_create(count)) {
+    printf("error: cannot create the directory %s\n", root);
+    root_remove(count);
+    return 1;
+  }
+  sleep(1);  // a listing is only cached if the directory was modified before the second it is listed in
+  completions_set_completer(env->completions, &completer, NULL);
+  printf("%ld entries in %ld directories: %s\n", (long)count, (long)root_count, root);
+
+  env->no_lscolors = true;
+  bench(env, "list", false);
+  bench(env, "list (cached)", true);
+  setenv("CLICOLOR", "1", 1);
+  env->no_lscolors = false;
+  bench(env, "list colored", false);
+  bench(env, "list colored (cached)", true);
+
+  root_remove(count);
+  sbuf_free(roots);
+  return 0;
+}
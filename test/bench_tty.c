@@ -0,0 +1,100 @@
+/* ----------------------------------------------------------------------------
+  Copyright (c) 2021, Daan Leijen
+  This is free software; you can redistribute it and/or modify it
+  under the terms of the MIT License. A copy of the license can be
+  found in the "LICENSE" file at the root of this distribution.
+
+  Benchmark of reading tty input: a child process pastes N bytes (64 KiB by
+  default) of text (with some escape sequences) into a pseudo terminal and
+  we read it back as keys. On Linux the number of `read` calls is taken from
+  `/proc/self/io` (`syscr`).
+
+  Usage: bench_tty [bytes]
+-----------------------------------------------------------------------------*/
+#include "../src/isocline.c"   // first, as it sets feature macros
+#include "bench.h"
+#include <fcntl.h>
+#include <sys/wait.h>
+
+// number of read calls of this process so far (or -1 if not available)
+static long read_calls(void) {
+  FILE* f = fopen("/proc/self/io", "r");
+  if (f == NULL) return -1;
+  long n = -1;
+  char line[128];
+  while (fgets(line, sizeof(line), f) != NULL) {
+    if (strncmp(line, "syscr:", 6) == 0) { n = strtol(line + 6, NULL, 10); }
+  }
+  fclose(f);
+  return n;
+}
+
+// text lines of 64 bytes (ending in a carriage return) with an up key on every 16th line
+static char* paste_create(ssize_t len, ssize_t* keys) {
+  char* s = (char*)malloc((size_t)len);
+  if (s == NULL) exit(1);
+  *keys = 0;
+  for (ssize_t i = 0; i < len; i++) {
+    if (i % 64 == 63) { s[i] = '\r'; }
+    else if (i % 1024 == 0 && i + 3 < len) { s[i++] = '\x1B'; s[i++] = '['; s[i] = 'A'; }
+    else { s[i] = (char)('a' + (i % 26)); }
+    (*keys)++;
+  }
+  return s;
+}
+
+static void paste_write(int fd, const char* s, ssize_t len) {
+  ssize_t ofs = 0;
+  while (ofs < len) {
+    ssize_t n = write(fd, s + ofs, (size_t)(len - ofs));
+    if (n <= 0) break;
+    ofs += n;
+  }
+}
+
+int main(int argc, char** argv) {
+  const ssize_t len = bench_arg(argc, argv, 1, 64*1024);
+  ssize_t keys = 0;
+  char* paste = paste_create(len, &keys);
+
+  // open a pseudo terminal
+  int master = posix_openpt(O_RDWR | O_NOCTTY);
+  if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+    printf("error: cannot open a pseudo terminal\n");
+    return 1;
+  }
+  int slave = open(ptsname(master), O_RDWR | O_NOCTTY);
+  if (slave < 0) return 1;
+  alloc_t mem = { &malloc, &realloc, &free };
+  tty_t* tty = tty_new(&mem, slave);
+  if (tty == NULL) return 1;
+  tty_start_raw(tty);
+
+  // paste from a child process
+  const double start = bench_now();
+  const long calls = read_calls();
+  pid_t pid = fork();
+  if (pid == 0) {
+    paste_write(master, paste, len);
+    _exit(0);
+  }
+  ssize_t count = 0;
+  ssize_t ups = 0;
+  code_t c;
+  while (count < keys && tty_read_timeout(tty, 1000, &c)) {
+    count++;
+    if (c == KEY_UP) { ups++; }
+  }
+  const double secs = bench_now() - start;
+  const long reads = (calls >= 0 ? read_calls() - calls - 1 : -1);  // minus the read of `/proc/self/io`
+  waitpid(pid, NULL, 0);
+
+  printf("pasted %ld bytes: %ld keys (%ld up) in %.2f ms", (long)len, (long)count, (long)ups, 1000.0*secs);
+  if (reads >= 0) { printf(", %ld read calls\n", reads); }
+             else { printf(", read calls not available\n"); }
+  tty_free(tty);
+  close(slave);
+  close(master);
+  free(paste);
+  return (count == keys ? 0 : 1);
+}
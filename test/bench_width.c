@@ -0,0 +1,114 @@
+/* ----------------------------------------------------------------------------
+  Copyright (c) 2021, Daan Leijen
+  This is free software; you can redistribute it and/or modify it
+  under the terms of the MIT License. A copy of the license can be
+  found in the "LICENSE" file at the root of this distribution.
+
+  Benchmark of measuring and writing text: the throughput of the column
+  width of N bytes (64 MiB by default) of 80-column text, of writing it to
+  the terminal, and of printing it as bbcode; and of the column width of
+  CJK text and of emoji text joined with ZWJs; and of moving the cursor over
+  the text one grapheme cluster at a time. The terminal output goes to
+  `/dev/null` (on Unix) and the results are printed to stderr.
+
+  Usage: bench_width [bytes]
+-----------------------------------------------------------------------------*/
+#include "../src/isocline.c"   // first, as it sets feature macros
+#include "bench.h"
+#if !defined(_WIN32)
+#include <fcntl.h>
+#endif
+
+// repeat `line` (which ends in a newline) to create a text of at most `len` bytes
+static char* text_create(const char* line, ssize_t len, ssize_t* textlen) {
+  const ssize_t n = ic_strlen(line);
+  char* s = (char*)malloc((size_t)len + 1);
+  if (s == NULL) exit(1);
+  ssize_t i = 0;
+  while (i + n <= len) {
+    ic_memcpy(s + i, line, n);
+    i += n;
+  }
+  s[i] = 0;
+  *textlen = i;
+  return s;
+}
+
+// create a text of at most `len` bytes with code points `first + (i*step) % count`,
+// and a zero width joiner after every `zwj`-th code point (if `zwj > 0`)
+static char* text_create_unicode(unicode_t first, uint32_t step, uint32_t count, uint32_t zwj, ssize_t len, ssize_t* textlen) {
+  char* s = (char*)malloc((size_t)len + 1);
+  if (s == NULL) exit(1);
+  ssize_t i = 0;
+  for (uint32_t k = 0; ; k++) {
+    const unicode_t u = (zwj > 0 && k % (zwj + 1) == zwj ? 0x200D : first + (k*step) % count);
+    uint8_t buf[5];
+    unicode_to_qutf8(u, buf);
+    const ssize_t n = ic_strlen((const char*)buf);
+    if (i + n > len) break;
+    ic_memcpy(s + i, buf, n);
+    i += n;
+  }
+  s[i] = 0;
+  *textlen = i;
+  return s;
+}
+
+static void report(const char* title, ssize_t bytes, double secs) {
+  fprintf(stderr, "%-28s %8.0f MB/s\n", title, (double)bytes/secs/1e6);
+}
+
+static void bench_column_width(const char* title, const char* s, ssize_t len) {
+  const double start = bench_now();
+  volatile ssize_t width = str_column_width_n(s, len);
+  ic_unused(width);
+  report(title, len, bench_now() - start);
+}
+
+// step over all grapheme clusters (as cursor movement does)
+static void bench_cursor(const char* title, const char* s, ssize_t len) {
+  const double start = bench_now();
+  ssize_t pos = 0;
+  ssize_t n;
+  while ((n = str_next_ofs(s, len, pos, NULL)) > 0) { pos += n; }
+  report(title, len, bench_now() - start);
+}
+
+int main(int argc, char** argv) {
+  const ssize_t len = bench_arg(argc, argv, 1, 64*1024*1024);
+  ic_env_t* env = ic_get_env();
+  if (env == NULL) return 1;
+  #if !defined(_WIN32)
+  int devnull = open("/dev/null", O_WRONLY);
+  if (devnull >= 0) { dup2(devnull, STDOUT_FILENO); close(devnull); }
+  #endif
+
+  // ascii
+  ssize_t n;
+  char* ascii = text_create("the quick brown fox jumps over the lazy dog; THE QUICK BROWN FOX JUMPS OVER THE\n", len, &n);
+  bench_column_width("column width (ascii)", ascii, n);
+  bench_cursor("cursor moves (ascii)", ascii, n);
+  double start = bench_now();
+  ic_term_write(ascii);
+  ic_term_flush();
+  report("term write (ascii)", n, bench_now() - start);
+  // bbcode printing in chunks of 1 MiB (as it is formatted in memory)
+  const ssize_t chunk = (n < 1024*1024 ? n : 1024*1024);
+  ascii[chunk] = 0;
+  start = bench_now();
+  for (ssize_t i = 0; i + chunk <= n; i += chunk) { ic_print(ascii); }
+  ic_term_flush();
+  report("bbcode print (ascii)", n - n%chunk, bench_now() - start);
+  free(ascii);
+
+  // wide characters, and joined emoji
+  char* cjk = text_create_unicode(0x4E00, 7919, 20000, 0, len, &n);
+  bench_column_width("column width (cjk)", cjk, n);
+  bench_cursor("cursor moves (cjk)", cjk, n);
+  free(cjk);
+  char* emoji = text_create_unicode(0x1F300, 31, 700, 4, len, &n);
+  bench_column_width("column width (emoji, zwj)", emoji, n);
+  bench_cursor("cursor moves (emoji, zwj)", emoji, n);
+  free(emoji);
+  return 0;
+}
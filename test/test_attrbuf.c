@@ -0,0 +1,160 @@
+/* ----------------------------------------------------------------------------
+  Copyright (c) 2021, Daan Leijen
+  This is free software; you can redistribute it and/or modify it
+  under the terms of the MIT License. A copy of the license can be
+  found in the "LICENSE" file at the root of this distribution.
+
+  Test of the attribute buffer: after random edits (including updates with
+  many spans at once), the run array of an `attrbuf_t` must describe the
+  same attributes as a flat array with one attribute per byte that is
+  edited the same way, and the runs must be sorted and maximal (adjacent
+  runs have different attributes).
+-----------------------------------------------------------------------------*/
+#include "../src/isocline.c"   // first, as it sets feature macros
+#include <stdio.h>
+
+#define MAX_LEN    (2048)
+#define MAX_SPANS  (32)
+
+// flat reference
+typedef struct flat_s {
+  ssize_t count;
+  attr_t  attrs[MAX_LEN];
+} flat_t;
+
+static void flat_set_at(flat_t* fl, ssize_t pos, ssize_t count, attr_t attr, bool update) {
+  if (pos < 0 || count <= 0) return;
+  for (ssize_t i = fl->count; i < pos + count; i++) { fl->attrs[i] = attr_none(); }
+  if (pos + count > fl->count) { fl->count = pos + count; }
+  for (ssize_t i = pos; i < pos + count; i++) {
+    fl->attrs[i] = (update ? attr_update_with(fl->attrs[i], attr) : attr);
+  }
+}
+
+static void flat_insert_at(flat_t* fl, ssize_t pos, ssize_t count, attr_t attr) {
+  if (pos < 0 || pos > fl->count || count <= 0) return;
+  memmove(fl->attrs + pos + count, fl->attrs + pos, to_size_t(fl->count - pos)*sizeof(attr_t));
+  for (ssize_t i = pos; i < pos + count; i++) { fl->attrs[i] = attr; }
+  fl->count += count;
+}
+
+static void flat_delete_at(flat_t* fl, ssize_t pos, ssize_t count) {
+  if (pos < 0 || pos > fl->count) return;
+  if (pos + count > fl->count) { count = fl->count - pos; }
+  if (count <= 0) return;
+  memmove(fl->attrs + pos, fl->attrs + pos + count, to_size_t(fl->count - pos - count)*sizeof(attr_t));
+  fl->count -= count;
+}
+
+// the remaining length of the run of equal attributes at `pos`
+static ssize_t flat_run_len(const flat_t* fl, ssize_t pos) {
+  ssize_t n = 1;
+  while (pos + n < fl->count && attr_is_eq(fl->attrs[pos + n], fl->attrs[pos])) { n++; }
+  return n;
+}
+
+// the runs are sorted, maximal, and describe the same attributes as the reference
+static bool attrbuf_equal(attrbuf_t* ab, const flat_t* fl) {
+  if (attrbuf_len(ab) != fl->count) return false;
+  if ((ab->rcount == 0) != (ab->count == 0)) return false;
+  for (ssize_t k = 0; k < ab->rcount; k++) {
+    if (k == 0 ? ab->runs[k].pos != 0 : ab->runs[k].pos <= ab->runs[k-1].pos) return false;
+    if (ab->runs[k].pos >= ab->count) return false;
+    if (k > 0 && attr_is_eq(ab->runs[k].attr, ab->runs[k-1].attr)) return false;
+  }
+  for (ssize_t pos = 0; pos < fl->count; pos++) {
+    ssize_t len = 0;
+    if (!attr_is_eq(attrbuf_run_at(ab, pos, &len), fl->attrs[pos])) return false;
+    if (len != flat_run_len(fl, pos)) return false;
+    if (!attr_is_eq(attrbuf_attr_at(ab, pos), fl->attrs[pos])) return false;
+  }
+  ssize_t len = -1;
+  return (attr_is_none(attrbuf_run_at(ab, fl->count, &len)) && len == 0);
+}
+
+static attr_t attrs[6];
+#define ATTRS_COUNT  (int)(sizeof(attrs)/sizeof(attrs[0]))
+
+static flat_t flat;
+
+int main(void) {
+  ic_env_t* env = ic_get_env();
+  if (env == NULL) return 1;
+  attrs[0] = attr_none();
+  attrs[1] = attr_from_color(IC_ANSI_RED);
+  attrs[2] = attr_from_color(IC_RGB(0x8080FF));
+  attrs[3] = attr_from_sgr("1", 1);
+  attrs[4] = attr_from_sgr("4;44", 4);
+  attrs[5] = attr_update_with(attrs[1], attrs[3]);
+  long checks = 0;
+  long failed = 0;
+  srand(11);
+  for (int t = 0; t < 200; t++) {
+    attrbuf_t* ab = attrbuf_new(env->mem);
+    stringbuf_t* sb = sbuf_new(env->mem);
+    if (ab == NULL || sb == NULL) return 1;
+    memset(&flat, 0, sizeof(flat));
+    const ssize_t maxlen = 1 + rand()%200;
+    for (int op = 0; op < 200; op++) {
+      // edit at a random position (sometimes just outside the buffer)
+      const ssize_t len   = flat.count;
+      const ssize_t pos   = rand() % (len + 4) - 2;
+      const ssize_t count = rand() % (rand()%4 == 0 ? maxlen : 8) - 1;
+      const attr_t  attr  = attrs[rand() % ATTRS_COUNT];
+      const int k = rand()%11;
+      const char* what;
+      if (pos + count + 1 >= MAX_LEN || len + count + 1 >= MAX_LEN) {
+        what = "clear";
+        attrbuf_clear(ab); sbuf_clear(sb); flat.count = 0;
+      }
+      else if (k < 2) {
+        what = "set";
+        attrbuf_set_at(ab, pos, count, attr); flat_set_at(&flat, pos, count, attr, false);
+      }
+      else if (k < 4) {
+        what = "update";
+        attrbuf_update_at(ab, pos, count, attr); flat_set_at(&flat, pos, count, attr, true);
+      }
+      else if (k < 6) {
+        what = "insert";
+        attrbuf_insert_at(ab, pos, count, attr); flat_insert_at(&flat, pos, count, attr);
+      }
+      else if (k < 8) {
+        what = "delete";
+        attrbuf_delete_at(ab, pos, count); flat_delete_at(&flat, pos, count);
+      }
+      else if (k < 9) {
+        what = "spans";
+        attr_span_t spans[MAX_SPANS];
+        ssize_t n = 0;
+        ssize_t end = (pos < 0 ? 0 : pos);
+        while (n < MAX_SPANS && rand()%8 != 0) {
+          spans[n].pos   = end + rand()%8;
+          spans[n].count = 1 + rand()%8;
+          spans[n].attr  = attrs[rand() % ATTRS_COUNT];
+          end = spans[n].pos + spans[n].count;
+          if (end >= MAX_LEN) break;
+          flat_set_at(&flat, spans[n].pos, spans[n].count, spans[n].attr, true);
+          n++;
+        }
+        attrbuf_update_spans(ab, spans, n);
+      }
+      else {
+        what = "append";
+        sbuf_clear(sb);
+        const ssize_t n = (count < 0 ? 0 : count % 16);
+        attrbuf_append_n(sb, ab, "abcdefghijklmnop", n, attr);
+        flat_set_at(&flat, len, n, attr, false);
+      }
+      checks++;
+      if (!attrbuf_equal(ab, &flat)) {
+        if (failed++ < 5) printf("attributes differ: test %d, edit %d (%s at %ld, count %ld)\n", t, op, what, (long)pos, (long)count);
+        attrbuf_clear(ab); flat.count = 0;
+      }
+    }
+    sbuf_free(sb);
+    attrbuf_free(ab);
+  }
+  printf("%ld attribute buffer checks, %ld failed\n", checks, failed);
+  return (failed == 0 ? 0 : 1);
+}
@@ -0,0 +1,66 @@
+/* ----------------------------------------------------------------------------
+  Copyright (c) 2021, Daan Leijen
+  This is free software; you can redistribute it and/or modify it
+  under the terms of the MIT License. A copy of the license can be
+  found in the "LICENSE" file at the root of this distribution.
+
+  Stress test that matches RGB colors to the ansi256, ansi16, and ansi8
+  palettes from many threads at once (sharing the memoized color grids),
+  while the main thread updates the first 16 palette entries, and checks
+  each match against an exact scan of the palette.
+  The library sources are included directly to test the internal functions.
+-----------------------------------------------------------------------------*/
+#include "../src/isocline.c"   // first, as it sets feature macros
+#include <stdio.h>
+#include <pthread.h>
+
+#define THREADS     (16)
+#define ITERATIONS  (100000)
+#define UPDATES     (50)
+
+static long failures[THREADS];
+static alloc_t mem = { &malloc, &realloc, &free };
+
+static void* worker(void* arg) {
+  const long id = (long)(intptr_t)arg;
+  uint32_t seed = (uint32_t)id + 1;
+  long fails = 0;
+  for (long i = 0; i < ITERATIONS; i++) {
+    seed = seed*1103515245U + 12345U;
+    uint32_t hex = (seed >> 4) & 0xFFFFFF;
+    if (i % 3 == 0) { hex &= 0xF0F0F0; }  // hit the same cells often
+    const int r = (int)((hex >> 16) & 0xFF);
+    const int g = (int)((hex >> 8) & 0xFF);
+    const int b = (int)(hex & 0xFF);
+    const ic_color_t color = ic_rgb(hex);
+    if (rgb_to_ansi256(color) != rgb_nearest(ansi256, 16, 256, r, g, b)) { fails++; }
+    rgb_palette16_t* pal = rgb_palette16_get();  // a palette and its grids belong together
+    if (rgb_match(pal->colors, 0, 16, &pal->ansi16_grid, color) != rgb_nearest(pal->colors, 0, 16, r, g, b)) { fails++; }
+    if (rgb_match(pal->colors, 0, 8, &pal->ansi8_grid, color) != rgb_nearest(pal->colors, 0, 8, r, g, b)) { fails++; }
+  }
+  failures[id] = fails;
+  return NULL;
+}
+
+int main(void) {
+  pthread_t threads[THREADS];
+  for (long i = 0; i < THREADS; i++) {
+    if (pthread_create(&threads[i], NULL, &worker, (void*)(intptr_t)i) != 0) {
+      printf("error: cannot create thread %ld\n", i);
+      return 1;
+    }
+  }
+  // meanwhile, alternate between the default palette and a rotated one
+  uint32_t rotated[16];
+  for (int i = 0; i < 16; i++) { rotated[i] = ansi256[(i + 5) % 16]; }
+  for (int i = 0; i < UPDATES; i++) {
+    rgb_palette16_update(&mem, (i % 2 == 0 ? rotated : ansi256), 0xFFFF);
+  }
+  long fails = 0;
+  for (long i = 0; i < THREADS; i++) {
+    pthread_join(threads[i], NULL);
+    fails += failures[i];
+  }
+  printf("%d threads, %ld colors each: %ld mismatches\n", THREADS, (long)ITERATIONS, fails);
+  return (fails == 0 ? 0 : 1);
+}
@@ -0,0 +1,132 @@
+/* ----------------------------------------------------------------------------
+  Copyright (c) 2021, Daan Leijen
+  This is free software; you can redistribute it and/or modify it
+  under the terms of the MIT License. A copy of the license can be
+  found in the "LICENSE" file at the root of this distribution.
+
+  Test of the escape sequence decoder (`tty_esc_decode`): CSI, SS3 and OSC
+  sequences with modifiers and kitty keys decode to the expected key and
+  length; every proper prefix of a sequence asks for more bytes; and
+  incomplete input at the end (after a timeout) still returns a key.
+-----------------------------------------------------------------------------*/
+#include "../src/isocline.c"   // first, as it sets feature macros
+#include <stdio.h>
+
+typedef struct esc_test_s {
+  const char* seq;
+  code_t      code;
+  ssize_t     len;       // bytes used (or -1 for the full sequence)
+} esc_test_t;
+
+// complete sequences: decode the same with and without `at_end`
+static const esc_test_t complete_tests[] = {
+  // lone ESC followed by a character
+  { "\x1B" "a",                     WITH_ALT('a'), -1 },
+  { "\x1B" "\x1B" "[A",             WITH_ALT(KEY_UP), -1 },
+  // CSI: xterm and vt codes
+  { "\x1B[A",                       KEY_UP, -1 },
+  { "\x1B[H",                       KEY_HOME, -1 },
+  { "\x1B[Z",                       WITH_SHIFT(KEY_TAB), -1 },
+  { "\x1B[3~",                      KEY_DEL, -1 },
+  { "\x1B[5~",                      KEY_PAGEUP, -1 },
+  { "\x1B[17~",                     KEY_F(6), -1 },
+  { "\x1B[24~",                     KEY_F12, -1 },
+  { "\x1B[[A",                      KEY_UP, -1 },
+  // CSI with modifiers
+  { "\x1B[1;2D",                    WITH_SHIFT(KEY_LEFT), -1 },
+  { "\x1B[1;3C",                    WITH_ALT(KEY_RIGHT), -1 },
+  { "\x1B[1;5A",                    KEY_CTRL_UP, -1 },
+  { "\x1B[1;8H",                    WITH_SHIFT(WITH_ALT(KEY_CTRL_HOME)), -1 },
+  { "\x1B[1;9B",                    WITH_ALT(KEY_DOWN), -1 },
+  { "\x1B[3;5~",                    KEY_CTRL_DEL, -1 },
+  { "\x1B[5A",                      KEY_CTRL_UP, -1 },
+  { "\x1B[3^",                      KEY_CTRL_DEL, -1 },
+  { "\x1B[a",                       WITH_SHIFT(KEY_UP), -1 },
+  // SS3
+  { "\x1BOA",                       KEY_UP, -1 },
+  { "\x1BOP",                       KEY_F1, -1 },
+  { "\x1BO1;5P",                    WITH_CTRL(KEY_F1), -1 },
+  { "\x1BO5D",                      KEY_CTRL_LEFT, -1 },
+  { "\x1BOj",                       '*', -1 },
+  { "\x1BoA",                       KEY_CTRL_UP, -1 },
+  // unicode, kitty and modifyOtherKeys
+  { "\x1B[97u",                     'a', -1 },
+  { "\x1B[97;3u",                   WITH_ALT('a'), -1 },
+  { "\x1B[97;5u",                   KEY_CTRL_A, -1 },
+  { "\x1B[97;7u",                   WITH_ALT(KEY_CTRL_A), -1 },
+  { "\x1B[97;1:2u",                 'a', -1 },
+  { "\x1B[97;1:3u",                 KEY_NONE, -1 },
+  { "\x1B[97:65;2u",                WITH_SHIFT('a'), -1 },
+  { "\x1B[13u",                     KEY_ENTER, -1 },
+  { "\x1B[57399u",                  '0', -1 },
+  { "\x1B[57417;5u",                KEY_CTRL_LEFT, -1 },
+  { "\x1B[57376u",                  KEY_F(13), -1 },
+  { "\x1B[57441u",                  KEY_NONE, -1 },
+  { "\x1B[27;5;97~",                KEY_CTRL_A, -1 },
+  { "\x1B[27;2;65~",                WITH_SHIFT('A'), -1 },
+  // responses that are ignored
+  { "\x1B[12;40R",                  KEY_NONE, -1 },
+  { "\x1B[?1u",                     KEY_NONE, -1 },
+  { "\x1B[?2026;2$y",               KEY_NONE, -1 },
+  // OSC
+  { "\x1B]11;rgb:0000/8080/ffff\x07", KEY_NONE, -1 },
+  { "\x1B]0;title\x1B\\",           KEY_NONE, -1 },
+  { "\x1B]0;tit\x1B" "le\x07",      KEY_NONE, -1 },
+  { "\x1B]0;title\x03",             KEY_NONE, 9 },
+};
+#define COMPLETE_COUNT  (int)(sizeof(complete_tests)/sizeof(complete_tests[0]))
+
+// incomplete sequences at the end of the input (after a timeout)
+static const esc_test_t at_end_tests[] = {
+  { "\x1B",                         KEY_ESC, 1 },
+  { "\x1B\x1B",                     WITH_ALT(KEY_ESC), 2 },
+  { "\x1B[",                        WITH_ALT('['), 2 },
+  { "\x1BO",                        WITH_ALT('O'), 2 },
+  { "\x1B]",                        WITH_ALT(']'), 2 },
+  { "\x1B[?",                       WITH_ALT('['), 2 },
+  { "\x1B[1;5",                     KEY_NONE, 5 },
+  { "\x1B[97;1:",                   KEY_NONE, 7 },
+  { "\x1B]0;title",                 KEY_NONE, 9 },
+};
+#define AT_END_COUNT  (int)(sizeof(at_end_tests)/sizeof(at_end_tests[0]))
+
+static long checks = 0;
+static long failed = 0;
+
+static void check_decode(const char* seq, ssize_t len, bool at_end, code_t code, ssize_t n) {
+  code_t c = 0xFFFFFFFFU;
+  const ssize_t m = tty_esc_decode((const uint8_t*)seq, len, at_end, &c);
+  checks++;
+  if (m != n || (n > 0 && c != code)) {
+    failed++;
+    printf("failed: ESC %.*s (length %ld%s): expecting 0x%x with length %ld, but got 0x%x with length %ld\n",
+           (int)(len - 1), seq + 1, (long)len, (at_end ? ", at end" : ""), code, (long)n, c, (long)m);
+  }
+}
+
+int main(void) {
+  char buf[64];  // longer than any test sequence
+  for (int t = 0; t < COMPLETE_COUNT; t++) {
+    const esc_test_t* test = &complete_tests[t];
+    const ssize_t len = ic_strlen(test->seq);
+    const ssize_t n = (test->len < 0 ? len : test->len);
+    check_decode(test->seq, len, false, test->code, n);
+    check_decode(test->seq, len, true, test->code, n);
+    // followed by other input
+    memcpy(buf, test->seq, to_size_t(len));
+    buf[len] = 'x';
+    check_decode(buf, len + 1, false, test->code, n);
+    // every proper prefix needs more bytes
+    for (ssize_t i = 1; i < n; i++) {
+      check_decode(test->seq, i, false, KEY_NONE, 0);
+    }
+  }
+  for (int t = 0; t < AT_END_COUNT; t++) {
+    const esc_test_t* test = &at_end_tests[t];
+    const ssize_t len = ic_strlen(test->seq);
+    check_decode(test->seq, len, false, KEY_NONE, 0);
+    check_decode(test->seq, len, true, test->code, test->len);
+  }
+  printf("%ld escape sequence checks, %ld failed\n", checks, failed);
+  return (failed == 0 ? 0 : 1);
+}
@@ -0,0 +1,96 @@
+/* ----------------------------------------------------------------------------
+  Copyright (c) 2021, Daan Leijen
+  This is free software; you can redistribute it and/or modify it
+  under the terms of the MIT License. A copy of the license can be
+  found in the "LICENSE" file at the root of this distribution.
+
+  Test of compiled formats: the output of `ic_format_print` must equal the
+  output of `ic_printf` with the same format and arguments (including the
+  escape sequences for the styles). The output is written to a temporary
+  file with color enabled.
+-----------------------------------------------------------------------------*/
+#include "../src/isocline.c"   // first, as it sets feature macros
+#include <stdio.h>
+
+static FILE* out;
+static long  checks = 0;
+static long  failed = 0;
+
+static off_t out_pos(void) {
+  return lseek(STDOUT_FILENO, 0, SEEK_CUR);
+}
+
+static char* out_read(off_t start, off_t end) {
+  const size_t len = (size_t)(end - start);
+  char* s = (char*)malloc(len + 1);
+  if (s == NULL) return NULL;
+  if (pread(fileno(out), s, len, start) != (ssize_t)len) { free(s); return NULL; }
+  s[len] = 0;
+  return s;
+}
+
+static void check_output(const char* fmt, off_t p0, off_t p1, off_t p2) {
+  char* expected = out_read(p0, p1);
+  char* actual   = out_read(p1, p2);
+  checks++;
+  if (expected == NULL || actual == NULL || p1 == p0 || strcmp(expected, actual) != 0) {
+    failed++;
+    fprintf(stderr, "failed: format \"%s\"\n  ic_printf:       \"%s\"\n  ic_format_print: \"%s\"\n",
+            fmt, (expected == NULL ? "" : expected), (actual == NULL ? "" : actual));
+  }
+  free(expected);
+  free(actual);
+}
+
+// print with `ic_printf` and with a compiled format, and compare
+#define check_format(fmt, ...) \
+  do { \
+    const off_t p0 = out_pos(); \
+    ic_printf(fmt, __VA_ARGS__); \
+    const off_t p1 = out_pos(); \
+    ic_format_t* f = ic_format_compile(fmt); \
+    ic_format_print(f, __VA_ARGS__); \
+    ic_format_free(f); \
+    check_output(fmt, p0, p1, out_pos()); \
+  } while(0)
+
+int main(void) {
+  out = tmpfile();
+  if (out == NULL) return 1;
+  fflush(stdout);
+  const int stdout_fd = dup(STDOUT_FILENO);
+  dup2(fileno(out), STDOUT_FILENO);
+  ic_enable_color(true);
+  ic_style_def("warn", "ansi-red");
+
+  // styles
+  check_format("[b]%s[/b]: [ic-info]%5.1f%%[/]\n", "name", 42.25);
+  check_format("[warn]%d[/warn] [u]%s [i]%c[/i][/u] [b]%d[/b]\n", 1, "two", '3', 4);
+  // conversions and flags
+  check_format("%d %i %u %x %X %o %#x %+d % d %05d\n", -42, 7, 42U, 255U, 255U, 8U, 255U, 5, 5, -5);
+  check_format("%e %E %f %g %G %a %10.3f|%-10.2e|\n", 1.5e10, 2.5e-10, 3.25, 0.0001, 1e100, 1.0, 3.14159, 2.71828);
+  check_format("%c%c %10s|%-10s|%.2s\n", 'a', 'b', "right", "left", "cut");
+  check_format("%p\n", (void*)&checks);
+  check_format("%-150s|%150d\n", "wide", 42);
+  // length modifiers
+  check_format("%ld %lu %lld %llu %hd %hhu %lx\n", -1L, 2UL, -3LL, 4ULL, 5, 6, 255UL);
+  check_format("%zu %zd %td %jd %ju %Lf\n", (size_t)7, (size_t)8, (ptrdiff_t)-9, (intmax_t)-10, (uintmax_t)11, (long double)12.5);
+  // `*` width and precision
+  check_format("%*d|%-*d|%.*f|%*.*s|\n", 6, 42, 6, 42, 3, 3.14159, 8, 3, "abcdef");
+  check_format("%*d|%*s|\n", -6, 42, 0, "x");
+  // pre and width tags
+  check_format("[pre]%s [b]not bold[/b][/pre] %d\n", "pre", 1);
+  check_format("[warn][pre]%d%%[/pre][/warn]\n", 100);
+  check_format("[width=10]%d[/width]|\n", 12345);
+  check_format("[width=\"12;right;.\"]%s[/width]|\n", "abc");
+  check_format("[width=\"7;center\"][b]%d[/b][/width]|\n", 42);
+  check_format("[width=\"6;left;;on\"]%s[/width]|\n", "a long text");
+  // escaped and unsupported directives
+  check_format("100%% done, %%d %s %%\n", "x");
+  check_format("%d items %y\n", 3);
+
+  fflush(stdout);
+  dup2(stdout_fd, STDOUT_FILENO);
+  printf("%ld format checks, %ld failed\n", checks, failed);
+  return (failed == 0 ? 0 : 1);
+}
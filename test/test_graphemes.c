@@ -0,0 +1,72 @@
+/* ----------------------------------------------------------------------------
+  Copyright (c) 2021, Daan Leijen
+  This is free software; you can redistribute it and/or modify it
+  under the terms of the MIT License. A copy of the license can be
+  found in the "LICENSE" file at the root of this distribution.
+
+  Test of grapheme cluster segmentation: each string is split into clusters
+  both forward (`str_next_ofs`) and backward (`str_prev_ofs`), and the byte
+  length and column width of every cluster is checked.
+-----------------------------------------------------------------------------*/
+#include "../src/isocline.c"   // first, as it sets feature macros
+#include <stdio.h>
+
+#define MAX_CLUSTERS  (8)
+
+typedef struct grapheme_test_s {
+  const char* name;
+  const char* s;
+  ssize_t     count;                 // number of clusters
+  ssize_t     lens[MAX_CLUSTERS];    // byte length of each cluster
+  ssize_t     widths[MAX_CLUSTERS];  // column width of each cluster
+} grapheme_test_t;
+
+static const grapheme_test_t tests[] = {
+  { "ascii",                 "abc", 3, {1,1,1}, {1,1,1} },
+  { "cr lf",                 "ab\r\ncd", 5, {1,1,2,1,1}, {1,1,0,1,1} },
+  { "combining accent",      "e\xCC\x81", 1, {3}, {1} },
+  { "hangul syllable jamo",  "\xE1\x84\x80\xE1\x85\xA1\xE1\x86\xA8", 1, {9}, {2} },
+  { "devanagari spacing mark", "\xE0\xA4\x95\xE0\xA4\xBF", 1, {6}, {2} },
+  { "arabic prepend",        "\xD8\x80" "a", 1, {3}, {1} },
+  { "flags",                 "\xF0\x9F\x87\xB3\xF0\x9F\x87\xB1\xF0\x9F\x87\xA9\xF0\x9F\x87\xAA", 2, {8,8}, {2,2} },
+  { "odd regional indicator", "\xF0\x9F\x87\xB3\xF0\x9F\x87\xB1\xF0\x9F\x87\xA9", 2, {8,4}, {2,1} },
+  { "emoji zwj sequence",    "\xF0\x9F\x91\xA9\xE2\x80\x8D\xF0\x9F\x91\xA9\xE2\x80\x8D\xF0\x9F\x91\xA7", 1, {18}, {2} },
+  { "emoji skin tone",       "\xF0\x9F\x91\x8D\xF0\x9F\x8F\xBD", 1, {8}, {2} },
+  { "emoji presentation",    "\xE2\x9D\xA4\xEF\xB8\x8F", 1, {6}, {2} },
+  { "zwj between letters",   "a\xE2\x80\x8D" "b", 2, {4,1}, {1,1} },
+};
+
+static bool test_forward(const grapheme_test_t* t) {
+  const ssize_t len = ic_strlen(t->s);
+  ssize_t pos = 0;
+  for (ssize_t i = 0; i < t->count; i++) {
+    ssize_t width = 0;
+    const ssize_t n = str_next_ofs(t->s, len, pos, &width);
+    if (n != t->lens[i] || width != t->widths[i]) return false;
+    pos += n;
+  }
+  return (pos == len);
+}
+
+static bool test_backward(const grapheme_test_t* t) {
+  ssize_t pos = ic_strlen(t->s);
+  for (ssize_t i = t->count - 1; i >= 0; i--) {
+    ssize_t width = 0;
+    const ssize_t n = str_prev_ofs(t->s, pos, &width);
+    if (n != t->lens[i] || width != t->widths[i]) return false;
+    pos -= n;
+  }
+  return (pos == 0);
+}
+
+int main(void) {
+  int failed = 0;
+  const int count = (int)(sizeof(tests)/sizeof(tests[0]));
+  for (int i = 0; i < count; i++) {
+    const grapheme_test_t* t = &tests[i];
+    if (!test_forward(t))  { printf("failed: %s (forward)\n", t->name); failed++; }
+    if (!test_backward(t)) { printf("failed: %s (backward)\n", t->name); failed++; }
+  }
+  printf("%d grapheme tests, %d failed\n", count, failed);
+  return (failed == 0 ? 0 : 1);
+}
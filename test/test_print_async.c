@@ -0,0 +1,68 @@
+/* ----------------------------------------------------------------------------
+  Copyright (c) 2021, Daan Leijen
+  This is free software; you can redistribute it and/or modify it
+  under the terms of the MIT License. A copy of the license can be
+  found in the "LICENSE" file at the root of this distribution.
+
+  Test of `ic_print_async` while no readline is active: messages from many
+  threads (and `ic_println` from the main thread) are printed right away,
+  each on its own line and in order per thread. The output is written to a
+  temporary file.
+-----------------------------------------------------------------------------*/
+#include "../src/isocline.c"   // first, as it sets feature macros
+#include <stdio.h>
+#include <pthread.h>
+
+#define THREADS   (4)
+#define MESSAGES  (500)
+
+static void* worker(void* arg) {
+  const long id = (long)(intptr_t)arg;
+  char buf[64];
+  for (int i = 0; i < MESSAGES; i++) {
+    snprintf(buf, sizeof(buf), "thread %ld message %d", id, i);
+    ic_print_async(buf);
+  }
+  return NULL;
+}
+
+int main(void) {
+  FILE* out = tmpfile();
+  if (out == NULL) return 1;
+  fflush(stdout);
+  const int stdout_fd = dup(STDOUT_FILENO);
+  dup2(fileno(out), STDOUT_FILENO);
+
+  ic_print_async("start");  // initializes the library on the main thread
+  pthread_t threads[THREADS];
+  for (long i = 0; i < THREADS; i++) {
+    pthread_create(&threads[i], NULL, &worker, (void*)(intptr_t)i);
+  }
+  for (int i = 0; i < 100; i++) { ic_println("main"); }
+  for (long i = 0; i < THREADS; i++) {
+    pthread_join(threads[i], NULL);
+  }
+
+  // printed right away (before any readline or exit)
+  dup2(stdout_fd, STDOUT_FILENO);
+  rewind(out);
+  long next[THREADS] = { 0 };
+  long lines = 0, mains = 0, failed = 0;
+  char line[256];
+  while (fgets(line, sizeof(line), out) != NULL) {
+    long id, i;
+    lines++;
+    if (strcmp(line, "main\n") == 0) { mains++; }
+    else if (strcmp(line, "start\n") == 0) { }
+    else if (sscanf(line, "thread %ld message %ld\n", &id, &i) == 2 && id >= 0 && id < THREADS && i == next[id]) { next[id]++; }
+    else {
+      if (failed++ < 5) printf("unexpected line: %s", line);
+    }
+  }
+  for (long id = 0; id < THREADS; id++) {
+    if (next[id] != MESSAGES) { printf("thread %ld: %ld messages printed\n", id, next[id]); failed++; }
+  }
+  if (mains != 100) { printf("main: %ld lines printed\n", mains); failed++; }
+  printf("%ld lines, %ld failed\n", lines, failed);
+  return (failed == 0 ? 0 : 1);
+}
@@ -0,0 +1,124 @@
+/* ----------------------------------------------------------------------------
+  Copyright (c) 2021, Daan Leijen
+  This is free software; you can redistribute it and/or modify it
+  under the terms of the MIT License. A copy of the license can be
+  found in the "LICENSE" file at the root of this distribution.
+
+  Test of the cached row layout of a string buffer: after random edits, the
+  rows and positions from the cache (`sbuf_for_each_row` etc.) must equal
+  the ones computed from scratch (`str_for_each_row` etc.).
+-----------------------------------------------------------------------------*/
+#include "../src/isocline.c"   // first, as it sets feature macros
+#include <stdio.h>
+
+#define MAX_ROWS  (4096)
+
+typedef struct rows_s {
+  ssize_t count;
+  ssize_t start[MAX_ROWS];
+  ssize_t len[MAX_ROWS];
+  ssize_t startw[MAX_ROWS];
+  bool    is_wrap[MAX_ROWS];
+} rows_t;
+
+static bool rows_collect(const char* s, ssize_t row, ssize_t row_start, ssize_t row_len, ssize_t startw, bool is_wrap, const void* arg, void* res) {
+  ic_unused(s); ic_unused(arg);
+  rows_t* rows = (rows_t*)res;
+  if (row >= MAX_ROWS) return true;
+  rows->start[row]   = row_start;
+  rows->len[row]     = row_len;
+  rows->startw[row]  = startw;
+  rows->is_wrap[row] = is_wrap;
+  rows->count = row + 1;
+  return false;
+}
+
+static bool rows_equal(const rows_t* a, const rows_t* b) {
+  if (a->count != b->count) return false;
+  for (ssize_t r = 0; r < a->count; r++) {
+    if (a->start[r] != b->start[r] || a->len[r] != b->len[r] ||
+        a->startw[r] != b->startw[r] || a->is_wrap[r] != b->is_wrap[r]) return false;
+  }
+  return true;
+}
+
+static const char* pieces[] = {
+  "a", "hello ", "\n", "\xE4\xB8\xAD", "e\xCC\x81", "\xF0\x9F\x91\xA8\xE2\x80\x8D\xF0\x9F\x91\xA9",
+  "\xF0\x9F\x87\xBA", "\xCC\x81", "\t", "xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx"
+};
+#define PIECES_COUNT  (int)(sizeof(pieces)/sizeof(pieces[0]))
+
+static rows_t rows1, rows2;
+
+int main(void) {
+  ic_env_t* env = ic_get_env();
+  if (env == NULL) return 1;
+  long checks = 0;
+  long failed = 0;
+  srand(7);
+  for (int t = 0; t < 60; t++) {
+    stringbuf_t* sb = sbuf_new(env->mem);
+    if (sb == NULL) return 1;
+    ssize_t termw = (rand()%4 == 0 ? 0 : 5 + rand()%80);
+    const ssize_t promptw  = rand()%6;
+    const ssize_t cpromptw = rand()%6;
+    for (int op = 0; op < 100; op++) {
+      // edit at a random position
+      ssize_t len = sbuf_len(sb);
+      const ssize_t pos = (len > 0 ? rand() % (len+1) : 0);
+      const int k = rand()%10;
+      if (k < 6) {
+        const char* piece = pieces[rand() % PIECES_COUNT];
+        for (int n = 1 + rand()%4; n > 0; n--) { sbuf_insert_at(sb, piece, pos); }
+      }
+      else if (k < 8) { sbuf_delete_at(sb, pos, 1 + rand()%8); }
+      else if (k == 8) { sbuf_swap_char(sb, pos); }
+      else { sbuf_appendf(sb, "%d\n", op); }
+      if (rand()%20 == 0) { termw = (rand()%4 == 0 ? 0 : 5 + rand()%80); }
+      const char* s = sbuf_string(sb);
+      len = sbuf_len(sb);
+
+      // rows
+      memset(&rows1, 0, sizeof(rows1));
+      memset(&rows2, 0, sizeof(rows2));
+      const ssize_t n1 = sbuf_for_each_row(sb, termw, promptw, cpromptw, &rows_collect, NULL, &rows1);
+      const ssize_t n2 = str_for_each_row(s, len, termw, promptw, cpromptw, &rows_collect, NULL, &rows2);
+      checks++;
+      if (n1 != n2 || !rows_equal(&rows1, &rows2)) {
+        if (failed++ < 5) printf("rows differ: test %d, edit %d\n", t, op);
+        continue;
+      }
+      // positions
+      for (int q = 0; q < 20; q++) {
+        const ssize_t p = (q == 0 ? len : rand() % (len+1));
+        rowcol_t rc1, rc2;
+        memset(&rc1, 0, sizeof(rc1));
+        memset(&rc2, 0, sizeof(rc2));
+        checks++;
+        if (sbuf_get_rc_at_pos(sb, termw, promptw, cpromptw, p, &rc1) != str_get_rc_at_pos(s, len, termw, promptw, cpromptw, p, &rc2) ||
+            memcmp(&rc1, &rc2, sizeof(rc1)) != 0) {
+          if (failed++ < 5) printf("row/column differ: test %d, edit %d, pos %ld\n", t, op, (long)p);
+        }
+        if (termw > 0) {
+          const ssize_t newtermw = 5 + rand()%90;
+          memset(&rc1, 0, sizeof(rc1));
+          memset(&rc2, 0, sizeof(rc2));
+          checks++;
+          if (sbuf_get_wrapped_rc_at_pos(sb, termw, newtermw, promptw, cpromptw, p, &rc1) != str_get_wrapped_rc_at_pos(s, len, termw, newtermw, promptw, cpromptw, p, &rc2) ||
+              memcmp(&rc1, &rc2, sizeof(rc1)) != 0) {
+            if (failed++ < 5) printf("wrapped row/column differ: test %d, edit %d, pos %ld\n", t, op, (long)p);
+          }
+        }
+        const ssize_t row = rand() % (n2+1);
+        const ssize_t col = rand() % 90;
+        checks++;
+        if (sbuf_get_pos_at_rc(sb, termw, promptw, cpromptw, row, col) != str_get_pos_at_rc(s, len, termw, promptw, cpromptw, row, col)) {
+          if (failed++ < 5) printf("position differs: test %d, edit %d, row %ld, col %ld\n", t, op, (long)row, (long)col);
+        }
+      }
+    }
+    sbuf_free(sb);
+  }
+  printf("%ld row layout checks, %ld failed\n", checks, failed);
+  return (failed == 0 ? 0 : 1);
+}
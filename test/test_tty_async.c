@@ -0,0 +1,90 @@
+/* ----------------------------------------------------------------------------
+  Copyright (c) 2021, Daan Leijen
+  This is free software; you can redistribute it and/or modify it
+  under the terms of the MIT License. A copy of the license can be
+  found in the "LICENSE" file at the root of this distribution.
+
+  Test of asynchronous tty events (as posted by `ic_print_async` and
+  `ic_async_stop`) on a pseudo terminal: events are read in the order they
+  were posted, none are lost when the pushback buffer is full, the wakeup
+  descriptor is readable on events and resizes, and posting stays safe after
+  the tty is freed.
+-----------------------------------------------------------------------------*/
+#include "../src/isocline.c"   // first, as it sets feature macros
+#include <stdio.h>
+#include <fcntl.h>
+
+static int failed = 0;
+
+static void check(bool ok, const char* what) {
+  printf("%s: %s\n", (ok ? "ok    " : "failed"), what);
+  if (!ok) failed++;
+}
+
+static alloc_t mem = { &malloc, &realloc, &free };
+
+static code_t event_code(int i) {
+  return (KEY_EVENT_BASE + 0x100U + (code_t)i);
+}
+
+// post `count` numbered events and read them back; returns the number read in order
+static int events_roundtrip(tty_t* tty, int count) {
+  for (int i = 0; i < count; i++) {
+    tty_async_post(tty, event_code(i));
+  }
+  int n = 0;
+  code_t c;
+  for (int i = 0; i < count && tty_read_timeout(tty, 0, &c); i++) {
+    if (c == event_code(n)) n++;
+  }
+  return n;
+}
+
+int main(void) {
+  int master = posix_openpt(O_RDWR | O_NOCTTY);
+  if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+    printf("error: cannot open a pseudo terminal\n");
+    return 1;
+  }
+  int slave = open(ptsname(master), O_RDWR | O_NOCTTY);
+  if (slave < 0) return 1;
+
+  tty_t* tty = tty_new(&mem, slave);
+  if (tty == NULL) return 1;
+  tty_start_raw(tty);
+  check(events_roundtrip(tty, 10) == 10, "events are read in order");
+  check(events_roundtrip(tty, 100) == 100, "more events than fit the pushback buffer are read in order");
+
+  // events posted while the pushback buffer is almost full are not lost
+  for (int i = 0; i < 30; i++) { tty_code_pushback(tty, KEY_EVENT_RESIZE); }
+  for (int i = 0; i < 5; i++) { tty_async_post(tty, KEY_EVENT_OUTPUT); }
+  uint8_t b;
+  tty_readc_noblock(tty, &b, 0);   // wakes up on the events (as when reading an escape sequence)
+  int outputs = 0;
+  code_t c;
+  while (tty_read_timeout(tty, 0, &c)) { if (c == KEY_EVENT_OUTPUT) outputs++; }
+  check(outputs == 5, "events are kept when the pushback buffer is full");
+
+  // the wakeup descriptor is readable on events and on a resize (which is not read as an event)
+  struct pollfd fds[1];
+  fds[0].fd = tty_get_wake_fd(tty); fds[0].events = POLLIN; fds[0].revents = 0;
+  tty_async_post(tty, KEY_EVENT_OUTPUT);
+  check(poll(fds, 1, 0) == 1 && tty_read_timeout(tty, 0, &c) && c == KEY_EVENT_OUTPUT, "the wakeup descriptor is readable after a post");
+  #if defined(SIGWINCH)
+  raise(SIGWINCH);
+  check(poll(fds, 1, 0) == 1 && !tty_read_timeout(tty, 0, &c) && tty_term_resize_event(tty), "a resize wakes up the wakeup descriptor");
+  check(poll(fds, 1, 0) == 0, "the resize wakeup is consumed");
+  #endif
+  tty_free(tty);
+
+  check(tty_async_post(tty, KEY_EVENT_STOP), "posting after the tty is freed");
+  tty = tty_new(&mem, slave);
+  if (tty == NULL) return 1;
+  tty_start_raw(tty);
+  check(!tty_read_timeout(tty, 0, &c), "a new tty ignores events posted before");
+  tty_free(tty);
+
+  close(slave);
+  close(master);
+  return (failed == 0 ? 0 : 1);
+}
@@ -0,0 +1,269 @@
+#!/usr/bin/env python3
+# -----------------------------------------------------------------------------
+# Copyright (c) 2021, Daan Leijen
+# This is free software; you can redistribute it and/or modify it
+# under the terms of the MIT License. A copy of the license can be
+# found in the "LICENSE" file at the root of this distribution.
+# -----------------------------------------------------------------------------
+# Generate the unicode tables in `src/wcwidth.c` and `src/graphemes.c` from
+# the unicode database of the running python (`unicodedata`). Use a recent
+# python to get recent unicode data, and run from the repository root as:
+#
+#   python3 util/gen_unicode.py
+# -----------------------------------------------------------------------------
+
+import os
+import sys
+import unicodedata
+
+MAX_CODE   = 0x110000
+BLOCK_BITS = 8                 # 256 code points per block
+BLOCK_SIZE = 1 << BLOCK_BITS
+
+SRC_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "src")
+
+# -----------------------------------------------------------------------------
+# Column width: 0, 1, 2, or 3 (for -1, a control character)
+# -----------------------------------------------------------------------------
+
+def char_width(c):
+  if c == 0:
+    return 0
+  if c < 0x20 or (c >= 0x7F and c < 0xA0):
+    return 3
+  ch  = chr(c)
+  cat = unicodedata.category(ch)
+  # non-spacing and enclosing marks, format characters (including the soft hyphen),
+  # hangul medial vowels and final consonants, and the zero width space
+  if cat in ("Mn", "Me", "Cf") or (c >= 0x1160 and c <= 0x11FF) or c == 0x200B:
+    return 0
+  # east asian wide and full-width, and (even if unassigned) the CJK ideograph ranges
+  # (note: `unicodedata` does not give the default width for unassigned code points)
+  if cat != "Cn" and unicodedata.east_asian_width(ch) in ("W", "F"):
+    return 2
+  if (c >= 0x3400 and c <= 0x4DBF) or (c >= 0x4E00 and c <= 0x9FFF) or (c >= 0xF900 and c <= 0xFAFF) or \
+     (c >= 0x20000 and c <= 0x2FFFD) or (c >= 0x30000 and c <= 0x3FFFD):
+    return 2
+  return 1
+
+# -----------------------------------------------------------------------------
+# Grapheme cluster break property (UAX #29), with Extended_Pictographic
+# folded in as an extra value (as those are all GCB=Other).
+# The properties not exposed by `unicodedata` are listed explicitly.
+# -----------------------------------------------------------------------------
+
+GCB_NAMES = ["Other", "CR", "LF", "Control", "Extend", "ZWJ", "RI", "Prepend",
+             "SpacingMark", "L", "V", "T", "LV", "LVT", "ExtPict"]
+GCB = dict((name, i) for i, name in enumerate(GCB_NAMES))
+
+# PropList.txt: Other_Grapheme_Extend
+OTHER_GRAPHEME_EXTEND = [
+  (0x09BE,0x09BE), (0x09D7,0x09D7), (0x0B3E,0x0B3E), (0x0B57,0x0B57), (0x0BBE,0x0BBE),
+  (0x0BD7,0x0BD7), (0x0CC2,0x0CC2), (0x0CD5,0x0CD6), (0x0D3E,0x0D3E), (0x0D57,0x0D57),
+  (0x0DCF,0x0DCF), (0x0DDF,0x0DDF), (0x1B35,0x1B35), (0x200C,0x200C), (0x302E,0x302F),
+  (0xFF9E,0xFF9F), (0x1133E,0x1133E), (0x11357,0x11357), (0x114B0,0x114B0), (0x114BD,0x114BD),
+  (0x115AF,0x115AF), (0x11930,0x11930), (0x1D165,0x1D165), (0x1D16E,0x1D172), (0xE0020,0xE007F),
+]
+
+# emoji-data.txt: Emoji_Modifier (the skin tones)
+EMOJI_MODIFIER = [(0x1F3FB,0x1F3FF)]
+
+# Indic_Syllabic_Category=Consonant_Preceding_Repha/Consonant_Prefixed, and Prepended_Concatenation_Mark
+PREPEND = [
+  (0x0600,0x0605), (0x06DD,0x06DD), (0x070F,0x070F), (0x0890,0x0891), (0x08E2,0x08E2),
+  (0x0D4E,0x0D4E), (0x110BD,0x110BD), (0x110CD,0x110CD), (0x111C2,0x111C3), (0x1193F,0x1193F),
+  (0x11941,0x11941), (0x11A3A,0x11A3A), (0x11A84,0x11A89), (0x11D46,0x11D46),
+]
+
+# spacing marks (Mc) that are not SpacingMark, and the two that are added (from UAX #29)
+SPACING_MARK_EXCLUDE = [
+  (0x102B,0x102C), (0x1038,0x1038), (0x1062,0x1064), (0x1067,0x106D), (0x1083,0x1083),
+  (0x1087,0x108C), (0x108F,0x108F), (0x109A,0x109C), (0x1A61,0x1A61), (0x1A63,0x1A64),
+  (0xAA7B,0xAA7B), (0xAA7D,0xAA7D), (0x11720,0x11721),
+]
+SPACING_MARK_INCLUDE = [(0x0E33,0x0E33), (0x0EB3,0x0EB3)]
+
+# Default_Ignorable_Code_Point ranges that contain unassigned code points
+DEFAULT_IGNORABLE_CN = [(0x2060,0x206F), (0xFFF0,0xFFF8), (0xE0000,0xE0FFF)]
+
+# emoji-data.txt: Extended_Pictographic (this includes unassigned code points
+# as the ranges are reserved for future emoji)
+EXTENDED_PICTOGRAPHIC = [
+  (0x00A9,0x00A9), (0x00AE,0x00AE), (0x203C,0x203C), (0x2049,0x2049), (0x2122,0x2122),
+  (0x2139,0x2139), (0x2194,0x2199), (0x21A9,0x21AA), (0x231A,0x231B), (0x2328,0x2328),
+  (0x2388,0x2388), (0x23CF,0x23CF), (0x23E9,0x23F3), (0x23F8,0x23FA), (0x24C2,0x24C2),
+  (0x25AA,0x25AB), (0x25B6,0x25B6), (0x25C0,0x25C0), (0x25FB,0x25FE), (0x2600,0x2605),
+  (0x2607,0x2612), (0x2614,0x2685), (0x2690,0x2705), (0x2708,0x2712), (0x2714,0x2714),
+  (0x2716,0x2716), (0x271D,0x271D), (0x2721,0x2721), (0x2728,0x2728), (0x2733,0x2734),
+  (0x2744,0x2744), (0x2747,0x2747), (0x274C,0x274C), (0x274E,0x274E), (0x2753,0x2755),
+  (0x2757,0x2757), (0x2763,0x2767), (0x2795,0x2797), (0x27A1,0x27A1), (0x27B0,0x27B0),
+  (0x27BF,0x27BF), (0x2934,0x2935), (0x2B05,0x2B07), (0x2B1B,0x2B1C), (0x2B50,0x2B50),
+  (0x2B55,0x2B55), (0x3030,0x3030), (0x303D,0x303D), (0x3297,0x3297), (0x3299,0x3299),
+  (0x1F000,0x1F0FF), (0x1F10D,0x1F10F), (0x1F12F,0x1F12F), (0x1F16C,0x1F171), (0x1F17E,0x1F17F),
+  (0x1F18E,0x1F18E), (0x1F191,0x1F19A), (0x1F1AD,0x1F1E5), (0x1F201,0x1F20F), (0x1F21A,0x1F21A),
+  (0x1F22F,0x1F22F), (0x1F232,0x1F23A), (0x1F23C,0x1F23F), (0x1F249,0x1F3FA), (0x1F400,0x1F53D),
+  (0x1F546,0x1F64F), (0x1F680,0x1F6FF), (0x1F774,0x1F77F), (0x1F7D5,0x1F7FF), (0x1F80C,0x1F80F),
+  (0x1F848,0x1F84F), (0x1F85A,0x1F85F), (0x1F888,0x1F88F), (0x1F8AE,0x1F8FF), (0x1F90C,0x1F93A),
+  (0x1F93C,0x1F945), (0x1F947,0x1FAFF), (0x1FC00,0x1FFFD),
+]
+
+def in_ranges(c, ranges):
+  for lo, hi in ranges:
+    if c >= lo and c <= hi:
+      return True
+  return False
+
+def grapheme_break(c):
+  if c == 0x0D:
+    return GCB["CR"]
+  if c == 0x0A:
+    return GCB["LF"]
+  if c == 0x200D:
+    return GCB["ZWJ"]
+  if c >= 0x1F1E6 and c <= 0x1F1FF:
+    return GCB["RI"]
+  ch  = chr(c)
+  cat = unicodedata.category(ch)
+  if cat in ("Mn", "Me") or in_ranges(c, OTHER_GRAPHEME_EXTEND) or in_ranges(c, EMOJI_MODIFIER):
+    return GCB["Extend"]
+  if in_ranges(c, PREPEND):
+    return GCB["Prepend"]
+  if cat in ("Cc", "Cf", "Zl", "Zp") or (cat == "Cn" and in_ranges(c, DEFAULT_IGNORABLE_CN)):
+    return GCB["Control"]
+  if (cat == "Mc" and not in_ranges(c, SPACING_MARK_EXCLUDE)) or in_ranges(c, SPACING_MARK_INCLUDE):
+    return GCB["SpacingMark"]
+  if (c >= 0x1100 and c <= 0x115F) or (c >= 0xA960 and c <= 0xA97C):
+    return GCB["L"]
+  if (c >= 0x1160 and c <= 0x11A7) or (c >= 0xD7B0 and c <= 0xD7C6):
+    return GCB["V"]
+  if (c >= 0x11A8 and c <= 0x11FF) or (c >= 0xD7CB and c <= 0xD7FB):
+    return GCB["T"]
+  if c >= 0xAC00 and c <= 0xD7A3:
+    return (GCB["LV"] if (c - 0xAC00) % 28 == 0 else GCB["LVT"])
+  if in_ranges(c, EXTENDED_PICTOGRAPHIC):
+    return GCB["ExtPict"]
+  return GCB["Other"]
+
+# -----------------------------------------------------------------------------
+# Two-stage tables with 2- or 4-bit entries
+# -----------------------------------------------------------------------------
+
+def two_stage(values, bits):
+  per_byte = 8 // bits
+  blocks = []
+  index  = {}
+  stage1 = []
+  for start in range(0, MAX_CODE, BLOCK_SIZE):
+    packed = []
+    for i in range(start, start + BLOCK_SIZE, per_byte):
+      byte = 0
+      for j in range(per_byte):
+        byte |= values[i+j] << (j * bits)
+      packed.append(byte)
+    packed = tuple(packed)
+    if packed not in index:
+      index[packed] = len(blocks)
+      blocks.append(packed)
+    stage1.append(index[packed])
+  assert len(blocks) <= 256
+  return stage1, blocks
+
+def c_array(out, decl, values, per_line):
+  out.append(decl + " = {")
+  for i in range(0, len(values), per_line):
+    out.append("  " + ",".join("0x%02x" % v for v in values[i:i+per_line]) + ",")
+  out.append("};")
+
+def c_blocks(out, decl, blocks):
+  out.append(decl + " = {")
+  for b in blocks:
+    rows = [b[i:i+32] for i in range(0, len(b), 32)]
+    for i, row in enumerate(rows):
+      out.append(("  {" if i == 0 else "   ") + ",".join("0x%02x" % v for v in row) + ("}," if i == len(rows) - 1 else ","))
+  out.append("};")
+
+def gen_wcwidth():
+  widths = [char_width(c) for c in range(MAX_CODE)]
+  stage1, blocks = two_stage(widths, 2)
+  out = []
+  out.append("""// include in "stringbuf.c"
+// Generated by `util/gen_unicode.py` from unicode %s: do not edit.
+/*
+ * The column width of a unicode code point, as in `wcwidth` from
+ * Markus Kuhn <http://www.cl.cam.ac.uk/~mgk25/ucs/wcwidth.c>:
+ *
+ *   - The null character (U+0000) has a column width of 0.
+ *   - Other C0/C1 control characters and DEL have a column width of -1.
+ *   - Non-spacing and enclosing combining characters (general category
+ *     Mn or Me) and format characters (Cf, including the SOFT HYPHEN U+00AD)
+ *     and ZERO WIDTH SPACE (U+200B) have a column width of 0.
+ *   - Hangul Jamo medial vowels and final consonants (U+1160-U+11FF)
+ *     have a column width of 0.
+ *   - Characters in the East Asian Wide (W) or East Asian Full-width (F)
+ *     category (including emoji with an emoji presentation), and the CJK
+ *     ideograph ranges (like U+4E00-U+9FFF and U+20000-U+3FFFD) have a 
+ *     column width of 2.
+ *   - All remaining characters have a column width of 1.
+ *
+ * Instead of searching interval tables, we use a two-stage table:
+ * the first stage maps each block of %d code points to a block in
+ * the second stage which has 2-bit entries (where 3 means -1).
+ */
+
+#include <stdint.h>
+""" % (unicodedata.unidata_version, BLOCK_SIZE))
+  c_array(out, "static const uint8_t wcwidth_stage1[%d]" % len(stage1), stage1, 16)
+  out.append("")
+  c_blocks(out, "static const uint8_t wcwidth_stage2[%d][%d]" % (len(blocks), len(blocks[0])), blocks)
+  out.append("""
+static inline int mk_wcwidth(int32_t ucs) {
+  if (ucs < 0 || ucs >= 0x%X) return 1;
+  const uint8_t block = wcwidth_stage1[ucs >> %d];
+  const int w = (wcwidth_stage2[block][(ucs & 0x%X) >> 2] >> ((ucs & 3) * 2)) & 3;
+  return (w == 3 ? -1 : w);
+}""" % (MAX_CODE, BLOCK_BITS, BLOCK_SIZE - 1))
+  return "\n".join(out) + "\n"
+
+def write_file(name, content):
+  fname = os.path.join(SRC_DIR, name)
+  with open(fname, "w", newline="\n") as f:
+    f.write(content)
+  sys.stderr.write("generated %s (unicode %s)\n" % (os.path.normpath(fname), unicodedata.unidata_version))
+
+def gen_graphemes():
+  props = [grapheme_break(c) for c in range(MAX_CODE)]
+  stage1, blocks = two_stage(props, 4)
+  out = []
+  out.append("""// include in "stringbuf.c"
+// Generated by `util/gen_unicode.py` from unicode %s: do not edit.
+/*
+ * The grapheme cluster break property of a unicode code point
+ * (see <https://www.unicode.org/reports/tr29>), where code points
+ * with the Extended_Pictographic property get their own value.
+ *
+ * Just like the column widths, we use a two-stage table where the
+ * first stage maps each block of %d code points to a block in the
+ * second stage which has 4-bit entries.
+ */
+
+#include <stdint.h>
+
+typedef enum gcb_e {
+%s
+} gcb_t;
+""" % (unicodedata.unidata_version, BLOCK_SIZE,
+       "\n".join("  GCB_%s%s" % (name.upper(), "," if i < len(GCB_NAMES) - 1 else "") for i, name in enumerate(GCB_NAMES))))
+  c_array(out, "static const uint8_t gcb_stage1[%d]" % len(stage1), stage1, 16)
+  out.append("")
+  c_blocks(out, "static const uint8_t gcb_stage2[%d][%d]" % (len(blocks), len(blocks[0])), blocks)
+  out.append("""
+static inline gcb_t gcb_of(int32_t ucs) {
+  if (ucs < 0 || ucs >= 0x%X) return GCB_OTHER;
+  const uint8_t block = gcb_stage1[ucs >> %d];
+  return (gcb_t)((gcb_stage2[block][(ucs & 0x%X) >> 1] >> ((ucs & 1) * 4)) & 0x0F);
+}""" % (MAX_CODE, BLOCK_BITS, BLOCK_SIZE - 1))
+  return "\n".join(out) + "\n"
+
+if __name__ == "__main__":
+  write_file("wcwidth.c", gen_wcwidth())
+  write_file("graphemes.c", gen_graphemes())